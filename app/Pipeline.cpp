@@ -0,0 +1,396 @@
+#include "Pipeline.h"
+#include <evaluator/Format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+using namespace eval;
+
+namespace
+{
+
+// spins, then yields, then sleeps for growing intervals so that idle stages
+// of a slow feed do not burn a core
+class Backoff
+{
+public:
+    void pause()
+    {
+        ++m_count;
+        if (m_count < 64)
+            return;
+        if (m_count < 128)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min<size_t>(1000, m_count - 127)));
+    }
+
+private:
+    size_t m_count = 0;
+};
+
+// Bounded multi-producer multi-consumer queue (Vyukov). Each cell carries a
+// sequence number telling whether it is ready to be written or read at the
+// current lap, so push and pop only contend on one atomic index each.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+    {
+        size_t n = 1;
+        while (n < capacity)
+            n *= 2;
+        m_mask = n - 1;
+        m_cells = std::unique_ptr<Cell[]>(new Cell[n]);
+        for (size_t i = 0; i < n; ++i)
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool tryPush(T value)
+    {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0 && m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+            if (diff < 0)
+                return false;
+            if (diff > 0)
+                pos = m_tail.load(std::memory_order_relaxed);
+        }
+        cell->value = std::move(value);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &value)
+    {
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0 && m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+            if (diff < 0)
+                return false;
+            if (diff > 0)
+                pos = m_head.load(std::memory_order_relaxed);
+        }
+        value = std::move(cell->value);
+        cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(T value)
+    {
+        Backoff backoff;
+        while (!tryPush(value))
+            backoff.pause();
+    }
+
+    T pop()
+    {
+        Backoff backoff;
+        T value;
+        while (!tryPop(value))
+            backoff.pause();
+        return value;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_tail{0};
+    alignas(64) std::atomic<size_t> m_head{0};
+};
+
+struct Batch
+{
+    uint64_t seq = 0;
+    size_t rows = 0;
+    // column-major, PIPELINE_BATCH_ROWS values per variable
+    std::vector<decimal_t> args;
+    std::vector<size_t> lines;
+    std::vector<char> malformed;
+    std::vector<decimal_t> values;
+    std::vector<DataType> results;
+    std::vector<std::pair<size_t, EvalError>> errors;
+};
+
+// fields separated by commas and/or blanks, exactly `n` of them
+bool parseRecord(const std::string &line, decimal_t *out, size_t stride, size_t n)
+{
+    const char *p = line.data(), *end = p + line.size();
+    size_t i = 0;
+    while (true)
+    {
+        while (p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+        if (p == end)
+            return i == n;
+        if (i == n)
+            return false;
+        if (*p == '+')
+            ++p;
+        auto ret = std::from_chars(p, end, out[i * stride]);
+        if (ret.ec != std::errc())
+            return false;
+        p = ret.ptr;
+        ++i;
+        while (p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+        if (p != end && *p == ',')
+            ++p;
+    }
+}
+
+class Pipeline
+{
+public:
+    Pipeline(const std::string &expr, const std::vector<std::string> &vars, size_t workers,
+             std::shared_ptr<const Definitions> definitions)
+        : m_vars(vars), m_workers(workers), m_definitions(std::move(definitions)),
+          m_free(workers * PIPELINE_BATCHES_PER_WORKER), m_input(workers * PIPELINE_BATCHES_PER_WORKER),
+          m_output(workers * PIPELINE_BATCHES_PER_WORKER), m_batches(workers * PIPELINE_BATCHES_PER_WORKER)
+    {
+        Context context(m_definitions);
+        context.init();
+        try
+        {
+            m_program = context.compileExpr(expr, vars);
+        }
+        catch (const EvalExcept &e)
+        {
+            if (e.error().code != EVAL_NOT_COMPILABLE)
+                throw;
+            // lists, user lambdas that do not compile, ...: interpret a lambda
+            // over the variables instead, still parsing only once
+            m_lambda.params = vars;
+            m_lambda.expr = Parser().parse(tokenize(expr));
+        }
+        for (auto &b : m_batches)
+        {
+            b.args.resize(std::max<size_t>(1, vars.size()) * PIPELINE_BATCH_ROWS);
+            b.lines.resize(PIPELINE_BATCH_ROWS);
+            b.malformed.resize(PIPELINE_BATCH_ROWS);
+            m_free.push(&b);
+        }
+    }
+
+    int run(std::istream &in)
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < m_workers; ++i)
+            threads.emplace_back([this]
+                                 { work(); });
+        std::thread writer([this]
+                           { write(); });
+        read(in);
+        for (auto &t : threads)
+            t.join();
+        writer.join();
+        return m_failures == 0 ? 0 : 1;
+    }
+
+private:
+    void read(std::istream &in)
+    {
+        const size_t n = m_vars.size();
+        uint64_t seq = 0;
+        size_t lineNo = 0;
+        std::string line;
+        Batch *batch = nullptr;
+        auto dispatch = [&]
+        {
+            batch->seq = seq++;
+            m_input.push(batch);
+            batch = nullptr;
+        };
+        while (std::getline(in, line))
+        {
+            ++lineNo;
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            if (batch == nullptr)
+            {
+                batch = m_free.pop();
+                batch->rows = 0;
+            }
+            size_t r = batch->rows++;
+            batch->lines[r] = lineNo;
+            batch->malformed[r] = !parseRecord(line, batch->args.data() + r, PIPELINE_BATCH_ROWS, n);
+            // do not hold records back while waiting for a slow feed
+            if (batch->rows == PIPELINE_BATCH_ROWS || in.rdbuf()->in_avail() <= 0)
+                dispatch();
+        }
+        if (batch != nullptr)
+            dispatch();
+        m_total.store(seq, std::memory_order_release);
+        m_readDone.store(true, std::memory_order_release);
+        for (size_t i = 0; i < m_workers; ++i)
+            m_input.push(nullptr);
+    }
+
+    void work()
+    {
+        Context context(m_definitions);
+        context.init();
+        std::vector<ColumnView> columns(m_vars.size());
+        std::vector<DataType> args(m_vars.size());
+        while (Batch *batch = m_input.pop())
+        {
+            batch->errors.clear();
+            if (m_program)
+            {
+                for (size_t v = 0; v < columns.size(); ++v)
+                    columns[v] = {batch->args.data() + v * PIPELINE_BATCH_ROWS, batch->rows};
+                batch->values.resize(batch->rows);
+                m_program->runBatch(columns.data(), batch->rows, batch->values.data());
+            }
+            else
+            {
+                batch->results.resize(batch->rows);
+                for (size_t r = 0; r < batch->rows; ++r)
+                {
+                    if (batch->malformed[r])
+                        continue;
+                    for (size_t v = 0; v < args.size(); ++v)
+                        args[v] = batch->args[v * PIPELINE_BATCH_ROWS + r];
+                    try
+                    {
+                        batch->results[r] = context.apply(m_lambda, args);
+                    }
+                    catch (const EvalExcept &e)
+                    {
+                        batch->errors.emplace_back(r, e.error());
+                    }
+                }
+            }
+            for (size_t r = 0; r < batch->rows; ++r)
+                if (batch->malformed[r])
+                    batch->errors.emplace_back(r, EvalError{EVAL_FILE_MALFORMED});
+            std::sort(batch->errors.begin(), batch->errors.end(), [](auto &a, auto &b)
+                      { return a.first < b.first; });
+            m_output.push(batch);
+        }
+    }
+
+    void write()
+    {
+        // batches complete out of order; at most m_batches.size() are in
+        // flight, so their sequence numbers map to distinct slots
+        std::vector<Batch *> done(m_batches.size(), nullptr);
+        std::string out, err;
+        uint64_t next = 0;
+        Backoff backoff;
+        while (!m_readDone.load(std::memory_order_acquire) || next < m_total.load(std::memory_order_acquire))
+        {
+            Batch *batch;
+            if (!m_output.tryPop(batch))
+            {
+                if (!out.empty() || !err.empty())
+                    flush(out, err);
+                backoff.pause();
+                continue;
+            }
+            backoff = Backoff();
+            done[batch->seq % done.size()] = batch;
+            while ((batch = done[next % done.size()]) != nullptr && batch->seq == next)
+            {
+                done[next % done.size()] = nullptr;
+                format(*batch, out, err);
+                m_free.push(batch);
+                ++next;
+            }
+            if (out.size() >= (1 << 16))
+                flush(out, err);
+        }
+        flush(out, err);
+    }
+
+    void format(const Batch &batch, std::string &out, std::string &err)
+    {
+        auto error = batch.errors.begin();
+        for (size_t r = 0; r < batch.rows; ++r)
+        {
+            if (error != batch.errors.end() && error->first == r)
+            {
+                err += "line " + std::to_string(batch.lines[r]) + ": ";
+                appendError(err, error->second);
+                err += '\n';
+                ++error;
+                ++m_failures;
+            }
+            else if (m_program)
+                appendDecimal(out, batch.values[r]);
+            else
+                appendValue(out, batch.results[r]);
+            out += '\n';
+        }
+    }
+
+    static void flush(std::string &out, std::string &err)
+    {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fwrite(err.data(), 1, err.size(), stderr);
+        std::fflush(stdout);
+        out.clear();
+        err.clear();
+    }
+
+private:
+    std::vector<std::string> m_vars;
+    size_t m_workers;
+    std::shared_ptr<const Definitions> m_definitions;
+    std::shared_ptr<const CompiledProgram> m_program;
+    LambdaType m_lambda;
+
+    BoundedQueue<Batch *> m_free;
+    BoundedQueue<Batch *> m_input;
+    BoundedQueue<Batch *> m_output;
+    std::vector<Batch> m_batches;
+
+    std::atomic<uint64_t> m_total{0};
+    std::atomic<bool> m_readDone{false};
+    size_t m_failures = 0;
+};
+
+} // namespace
+
+int pipeline(std::istream &in, const std::string &expr, const std::vector<std::string> &vars,
+             size_t workers, std::shared_ptr<const Definitions> definitions)
+{
+    if (workers == 0)
+        workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+    try
+    {
+        Pipeline p(expr, vars, workers, std::move(definitions));
+        return p.run(in);
+    }
+    catch (const EvalExcept &e)
+    {
+        std::string err = "pipeline: ";
+        appendError(err, e.error());
+        std::cerr << err << '\n';
+        return 2;
+    }
+}
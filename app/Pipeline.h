@@ -0,0 +1,26 @@
+#ifndef EVAL_APP_PIPELINE_H_
+#define EVAL_APP_PIPELINE_H_
+
+#include <evaluator/Context.h>
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+constexpr size_t PIPELINE_BATCH_ROWS = 1024;
+constexpr size_t PIPELINE_BATCHES_PER_WORKER = 4;
+
+// Evaluates `expr` once per input record, a line of comma or space separated
+// values bound to `vars` in order, and prints one result line per record in
+// input order. A reader thread parses records into batches, `workers` threads
+// (0 for one per core) evaluate them with the expression compiled once, and a
+// writer thread formats the results. The stages exchange a fixed pool of
+// batches through bounded lock-free queues, so a slow stage holds back the
+// others and memory stays constant. Failed records print an empty line and are
+// reported on stderr.
+int pipeline(std::istream &in, const std::string &expr, const std::vector<std::string> &vars,
+             size_t workers, std::shared_ptr<const eval::Definitions> definitions = nullptr);
+
+#endif
@@ -0,0 +1,495 @@
+#include "Server.h"
+
+#include <evaluator/Context.h>
+#include <evaluator/Format.h>
+#include <evaluator/Scheduler.h>
+
+#include <iostream>
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace eval;
+
+namespace
+{
+
+struct Connection
+{
+    int fd;
+    Context context;
+
+    // loop thread only
+    std::string readBuf;
+    std::string writeBuf;
+    bool peerClosed = false;
+    bool closing = false;
+    uint32_t events = EPOLLIN;
+
+    // shared with the worker running the job
+    std::mutex mutex;
+    std::deque<std::string> requests;
+    std::string responses;
+    bool busy = false;
+    // the job died with an exception, the session state is unknown
+    bool failed = false;
+};
+
+class Server
+{
+public:
+    Server(int listenFd, size_t workers, std::shared_ptr<const Definitions> definitions, const EvalBudget &budget)
+        : m_listenFd(listenFd), m_scheduler(workers), m_definitions(std::move(definitions)), m_budget(budget) {}
+    ~Server();
+
+    int run();
+
+private:
+    void accept();
+    void read(Connection &);
+    void write(Connection &);
+    void schedule(const std::shared_ptr<Connection> &);
+    void process(const std::shared_ptr<Connection> &);
+    void wake(const std::shared_ptr<Connection> &);
+    void close(Connection &);
+    void update(Connection &);
+
+private:
+    int m_listenFd;
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    // running jobs keep their connection alive after it is closed
+    std::unordered_map<Connection *, std::shared_ptr<Connection>> m_conns;
+    std::vector<std::shared_ptr<Connection>> m_closed;
+
+    std::mutex m_readyMutex;
+    std::vector<std::shared_ptr<Connection>> m_ready;
+
+    TaskScheduler m_scheduler;
+    std::shared_ptr<const Definitions> m_definitions;
+    EvalBudget m_budget;
+};
+
+// marks the listening socket and the wakeup eventfd in epoll events
+char g_listenTag, g_wakeTag;
+
+bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+Server::~Server()
+{
+    for (auto &c : m_conns)
+        ::close(c.first->fd);
+    if (m_wakeFd >= 0)
+        ::close(m_wakeFd);
+    if (m_epollFd >= 0)
+        ::close(m_epollFd);
+}
+
+int Server::run()
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_wakeFd < 0 || !setNonBlocking(m_listenFd))
+    {
+        std::cerr << "server setup failed: " << std::strerror(errno) << '\n';
+        return 1;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &g_listenTag;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &ev);
+    ev.data.ptr = &g_wakeTag;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+
+    std::vector<epoll_event> events(256);
+    while (true)
+    {
+        int n = epoll_wait(m_epollFd, events.data(), static_cast<int>(events.size()), -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "epoll_wait failed: " << std::strerror(errno) << '\n';
+            return 1;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            auto tag = events[i].data.ptr;
+            if (tag == &g_listenTag)
+                accept();
+            else if (tag == &g_wakeTag)
+            {
+                uint64_t count;
+                while (::read(m_wakeFd, &count, sizeof(count)) > 0)
+                    ;
+                std::vector<std::shared_ptr<Connection>> ready;
+                {
+                    std::lock_guard<std::mutex> lock(m_readyMutex);
+                    ready.swap(m_ready);
+                }
+                for (auto conn : ready)
+                    if (conn->failed)
+                        close(*conn);
+                    else if (!conn->closing)
+                        write(*conn);
+            }
+            else
+            {
+                auto ite = m_conns.find(static_cast<Connection *>(tag));
+                if (ite == m_conns.end())
+                    continue;
+                auto ptr = ite->second;
+                auto &conn = *ptr;
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    conn.peerClosed = true;
+                if (events[i].events & EPOLLIN)
+                    read(conn);
+                if (!conn.closing && (events[i].events & EPOLLOUT || conn.peerClosed))
+                    write(conn);
+            }
+        }
+        // kept until the batch is handled so no stale event can match a new
+        // connection at the same address
+        m_closed.clear();
+    }
+}
+
+void Server::accept()
+{
+    while (true)
+    {
+        int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto conn = std::make_shared<Connection>();
+        conn->fd = fd;
+        conn->context = Context(m_definitions);
+        conn->context.init();
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn.get();
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            ::close(fd);
+            continue;
+        }
+        m_conns.emplace(conn.get(), std::move(conn));
+    }
+}
+
+void Server::read(Connection &conn)
+{
+    char buf[1 << 16];
+    while (true)
+    {
+        ssize_t n = ::read(conn.fd, buf, sizeof(buf));
+        if (n > 0)
+        {
+            conn.readBuf.append(buf, n);
+            continue;
+        }
+        if (n == 0)
+            conn.peerClosed = true;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            conn.peerClosed = true;
+        break;
+    }
+
+    size_t begin = 0, end;
+    std::vector<std::string> lines;
+    while ((end = conn.readBuf.find('\n', begin)) != std::string::npos)
+    {
+        size_t len = end - begin;
+        if (len > 0 && conn.readBuf[end - 1] == '\r')
+            --len;
+        lines.emplace_back(conn.readBuf, begin, len);
+        begin = end + 1;
+    }
+    conn.readBuf.erase(0, begin);
+    if (conn.readBuf.size() > SERVER_MAX_LINE)
+    {
+        close(conn);
+        return;
+    }
+    if (!lines.empty())
+    {
+        std::lock_guard<std::mutex> lock(conn.mutex);
+        for (auto &l : lines)
+            conn.requests.push_back(std::move(l));
+    }
+    schedule(m_conns.at(&conn));
+    update(conn);
+}
+
+void Server::schedule(const std::shared_ptr<Connection> &conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        if (conn->busy || conn->failed || conn->requests.empty())
+            return;
+        conn->busy = true;
+    }
+    m_scheduler.post([this, conn]
+                     { process(conn); },
+                     [this, conn](std::exception_ptr)
+                     {
+                         {
+                             std::lock_guard<std::mutex> lock(conn->mutex);
+                             conn->failed = true;
+                             conn->busy = false;
+                         }
+                         wake(conn);
+                     });
+}
+
+// runs on a worker; one job per connection at a time keeps the session
+// single-threaded and the responses in request order
+void Server::process(const std::shared_ptr<Connection> &ptr)
+{
+    auto &conn = *ptr;
+    std::deque<std::string> requests;
+    std::string out;
+    while (true)
+    {
+        bool finished = false;
+        {
+            std::lock_guard<std::mutex> lock(conn.mutex);
+            conn.responses += out;
+            if (conn.requests.empty())
+            {
+                conn.busy = false;
+                finished = true;
+            }
+            else
+                requests.swap(conn.requests);
+        }
+        if (!out.empty() || finished)
+            wake(ptr);
+        if (finished)
+            return;
+
+        out.clear();
+        for (auto &r : requests)
+        {
+            EvalResult<DataType> ret = VoidType{};
+            try
+            {
+                ret = conn.context.exec(r, m_budget);
+            }
+            catch (const EvalExcept &e)
+            {
+                ret = e.error();
+            }
+            if (!ret)
+            {
+                out += "err ";
+                appendError(out, ret.error());
+            }
+            else if (ret->index() == 0)
+                out += "ok";
+            else
+            {
+                out += "ok ";
+                appendValue(out, *ret);
+            }
+            out += '\n';
+        }
+        requests.clear();
+    }
+}
+
+// hands the connection to the loop thread for writing
+void Server::wake(const std::shared_ptr<Connection> &conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_readyMutex);
+        m_ready.push_back(conn);
+    }
+    uint64_t one = 1;
+    ::write(m_wakeFd, &one, sizeof(one));
+}
+
+void Server::write(Connection &conn)
+{
+    bool idle;
+    {
+        std::lock_guard<std::mutex> lock(conn.mutex);
+        if (conn.writeBuf.empty())
+            conn.writeBuf.swap(conn.responses);
+        else
+        {
+            conn.writeBuf += conn.responses;
+            conn.responses.clear();
+        }
+        idle = !conn.busy && conn.requests.empty();
+    }
+
+    size_t written = 0;
+    while (written < conn.writeBuf.size())
+    {
+        ssize_t n = ::send(conn.fd, conn.writeBuf.data() + written, conn.writeBuf.size() - written, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            written += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n < 0 && errno == EINTR)
+            continue;
+        close(conn);
+        return;
+    }
+    conn.writeBuf.erase(0, written);
+
+    if (conn.peerClosed && idle && conn.writeBuf.empty())
+    {
+        close(conn);
+        return;
+    }
+    update(conn);
+}
+
+// stops reading while a lot of output is queued or the peer is gone, and
+// waits for writability only while there is something left to send
+void Server::update(Connection &conn)
+{
+    uint32_t events = (!conn.peerClosed && conn.writeBuf.size() < SERVER_MAX_OUTPUT ? static_cast<uint32_t>(EPOLLIN) : 0) |
+                      (conn.writeBuf.empty() ? 0 : static_cast<uint32_t>(EPOLLOUT));
+    if (events == conn.events)
+        return;
+    conn.events = events;
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.ptr = &conn;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+}
+
+void Server::close(Connection &conn)
+{
+    if (conn.closing)
+        return;
+    conn.closing = true;
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+    ::close(conn.fd);
+    {
+        std::lock_guard<std::mutex> lock(conn.mutex);
+        conn.requests.clear();
+    }
+    auto ite = m_conns.find(&conn);
+    m_closed.push_back(std::move(ite->second));
+    m_conns.erase(ite);
+}
+
+// binds and listens on fd, which is closed on failure with errno kept
+int bindAndListen(int fd, const sockaddr *addr, socklen_t len)
+{
+    if (fd < 0)
+        return -1;
+    if (bind(fd, addr, len) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+// returns -1 with errno set on failure
+int listenOn(const std::string &address)
+{
+    if (address.rfind("unix:", 0) == 0)
+    {
+        auto path = address.substr(5);
+        sockaddr_un addr{};
+        if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(path.c_str());
+        return bindAndListen(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+    if (address.rfind("tcp:", 0) == 0)
+    {
+        const char *digits = address.c_str() + 4;
+        char *end;
+        errno = 0;
+        unsigned long port = std::strtoul(digits, &end, 10);
+        if (*digits < '0' || *digits > '9' || *end != '\0' || errno != 0 || port < 1 || port > 65535)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd >= 0)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        return bindAndListen(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+} // namespace
+
+int serve(const std::string &address, size_t workers, std::shared_ptr<const Definitions> definitions, const EvalBudget &budget)
+{
+    std::signal(SIGPIPE, SIG_IGN);
+    int fd = listenOn(address);
+    if (fd < 0)
+    {
+        std::cerr << "cannot listen on " << address << ": " << std::strerror(errno) << '\n';
+        return 2;
+    }
+    Server server(fd, workers, std::move(definitions), budget);
+    int ret = server.run();
+    ::close(fd);
+    return ret;
+}
+
+#else
+
+int serve(const std::string &, size_t, std::shared_ptr<const eval::Definitions>, const eval::EvalBudget &)
+{
+    std::cerr << "server mode requires Linux\n";
+    return 2;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef EVAL_APP_SERVER_H_
+#define EVAL_APP_SERVER_H_
+
+#include <evaluator/Budget.h>
+#include <evaluator/Context.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+constexpr size_t SERVER_MAX_LINE = 1 << 20;
+constexpr size_t SERVER_MAX_OUTPUT = 1 << 22;
+
+// limits of every request, so a runaway statement answers with an error
+// instead of holding a worker
+inline const eval::EvalBudget SERVER_DEFAULT_BUDGET{100000000, std::chrono::seconds(10), size_t(1) << 30, 1000};
+
+// Serves line-delimited requests on "unix:PATH" or "tcp:PORT" (bound to
+// localhost). Every connection has its own session Context; each request line
+// is one statement, answered in order by "ok", "ok VALUE" or "err MESSAGE".
+// Requests may be pipelined. Evaluation runs on a pool of `workers` threads
+// (0 for one per core) and the sockets are driven by an epoll loop. Sessions
+// start from `definitions` when given and every request runs under `budget`.
+// Returns 2 without serving when the address is invalid or cannot be bound.
+int serve(const std::string &address, size_t workers,
+          std::shared_ptr<const eval::Definitions> definitions = nullptr,
+          const eval::EvalBudget &budget = SERVER_DEFAULT_BUDGET);
+
+#endif
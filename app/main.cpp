@@ -1,101 +1,464 @@
 #include <iostream>
+#include "Server.h"
+#include "Pipeline.h"
 #include <evaluator/Context.h>
+#include <evaluator/Scheduler.h>
+#include <evaluator/Profiler.h>
+#include <evaluator/Trace.h>
+#include <evaluator/Budget.h>
+#include <evaluator/Format.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
 
 using namespace eval;
 
-void printList(const ListType &l)
+constexpr size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+constexpr size_t PARALLEL_BATCH_LINES = 1 << 12;
+constexpr size_t PARALLEL_CHUNK_LINES = 64;
+
+struct Session
 {
-    std::cout << '[';
-    if (!l.empty())
-        std::cout << l[0];
-    for (size_t i = 1; i < l.size(); ++i)
-        std::cout << ", " << l[i];
-    std::cout << "]\n";
-}
+    Context context;
+    std::unique_ptr<TaskScheduler> scheduler;
+    std::optional<EvalBudget> budget;
+    bool printAST = false;
+};
 
-bool printAST = false;
+EvalResult<DataType> run(Context &context, const std::string &input, const std::optional<EvalBudget> &budget)
+{
+    if (!budget)
+        return context.tryExec(input);
+    try
+    {
+        return context.exec(input, *budget);
+    }
+    catch (const EvalExcept &e)
+    {
+        return e.error();
+    }
+}
 
-void printLambdaSig(const LambdaType &l)
+// returns false on !exit
+bool runCommand(Session &s, const std::string &cmd, std::ostream &out)
 {
-    std::cout << "@(";
-    if (!l.params.empty())
-        std::cout << l.params[0];
-    for (size_t i = 1; i < l.params.size(); ++i)
-        std::cout << ", " << l.params[i];
-    if (!printAST || l.expr == nullptr)
-        std::cout << "){...}\n";
+    auto &context = s.context;
+    if (cmd == "exit")
+    {
+        return false;
+    }
+    else if (cmd == "list")
+    {
+        for (auto &v : context.identifiers())
+            out << v << ", ";
+        out << '\n';
+    }
+    else if (cmd == "init")
+    {
+        context.init();
+    }
+    else if (cmd == "ast")
+    {
+        s.printAST = !s.printAST;
+    }
+    else if (cmd == "parallel")
+    {
+        if (s.scheduler == nullptr)
+            s.scheduler = std::make_unique<TaskScheduler>();
+        else
+            s.scheduler.reset();
+        context.setParallelEval(s.scheduler.get());
+        out << "parallel evaluation " << (s.scheduler ? "on\n" : "off\n");
+    }
+    else if (cmd == "profile")
+    {
+        context.setProfiling(context.profiler() == nullptr);
+        out << "profiling " << (context.profiler() ? "on\n" : "off\n");
+    }
+    else if (cmd == "profile report" || cmd == "profile json" || cmd == "profile clear")
+    {
+        auto profiler = context.profiler();
+        if (profiler == nullptr)
+            out << "profiling off\n";
+        else if (cmd == "profile report")
+            out << profiler->report();
+        else if (cmd == "profile json")
+            out << profiler->toJson().toStringFormatted() << '\n';
+        else
+            profiler->clear();
+    }
+    else if (cmd == "mem")
+    {
+        auto stats = context.memoryStats();
+        auto &live = stats.live;
+        out << "lists: " << live.listBytes << " bytes in " << live.lists << '\n'
+            << "ast nodes: " << live.astBytes << " bytes in " << live.astNodes << '\n'
+            << "lambdas: " << live.lambdaBytes << " bytes in " << live.lambdas << '\n'
+            << "strings: " << live.stringBytes << " bytes in " << live.strings << '\n'
+            << "mapped lists: " << live.mappedBytes << " bytes\n"
+            << "total: " << live.totalBytes() << " bytes, peak: " << stats.peakBytes
+            << " bytes, assignments: " << stats.allocations << '\n';
+        for (auto &v : stats.largestVars)
+            out << "  " << v.first << ": " << v.second << " bytes\n";
+    }
+    else if (cmd == "budget")
+    {
+        s.budget.reset();
+        out << "budget off\n";
+    }
+    else if (cmd.rfind("budget ", 0) == 0)
+    {
+        std::stringstream ss(cmd.substr(7));
+        EvalBudget b;
+        uint64_t ms = 0;
+        if (ss >> b.maxSteps >> ms >> b.maxBytes >> b.maxDepth)
+        {
+            b.timeout = std::chrono::milliseconds(ms);
+            s.budget = b;
+        }
+        else
+            out << "usage: !budget <steps> <ms> <bytes> <depth>\n";
+    }
+    else if (cmd.rfind("save ", 0) == 0 || cmd.rfind("load ", 0) == 0 ||
+             cmd.rfind("snapshot ", 0) == 0 || cmd.rfind("restore ", 0) == 0)
+    {
+        try
+        {
+            if (cmd.rfind("snapshot ", 0) == 0)
+                context.saveSnapshot(cmd.substr(9));
+            else if (cmd.rfind("restore ", 0) == 0)
+                context.loadSnapshot(cmd.substr(8));
+            else if (cmd[0] == 's')
+                context.saveDefinitions(cmd.substr(5));
+            else
+            {
+                context = Context(Context::loadDefinitions(cmd.substr(5)));
+                context.init();
+                context.setParallelEval(s.scheduler.get());
+                context.setFileAccess(true);
+            }
+        }
+        catch (const EvalExcept &e)
+        {
+            out << e.what() << '\n';
+        }
+    }
+    else if (cmd == "trace")
+    {
+        auto &tracer = Tracer::instance();
+        if (tracer.enabled())
+            tracer.stop();
+        else
+            tracer.start();
+        out << "tracing " << (tracer.enabled() ? "on\n" : "off\n");
+    }
+    else if (cmd.rfind("trace ", 0) == 0)
+    {
+        std::ofstream fout(cmd.substr(6));
+        if (!fout)
+            out << "cannot open file\n";
+        else
+            fout << Tracer::instance().toJson().toString() << '\n';
+    }
     else
     {
-        std::cout << "){\n";
-        std::cout << l.expr->toJson().toStringFormatted() << "\n}\n";
+        out << "unknown command\n";
     }
+    return true;
 }
 
-int main()
+int repl(Session &s)
 {
-    Context context;
-    context.init();
-
     while (true)
     {
         std::cout << "eval> ";
         std::string input;
-        std::getline(std::cin, input);
+        if (!std::getline(std::cin, input))
+            return 0;
 
         if (input.empty())
             continue;
         if (input[0] == '!')
         {
-            auto cmd = input.substr(1);
-            if (cmd == "exit")
-            {
+            if (!runCommand(s, input.substr(1), std::cout))
                 return 0;
-            }
-            else if (cmd == "list")
-            {
-                for (auto &v : context.varMap())
-                    std::cout << v.first << ", ";
-                std::cout << '\n';
-            }
-            else if (cmd == "init")
-            {
-                context.init();
-            }
-            else if (cmd == "ast")
-            {
-                printAST = !printAST;
-            }
-            else
+            continue;
+        }
+
+        auto ret = run(s.context, input, s.budget);
+        if (!ret)
+        {
+            std::string err;
+            appendError(err, ret.error());
+            std::cerr << err << '\n';
+            continue;
+        }
+        if (s.printAST)
+            std::cout << s.context.AST()->toJson().toStringFormatted() << '\n';
+        if (ret->index() != 0)
+        {
+            std::string out = " = ";
+            appendValue(out, *ret, s.printAST);
+            out += '\n';
+            std::cout << out;
+        }
+    }
+}
+
+// lines that neither read ans nor assign or touch files, directly or through
+// the lambdas they call, can run in any order
+bool isIndependent(const Context &context, const std::string &line)
+{
+    auto tokens = tryTokenize(line);
+    if (!tokens)
+        return false;
+    for (auto &t : *tokens)
+        if (t.type == TokenType::ASSIGN || (t.type == TokenType::IDENT && std::get<1>(t.value) == "ans"))
+            return false;
+    Parser parser;
+    auto ast = parser.tryParse(*tokens);
+    return ast && context.isPure(**ast);
+}
+
+// Evaluates one statement per line without prompts. Results go to a large
+// output buffer, errors are reported with their line number. With a line
+// scheduler, consecutive independent lines are evaluated in parallel against
+// a snapshot of the definitions made so far and printed in input order. The
+// snapshot is reused until a serial line or command may have changed the
+// definitions, and runs shorter than one chunk are evaluated serially.
+int batch(Session &s, std::istream &in, TaskScheduler *lineScheduler)
+{
+    std::string out, err;
+    out.reserve(2 * OUTPUT_BUFFER_SIZE);
+    size_t failures = 0;
+
+    auto flush = [&]
+    {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fwrite(err.data(), 1, err.size(), stderr);
+        out.clear();
+        err.clear();
+    };
+    auto report = [&](std::string &dst, size_t lineNo, const EvalResult<DataType> &ret, bool printAST)
+    {
+        if (ret && ret->index() == 0)
+            return;
+        if (ret)
+            appendValue(dst, *ret, printAST);
+        else
+        {
+            dst += "line " + std::to_string(lineNo) + ": ";
+            appendError(dst, ret.error());
+        }
+        dst += '\n';
+    };
+
+    auto runSerial = [&](size_t lineNo, const std::string &line)
+    {
+        auto ret = run(s.context, line, s.budget);
+        failures += !ret;
+        report(ret ? out : err, lineNo, ret, s.printAST);
+    };
+
+    std::vector<std::pair<size_t, std::string>> pending;
+    std::shared_ptr<const Definitions> snapshot;
+    auto runPending = [&]
+    {
+        const size_t n = pending.size();
+        if (n <= PARALLEL_CHUNK_LINES)
+        {
+            for (auto &p : pending)
+                runSerial(p.first, p.second);
+            pending.clear();
+            return;
+        }
+        if (snapshot == nullptr)
+            snapshot = s.context.freeze();
+
+        const size_t chunks = (n + PARALLEL_CHUNK_LINES - 1) / PARALLEL_CHUNK_LINES;
+        std::vector<std::string> outs(n), errs(n);
+        std::vector<char> failed(n, 0);
+        // the last value of each chunk that a serial run would store in ans
+        std::vector<std::optional<DataType>> lastValues(chunks);
+        lineScheduler->parallelFor(chunks, [&](size_t chunk)
+                                   {
+                                       Context context(snapshot);
+                                       context.setFileAccess(true);
+                                       for (size_t i = chunk * PARALLEL_CHUNK_LINES; i < std::min(n, (chunk + 1) * PARALLEL_CHUNK_LINES); ++i)
+                                       {
+                                           auto ret = run(context, pending[i].second, s.budget);
+                                           failed[i] = !ret;
+                                           report(ret ? outs[i] : errs[i], pending[i].first, ret, s.printAST);
+                                           if (ret && ret->index() != 0)
+                                               lastValues[chunk] = std::move(*ret);
+                                       } });
+        for (size_t i = 0; i < n; ++i)
+        {
+            out += outs[i];
+            err += errs[i];
+            failures += failed[i];
+        }
+        for (auto ite = lastValues.rbegin(); ite != lastValues.rend(); ++ite)
+            if (*ite)
             {
-                std::cout << "unknown command\n";
+                s.context.setVar("ans", std::move(**ite));
+                break;
             }
+        pending.clear();
+        if (out.size() >= OUTPUT_BUFFER_SIZE)
+            flush();
+    };
+
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(in, line))
+    {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        auto first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#')
             continue;
+
+        if (lineScheduler != nullptr && line[first] != '!' && isIndependent(s.context, line))
+        {
+            pending.emplace_back(lineNo, std::move(line));
+            if (pending.size() >= PARALLEL_BATCH_LINES)
+                runPending();
+            continue;
+        }
+        runPending();
+        // anything but an independent line may change the definitions
+        snapshot.reset();
+
+        if (line[first] == '!')
+        {
+            std::ostringstream ss;
+            bool more = runCommand(s, line.substr(first + 1), ss);
+            out += ss.str();
+            if (!more)
+                break;
+        }
+        else
+            runSerial(lineNo, line);
+        if (out.size() >= OUTPUT_BUFFER_SIZE)
+            flush();
+    }
+    runPending();
+    flush();
+    return failures == 0 ? 0 : 1;
+}
+
+void usage()
+{
+    std::cerr << "usage: eval [-l IMAGE] [-f FILE | --listen ADDRESS | --pipeline EXPR --vars X,Y] [-j THREADS]\n"
+                 "  -l IMAGE          start from the definitions saved in IMAGE by !save\n"
+                 "  -f FILE           run FILE in batch mode, - for stdin\n"
+                 "  --listen ADDRESS  serve requests on unix:PATH or tcp:PORT\n"
+                 "  --pipeline EXPR   evaluate EXPR for each record of values for --vars\n"
+                 "                    read from FILE or stdin\n"
+                 "  -j THREADS        evaluate independent lines in parallel in batch mode,\n"
+                 "                    or the number of server or pipeline workers\n"
+                 "without -f, batch mode is used when stdin is not a terminal\n";
+}
+
+int main(int argc, char **argv)
+{
+    std::string file, address, image, expr;
+    std::vector<std::string> vars;
+    bool pipelineMode = false;
+    size_t jobs = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+            image = argv[++i];
+        else if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+            file = argv[++i];
+        else if (std::strcmp(argv[i], "--listen") == 0 && i + 1 < argc)
+            address = argv[++i];
+        else if (std::strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc)
+        {
+            pipelineMode = true;
+            expr = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--vars") == 0 && i + 1 < argc)
+        {
+            std::stringstream ss(argv[++i]);
+            for (std::string v; std::getline(ss, v, ',');)
+                vars.push_back(v);
+        }
+        else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            jobs = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            usage();
+            return 2;
         }
+    }
 
-        DataType ret;
+    std::shared_ptr<const Definitions> definitions;
+    if (!image.empty())
+    {
         try
         {
-            ret = context.exec(input);
-            if (printAST)
-                std::cout << context.AST()->toJson().toStringFormatted() << '\n';
+            definitions = Context::loadDefinitions(image);
         }
         catch (const EvalExcept &e)
         {
-            std::cerr << e.what() << '\n';
+            std::cerr << image << ": " << e.what() << '\n';
+            return 2;
         }
-        switch (ret.index())
+    }
+
+    if (!address.empty())
+        return serve(address, jobs, definitions);
+
+    if (pipelineMode)
+    {
+        std::ios::sync_with_stdio(false);
+        if (file.empty() || file == "-")
+            return pipeline(std::cin, expr, vars, jobs, definitions);
+        std::ifstream fin(file);
+        if (!fin)
         {
-        case 1:
-            std::cout << " = " << std::get<1>(ret) << '\n';
-            break;
-        case 2:
-            std::cout << " = ";
-            printList(std::get<2>(ret));
-            break;
-        case 3:
-            std::cout << " = ";
-            printLambdaSig(std::get<3>(ret));
-            break;
+            std::cerr << "cannot open " << file << '\n';
+            return 2;
         }
+        return pipeline(fin, expr, vars, jobs, definitions);
+    }
+
+    // statements typed or scripted by the user may use files, unlike server
+    // requests and pipeline expressions
+    Session s{Context(definitions), nullptr, std::nullopt, false};
+    s.context.init();
+    s.context.setFileAccess(true);
+
+    if (file.empty() && isatty(fileno(stdin)))
+        return repl(s);
+
+    std::ios::sync_with_stdio(false);
+    std::unique_ptr<TaskScheduler> lineScheduler;
+    if (jobs > 1)
+        lineScheduler = std::make_unique<TaskScheduler>(jobs);
+
+    if (file.empty() || file == "-")
+        return batch(s, std::cin, lineScheduler.get());
+    std::ifstream fin(file);
+    if (!fin)
+    {
+        std::cerr << "cannot open " << file << '\n';
+        return 2;
     }
+    return batch(s, fin, lineScheduler.get());
 }
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include <evaluator/Context.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace eval;
+
+struct BenchConfig
+{
+    size_t warmup = 3;
+    size_t reps = 31;
+    std::string filter;
+};
+
+struct BenchResult
+{
+    std::string name;
+    size_t reps;
+    size_t opsPerRep;
+    double medianNs;
+    double p99Ns;
+    double nsPerOp;
+
+    JsonNode toJson() const
+    {
+        return {{"name", jsptr(name)},
+                {"reps", jsptr(static_cast<double>(reps))},
+                {"ops_per_rep", jsptr(static_cast<double>(opsPerRep))},
+                {"median_ns", jsptr(medianNs)},
+                {"p99_ns", jsptr(p99Ns)},
+                {"ns_per_op", jsptr(nsPerOp)}};
+    }
+};
+
+static volatile size_t g_sink = 0;
+
+static void consume(const DataType &d)
+{
+    g_sink = g_sink + d.index();
+}
+
+class BenchRunner
+{
+public:
+    explicit BenchRunner(const BenchConfig &config) : m_config(config) {}
+
+    // f runs opsPerRep operations per repetition
+    template <typename Func>
+    void run(const std::string &name, size_t opsPerRep, Func &&f)
+    {
+        if (!m_config.filter.empty() && name.find(m_config.filter) == std::string::npos)
+            return;
+
+        for (size_t i = 0; i < m_config.warmup; ++i)
+            f();
+
+        std::vector<double> samples(m_config.reps);
+        for (auto &s : samples)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            f();
+            auto t1 = std::chrono::steady_clock::now();
+            s = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        }
+        std::sort(samples.begin(), samples.end());
+
+        BenchResult r;
+        r.name = name;
+        r.reps = samples.size();
+        r.opsPerRep = opsPerRep;
+        r.medianNs = samples[samples.size() / 2];
+        r.p99Ns = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+        r.nsPerOp = r.medianNs / static_cast<double>(opsPerRep);
+        std::cerr << name << ": " << r.nsPerOp << " ns/op\n";
+        m_results.push_back(jsptr(r.toJson()));
+    }
+
+    JsonNode toJson() const
+    {
+        return {{"benchmarks", jsptr(m_results)}};
+    }
+
+private:
+    BenchConfig m_config;
+    JsonArr_t m_results;
+};
+
+static const char *examples[]{
+    "f(x, y) = sqrt(x^2 + y^2)",
+    "fib(n) = if_else(gt(n, 1), fib(n - 1) + fib(n - 2), 1)",
+    "Y = @(f){@(g){f(g(g))}(@(g){f(@(y){g(g)(y)})})}",
+    "fact_gen = @(f){@(n){if_else(n, n * f(n - 1), 1)}}",
+    "fact = Y(fact_gen)",
+    "map_n(list, f, n) = if_else(gt(n, 0), assign(map_n(list, f, n - 1), n - 1, f(list[n - 1])), list)",
+    "map(list, f) = map_n(list, f, len(list))",
+    "construct(f, n) = if_else(gt(n, 0), append(construct(f, n - 1), f(n - 1)), [])",
+    "first(l) = l[0]",
+};
+
+static std::string listLiteral(size_t n)
+{
+    std::string s = "[";
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (i)
+            s += ", ";
+        s += std::to_string(i % 97) + ".5";
+    }
+    return s + "]";
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig config;
+    std::string outPath;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--reps") && i + 1 < argc)
+            config.reps = std::max<size_t>(1, std::stoul(argv[++i]));
+        else if (!std::strcmp(argv[i], "--warmup") && i + 1 < argc)
+            config.warmup = std::stoul(argv[++i]);
+        else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+            config.filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--out") && i + 1 < argc)
+            outPath = argv[++i];
+        else
+        {
+            std::cerr << "usage: bench [--reps N] [--warmup N] [--filter NAME] [--out FILE]\n";
+            return 1;
+        }
+    }
+
+    BenchRunner runner(config);
+
+    Context context;
+    context.init();
+    for (auto e : examples)
+        context.exec(e);
+
+    const std::string arith = "sin(pi / 2) + sqrt(2) ^ gamma(3) - 4 * 5 / sin(-6 - 7 / ln(8)) - 9";
+    const std::string mapExpr = "map([1, 2, 3, 4, 5, 6, 7, 8, 9, 10], sin)";
+    const std::string list1k = listLiteral(1000);
+
+    runner.run("tokenize/arith", 1000, [&]
+               { for (int i = 0; i < 1000; ++i) g_sink = g_sink + tokenize(arith).size(); });
+    runner.run("tokenize/list_1k", 10, [&]
+               { for (int i = 0; i < 10; ++i) g_sink = g_sink + tokenize(list1k).size(); });
+
+    auto arithTokens = tokenize(arith);
+    auto mapTokens = tokenize(examples[5]);
+    auto listTokens = tokenize(list1k);
+    runner.run("parse/arith", 1000, [&]
+               { for (int i = 0; i < 1000; ++i) g_sink = g_sink + Parser().parse(arithTokens)->children.size(); });
+    runner.run("parse/map_n", 1000, [&]
+               { for (int i = 0; i < 1000; ++i) g_sink = g_sink + Parser().parse(mapTokens)->children.size(); });
+    runner.run("parse/list_1k", 10, [&]
+               { for (int i = 0; i < 10; ++i) g_sink = g_sink + Parser().parse(listTokens)->children.size(); });
+
+    runner.run("exec/arith", 1000, [&]
+               { for (int i = 0; i < 1000; ++i) consume(context.exec(arith)); });
+    runner.run("exec/fib_15", 1, [&]
+               { consume(context.exec("fib(15)")); });
+    runner.run("exec/y_fact_10", 100, [&]
+               { for (int i = 0; i < 100; ++i) consume(context.exec("fact(10)")); });
+    runner.run("exec/map_sin_10", 100, [&]
+               { for (int i = 0; i < 100; ++i) consume(context.exec(mapExpr)); });
+    runner.run("exec/construct_fib_10", 10, [&]
+               { for (int i = 0; i < 10; ++i) consume(context.exec("construct(fib, 10)")); });
+
+    for (size_t n : {10, 1000, 100000})
+    {
+        auto suffix = "_" + std::to_string(n);
+        context.exec("l = " + listLiteral(n));
+        size_t ops = std::max<size_t>(1, 100000 / n);
+
+        runner.run("substitude/first" + suffix, ops, [&]
+                   { for (size_t i = 0; i < ops; ++i) consume(context.exec("first(l)")); });
+        runner.run("list/add_scalar" + suffix, ops, [&]
+                   { for (size_t i = 0; i < ops; ++i) consume(context.exec("l + 1")); });
+        runner.run("list/add_list" + suffix, ops, [&]
+                   { for (size_t i = 0; i < ops; ++i) consume(context.exec("l + l")); });
+        runner.run("list/pow_scalar" + suffix, ops, [&]
+                   { for (size_t i = 0; i < ops; ++i) consume(context.exec("l ^ 2")); });
+        runner.run("list/pow_list" + suffix, ops, [&]
+                   { for (size_t i = 0; i < ops; ++i) consume(context.exec("l ^ l")); });
+    }
+
+    auto json = runner.toJson().toStringFormatted();
+    if (outPath.empty())
+        std::cout << json << '\n';
+    else
+        std::ofstream(outPath) << json << '\n';
+    return 0;
+}
@@ -9,6 +9,10 @@
 #include <stdexcept>
 #include <cassert>
 #include <cstdint>
+#include <charconv>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <cmath>
 #include <sstream>
 
@@ -121,7 +125,6 @@ inline const std::string JsonTypeStr[]{
     "object"};
 
 inline constexpr uint16_t JSON_MAX_DEPTH = 20;
-inline constexpr uint16_t JSON_DECIMAL_TO_STRING_PRECISION = 12;
 
 class JsonNode
 {
@@ -222,6 +225,13 @@ private:
         return ss.str();
     }
 
+    // shortest representation that round-trips, independent of the locale
+    static std::string _numToString(JsonNum_t num)
+    {
+        char buf[32];
+        return std::string(buf, std::to_chars(buf, buf + sizeof(buf), num).ptr);
+    }
+
     std::string _toString(uint16_t depth, bool decodeUTF8) const
     {
         if (depth >= JSON_MAX_DEPTH)
@@ -238,12 +248,7 @@ private:
         case JsonBoolType:
             return getBool() ? "true" : "false";
         case JsonNumType:
-        {
-            std::stringstream ss;
-            ss.precision(JSON_DECIMAL_TO_STRING_PRECISION);
-            ss << getNum();
-            return ss.str();
-        }
+            return _numToString(getNum());
         case JsonStrType:
             return '"' + _toJsonString(getStr(), decodeUTF8) + '"';
         case JsonArrType:
@@ -295,12 +300,7 @@ private:
         case JsonBoolType:
             return getBool() ? "true" : "false";
         case JsonNumType:
-        {
-            std::stringstream ss;
-            ss.precision(JSON_DECIMAL_TO_STRING_PRECISION);
-            ss << getNum();
-            return ss.str();
-        }
+            return _numToString(getNum());
         case JsonStrType:
             return '"' + _toJsonString(getStr(), decodeUTF8) + '"';
         case JsonArrType:
@@ -587,12 +587,21 @@ private:
     size_t _pos() const { return static_cast<size_t>(m_pos - m_buffer.begin()); }
     size_t _col() const { return _pos() - m_lineLen; }
 
+    static const char *_scanNumber(const char *, const char *);
+    [[noreturn]] static void _throwAt(JsonParseErrCode, const std::string_view, const char *);
+
 public:
     JsonParser() = default;
     JsonParser(const JsonParser &) = delete;
     JsonParser &operator=(const JsonParser &) = delete;
 
     JsonNode parse(const std::string_view);
+
+    // Parses an array of numbers straight into a container with push_back and
+    // reserve, without building nodes or copying the buffer. null elements are
+    // read as NaN.
+    template <typename Container>
+    void parseNumberArray(const std::string_view, Container &);
 };
 
 inline JsonNode JsonParser::parse(const std::string_view buffer_view)
@@ -610,6 +619,112 @@ inline JsonNode JsonParser::parse(const std::string_view buffer_view)
     return ret;
 }
 
+template <typename Container>
+inline void JsonParser::parseNumberArray(const std::string_view buffer, Container &out)
+{
+    const char *p = buffer.data();
+    const char *end = p + buffer.size();
+    auto skipSpace = [&]
+    {
+        while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            ++p;
+    };
+
+    skipSpace();
+    if (p == end)
+        _throwAt(JSON_EMPTY_BUFFER, buffer, p);
+    if (*p != '[')
+        _throwAt(JSON_INVALID_VALUE, buffer, p);
+    ++p;
+    // one allocation: every element but the last is followed by a comma
+    out.reserve(out.size() + std::count(p, end, ',') + 1);
+
+    skipSpace();
+    if (p != end && *p == ']')
+        ++p;
+    else
+        while (true)
+        {
+            skipSpace();
+            if (p == end)
+                _throwAt(JSON_MISS_COMMA_OR_SQUARE_BRACKET, buffer, p);
+            if (*p == ']')
+                _throwAt(JSON_TRAILING_COMMA, buffer, p);
+            if (*p == 'n')
+            {
+                if (end - p < 4 || std::memcmp(p, "null", 4) != 0)
+                    _throwAt(JSON_INVALID_LITERAL, buffer, p);
+                out.push_back(std::numeric_limits<JsonNum_t>::quiet_NaN());
+                p += 4;
+            }
+            else
+            {
+                const char *last = _scanNumber(p, end);
+                if (last == nullptr)
+                    _throwAt(*p == '-' || (*p >= '0' && *p <= '9') ? JSON_INVALID_NUMBER : JSON_INVALID_VALUE, buffer, p);
+                JsonNum_t num;
+                if (std::from_chars(p, last, num).ec == std::errc::result_out_of_range)
+                    _throwAt(JSON_NUMBER_OUT_OF_RANGE, buffer, p);
+                out.push_back(num);
+                p = last;
+            }
+            skipSpace();
+            if (p == end || (*p != ',' && *p != ']'))
+                _throwAt(JSON_MISS_COMMA_OR_SQUARE_BRACKET, buffer, p);
+            if (*p++ == ']')
+                break;
+        }
+
+    skipSpace();
+    if (p != end)
+        _throwAt(JSON_ROOT_NOT_SINGLE_VALUE, buffer, p);
+}
+
+// end of the number starting at p, nullptr if it does not follow the JSON grammar
+inline const char *JsonParser::_scanNumber(const char *p, const char *end)
+{
+    auto digit = [&]
+    { return p != end && *p >= '0' && *p <= '9'; };
+    if (p != end && *p == '-')
+        ++p;
+    if (!digit())
+        return nullptr;
+    if (*p == '0')
+        ++p;
+    else
+        while (digit())
+            ++p;
+    if (p != end && *p == '.')
+    {
+        ++p;
+        if (!digit())
+            return nullptr;
+        while (digit())
+            ++p;
+    }
+    if (p != end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        if (p != end && (*p == '+' || *p == '-'))
+            ++p;
+        if (!digit())
+            return nullptr;
+        while (digit())
+            ++p;
+    }
+    return p;
+}
+
+inline void JsonParser::_throwAt(JsonParseErrCode err, const std::string_view buffer, const char *at)
+{
+    size_t pos = at - buffer.data();
+    auto prefix = buffer.substr(0, pos);
+    size_t line = 1 + std::count(prefix.begin(), prefix.end(), '\n');
+    size_t lineStart = prefix.rfind('\n');
+    size_t col = lineStart == std::string_view::npos ? pos + 1 : pos - lineStart;
+    throw JsonParseExcept(err, pos, line, col);
+}
+
 inline JsonNode JsonParser::_parseValue(uint16_t depth)
 {
     if (depth >= JSON_MAX_DEPTH)
@@ -1,6 +1,7 @@
 #ifndef EVAL_AST_H_
 #define EVAL_AST_H_
 
+#include <evaluator/EvalDefs.h>
 #include <JsonParser.hpp>
 
 #include <vector>
@@ -25,13 +26,16 @@ enum class OptrType
     LIST,
     LAMBDA,
     EXPR_LIST,
-    PARAM_LIST
+    PARAM_LIST,
+    STRING
 };
 
 struct ASTNode
 {
     std::variant<OptrType, decimal_t, std::string> value;
     std::vector<std::shared_ptr<ASTNode>> children;
+    // offset of the node in the source it was parsed from
+    size_t pos = EVAL_NO_POS;
 
     ASTNode() = default;
     template <typename ValType>
@@ -0,0 +1,79 @@
+#ifndef EVAL_ASYNC_EVAL_H_
+#define EVAL_ASYNC_EVAL_H_
+
+#include <evaluator/Context.h>
+#include <evaluator/Budget.h>
+#include <evaluator/Coroutine.h>
+
+#include <optional>
+
+namespace eval
+{
+
+inline constexpr uint64_t ASYNC_YIELD_STEPS = 4096;
+inline constexpr size_t ASYNC_STACK_SIZE = 8 << 20;
+inline constexpr size_t ASYNC_STACK_MARGIN = EVAL_STACK_MARGIN;
+
+enum class AsyncState
+{
+    SUSPENDED,
+    DONE,
+    FAILED,
+    CANCELLED,
+};
+
+// One exec that runs on its own stack and hands control back to the caller
+// of resume() every `yieldEvery` evaluated nodes, so a single thread can
+// interleave many slow evaluations. Yields only happen outside of parallel
+// sections. Only one AsyncEval per Context may be in flight, and it must be
+// resumed on the thread that created it. Destroying a suspended evaluation
+// cancels it. Recursion that would leave less than ASYNC_STACK_MARGIN of the
+// stack fails with EVAL_RECURSION_LIMIT_EXCEEDED; stacks smaller than twice
+// the margin are enlarged.
+class AsyncEval
+{
+public:
+    AsyncEval(Context &, std::string input,
+              uint64_t yieldEvery = ASYNC_YIELD_STEPS,
+              std::optional<EvalBudget> budget = std::nullopt,
+              size_t stackSize = ASYNC_STACK_SIZE);
+    ~AsyncEval();
+
+    AsyncEval(const AsyncEval &) = delete;
+    AsyncEval &operator=(const AsyncEval &) = delete;
+
+    // runs until the next yield point or the end of the evaluation
+    AsyncState resume();
+    // unwinds a suspended evaluation, which then fails with EVAL_CANCELLED
+    void cancel();
+
+    AsyncState state() const { return m_state; }
+    bool done() const { return m_state != AsyncState::SUSPENDED; }
+    const DataType &result() const { return m_result; }
+    const std::optional<EvalExcept> &error() const { return m_error; }
+    uint64_t steps() const { return m_steps; }
+
+private:
+    friend class Context;
+
+    bool shouldYield() { return ++m_steps % m_yieldEvery == 0; }
+    // called on the coroutine stack, returns true when cancelled
+    bool yield();
+
+private:
+    Context &m_context;
+    std::string m_input;
+    uint64_t m_yieldEvery;
+    std::optional<EvalBudget> m_budget;
+    uint64_t m_steps = 0;
+    bool m_cancelled = false;
+
+    AsyncState m_state = AsyncState::SUSPENDED;
+    DataType m_result;
+    std::optional<EvalExcept> m_error;
+    Coroutine m_coroutine;
+};
+
+} // namespace eval
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef EVAL_BUDGET_H_
+#define EVAL_BUDGET_H_
+
+#include <evaluator/EvalDefs.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace eval
+{
+
+inline constexpr uint64_t BUDGET_CHECK_INTERVAL = 256;
+
+// Limits of a single exec, 0 means unlimited. Steps are evaluated AST nodes,
+// bytes are the list storage produced by them and depth is the nesting of
+// lambda calls.
+struct EvalBudget
+{
+    uint64_t maxSteps = 0;
+    std::chrono::nanoseconds timeout{0};
+    size_t maxBytes = 0;
+    size_t maxDepth = 0;
+};
+
+// Usage of a budget shared by all threads evaluating one exec. Every thread
+// accumulates steps and bytes locally and publishes them, together with a
+// deadline check, once per BUDGET_CHECK_INTERVAL steps, so limits are enforced
+// with that granularity and a long-running builtin is only stopped after it
+// returns. A thread keeps pending counts for one budget at a time; when
+// another budget runs on it (coroutines, pool workers) the counts are handed
+// back to the budget they belong to. The checks return the code of the
+// exceeded limit, if any.
+class BudgetState : public std::enable_shared_from_this<BudgetState>
+{
+public:
+    explicit BudgetState(const EvalBudget &);
+    ~BudgetState();
+
+    std::optional<EvalErrCode> step()
+    {
+        auto &p = pending();
+        if (++p.steps >= m_interval)
+            return flush();
+        return std::nullopt;
+    }
+    std::optional<EvalErrCode> allocate(size_t bytes)
+    {
+        auto &p = pending();
+        p.bytes += bytes;
+        if (m_budget.maxBytes != 0 && p.bytes >= m_budget.maxBytes)
+            return flush();
+        return std::nullopt;
+    }
+    std::optional<EvalErrCode> checkDepth(size_t depth) const
+    {
+        if (m_budget.maxDepth != 0 && depth > m_budget.maxDepth)
+            return EVAL_RECURSION_LIMIT_EXCEEDED;
+        return std::nullopt;
+    }
+
+    std::optional<EvalErrCode> flush();
+    uint64_t steps() const { return m_steps.load(std::memory_order_relaxed); }
+    size_t bytes() const { return m_bytes.load(std::memory_order_relaxed); }
+
+private:
+    struct Pending
+    {
+        uint64_t owner = 0; // id of the budget the counts belong to
+        std::weak_ptr<BudgetState> ownerRef;
+        uint64_t steps = 0;
+        size_t bytes = 0;
+    };
+
+    Pending &pending()
+    {
+        if (t_pending.owner != m_id)
+            adopt();
+        return t_pending;
+    }
+    void adopt();
+
+    static thread_local Pending t_pending;
+
+    // ids are never reused, unlike addresses
+    const uint64_t m_id;
+    EvalBudget m_budget;
+    uint64_t m_interval;
+    std::chrono::steady_clock::time_point m_deadline;
+    std::atomic<uint64_t> m_steps{0};
+    std::atomic<size_t> m_bytes{0};
+};
+
+} // namespace eval
+
+#endif
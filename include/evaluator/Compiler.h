@@ -0,0 +1,115 @@
+#ifndef EVAL_COMPILER_H_
+#define EVAL_COMPILER_H_
+
+#include <evaluator/EvalDefs.h>
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace eval
+{
+
+inline constexpr size_t COMPILED_MAX_ARITY = 16;
+inline constexpr size_t COMPILED_BATCH_BLOCK = 256;
+
+using ScalarUnaryFunc = decimal_t (*)(decimal_t);
+using ScalarBinaryFunc = decimal_t (*)(decimal_t, decimal_t);
+
+enum class CompiledOp : uint8_t
+{
+    CONST,
+    ARG,
+    NEG,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    POW,
+    UNARY,
+    BINARY,
+    AND,
+    OR,
+    IF_ELSE,
+    CALL
+};
+
+struct CompiledNode
+{
+    CompiledOp op;
+    // operand node indices; ARG uses a as parameter index,
+    // CALL uses a as function index and [b, b + c) as argument range
+    uint32_t a = 0, b = 0, c = 0;
+    decimal_t value = 0;
+    ScalarUnaryFunc unary = nullptr;
+    ScalarBinaryFunc binary = nullptr;
+};
+
+struct CompiledFunction
+{
+    uint32_t root;
+    uint32_t arity;
+};
+
+struct ColumnView
+{
+    const decimal_t *data;
+    size_t size;
+};
+
+class CompiledProgram
+{
+public:
+    decimal_t run(const decimal_t *args) const { return evalNode(m_funcs[0].root, args); }
+    size_t arity() const { return m_funcs[0].arity; }
+
+    void runBatch(const ColumnView *columns, size_t rows, decimal_t *out) const;
+    bool vectorizable() const { return m_funcs.size() == 1; }
+
+private:
+    decimal_t evalNode(uint32_t, const decimal_t *) const;
+    void evalBlock(const ColumnView *, size_t offset, size_t n,
+                   decimal_t *scratch, const decimal_t **slots, decimal_t *out) const;
+
+private:
+    std::vector<CompiledNode> m_nodes;
+    std::vector<uint32_t> m_callArgs;
+    std::vector<CompiledFunction> m_funcs;
+
+    friend class ProgramBuilder;
+};
+
+template <typename Sig>
+class CompiledFunc;
+
+template <typename Ret, typename... Args>
+class CompiledFunc<Ret(Args...)>
+{
+    static_assert(std::is_arithmetic_v<Ret> && (std::is_arithmetic_v<Args> && ...),
+                  "compiled functions only take and return arithmetic types");
+    static_assert(sizeof...(Args) <= COMPILED_MAX_ARITY, "too many parameters");
+
+public:
+    static constexpr size_t arity = sizeof...(Args);
+
+    CompiledFunc() = default;
+    explicit CompiledFunc(std::shared_ptr<const CompiledProgram> program)
+        : m_program(std::move(program)) {}
+
+    Ret operator()(Args... args) const
+    {
+        const decimal_t argv[arity + 1]{static_cast<decimal_t>(args)...};
+        return static_cast<Ret>(m_program->run(argv));
+    }
+
+    explicit operator bool() const { return m_program != nullptr; }
+    const std::shared_ptr<const CompiledProgram> &program() const { return m_program; }
+
+private:
+    std::shared_ptr<const CompiledProgram> m_program;
+};
+
+} // namespace eval
+
+#endif
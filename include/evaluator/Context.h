@@ -2,9 +2,16 @@
 #define EVAL_CONTEXT_H_
 
 #include <evaluator/Parser.h>
+#include <evaluator/List.h>
+#include <evaluator/Compiler.h>
+#include <evaluator/Memory.h>
+#include <evaluator/Result.h>
 #include <unordered_set>
 #include <unordered_map>
 #include <functional>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
 
 namespace eval
 {
@@ -13,8 +20,6 @@ struct VoidType
 {
 };
 
-using ListType = std::vector<decimal_t>;
-
 struct InternalFuncRet;
 
 class Context;
@@ -31,7 +36,8 @@ enum class InternalFuncRetType
 {
     DECIMAL,
     LIST,
-    LAMBDA
+    LAMBDA,
+    ERROR
 };
 struct InternalFuncRet
 {
@@ -39,55 +45,179 @@ struct InternalFuncRet
     decimal_t decimal;
     ListType list;
     LambdaType lambda;
+    EvalError error;
     InternalFuncRet(decimal_t d) : type(InternalFuncRetType::DECIMAL), decimal(d) {}
     InternalFuncRet(const ListType &l) : type(InternalFuncRetType::LIST), list(l) {}
+    InternalFuncRet(ListType &&l) : type(InternalFuncRetType::LIST), list(std::move(l)) {}
     InternalFuncRet(const LambdaType &l) : type(InternalFuncRetType::LAMBDA), lambda(l) {}
+    // builtins return errors instead of throwing where they can
+    InternalFuncRet(const EvalError &e) : type(InternalFuncRetType::ERROR), error(e) {}
 };
 
 using DataType = std::variant<VoidType, decimal_t, ListType, LambdaType>;
 using VarMap = std::unordered_map<std::string, DataType>;
 
+struct Definitions
+{
+    VarMap varMap;
+    std::shared_ptr<const Definitions> parent;
+    uint64_t version = 0;
+};
+
+class SharedDefinitions;
+class TaskScheduler;
+class Profiler;
+class BudgetState;
+class AsyncEval;
+struct EvalBudget;
+
+inline constexpr size_t PARALLEL_COST_THRESHOLD = 64;
+inline constexpr size_t PARALLEL_CALL_COST = 64;
+inline constexpr size_t PARALLEL_MAX_DEPTH = 8;
+inline constexpr size_t PARALLEL_MAP_THRESHOLD = 1024;
+
+// Purity of the lambdas named by globals, looked up by forked tasks too.
+// Copies start empty.
+struct PurityCache
+{
+    PurityCache() = default;
+    PurityCache(const PurityCache &) {}
+    PurityCache &operator=(const PurityCache &)
+    {
+        clear();
+        return *this;
+    }
+    void clear()
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        pure.clear();
+    }
+
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, bool> pure;
+};
+
 class Context
 {
 public:
+    Context() = default;
+    explicit Context(const SharedDefinitions &);
+    explicit Context(std::shared_ptr<const Definitions>);
+
+    static const std::shared_ptr<const Definitions> &builtins();
+
     void init();
     void setupInternalFunc();
+    std::shared_ptr<const Definitions> freeze() const;
+    void saveDefinitions(const std::string &) const;
+    static std::shared_ptr<const Definitions> loadDefinitions(const std::string &);
+    void saveSnapshot(const std::string &) const;
+    void loadSnapshot(const std::string &);
     DataType exec(const std::string &);
+    DataType exec(const std::string &, const EvalBudget &);
+    EvalResult<DataType> tryExec(const std::string &);
     DataType eval(std::shared_ptr<ASTNode>);
+    EvalResult<DataType> tryEval(const std::shared_ptr<ASTNode> &);
+    DataType apply(const LambdaType &, const std::vector<DataType> &);
+    EvalResult<DataType> tryApply(const LambdaType &, const std::vector<DataType> &);
+    const DataType *find(const std::string &) const;
+    // false when evaluating the AST may assign or call a builtin with side
+    // effects, directly or through the lambdas it names
+    bool isPure(const ASTNode &) const;
+    std::vector<std::string> identifiers() const;
+    // assigns a global, as `name = value` would
+    void setVar(const std::string &, DataType);
     const VarMap &varMap() const { return m_globalVarMap; }
+    const std::shared_ptr<const Definitions> &definitions() const { return m_definitions; }
     const std::shared_ptr<ASTNode> AST() const { return m_AST; }
 
-private:
-    DataType call(const LambdaType &, const std::vector<std::shared_ptr<ASTNode>> &);
+    void setParallelEval(TaskScheduler *, size_t costThreshold = PARALLEL_COST_THRESHOLD);
+    void setParallelMapThreshold(size_t threshold) { m_parallelMapThreshold = threshold; }
+    // the builtins reading or writing files fail with EVAL_FILE_ACCESS_DENIED
+    // unless enabled, so untrusted input cannot reach the filesystem
+    void setFileAccess(bool enabled) { m_fileAccess = enabled; }
+    bool fileAccess() const { return m_fileAccess; }
+
+    MemoryStats memoryStats(size_t largest = 10) const;
+    static MemoryUsage measure(const DataType &);
+
+    void setProfiling(bool);
+    Profiler *profiler() const { return m_profiler.get(); }
+
+    template <typename Sig>
+    CompiledFunc<Sig> compile(const std::string &name) const
+    {
+        return CompiledFunc<Sig>(compileProgram(name, CompiledFunc<Sig>::arity));
+    }
+    std::shared_ptr<const CompiledProgram> compileProgram(const std::string &, size_t) const;
+    std::shared_ptr<const CompiledProgram> compileExpr(const std::string &,
+                                                       const std::vector<std::string> &) const;
+    ListType evalBatch(const std::string &,
+                       const std::vector<std::string> &,
+                       const std::vector<ColumnView> &) const;
 
+private:
+    friend class AsyncEval;
+
+    static MemoryUsage measure(const DataType &, ASTRefs &, bool release);
+    EvalResult<DataType> evalNode(const std::shared_ptr<ASTNode> &);
+    EvalResult<DataType> profiledEval(const std::shared_ptr<ASTNode> &);
+    EvalResult<DataType> checkedEval(const std::shared_ptr<ASTNode> &);
+    EvalResult<DataType> call(const LambdaType &, const std::vector<std::shared_ptr<ASTNode>> &);
+
+    bool isPure(const ASTNode &, std::unordered_set<const ASTNode *> &) const;
+    bool isPure(const LambdaType &) const;
+    bool isPureGlobal(const std::string &, const LambdaType &) const;
+    std::optional<EvalError> forEachChunk(size_t, const LambdaType &,
+                                          const std::function<std::optional<EvalError>(size_t, size_t)> &);
+    bool shouldFork(const std::shared_ptr<ASTNode> &) const;
+    size_t parallelCost(const ASTNode &, size_t) const;
+    std::optional<EvalError> evalParallel(const std::vector<std::shared_ptr<ASTNode>> &, DataType *);
+
+    static EvalResult<DataType> fromInternalFuncRet(InternalFuncRet &&);
+    static std::shared_ptr<ASTNode> toAST(const DataType &);
     static std::shared_ptr<ASTNode> substitude(const std::shared_ptr<ASTNode> &,
                                                const VarMap &,
                                                std::unordered_set<std::string>);
 
-    static DataType neg(const DataType &);
-    static DataType binOp(const DataType &, const DataType &, OptrType);
+    static EvalResult<DataType> neg(const DataType &);
+    static EvalResult<DataType> binOp(const DataType &, const DataType &, OptrType);
 
     static ListType listAdd(const ListType &, decimal_t);
-    static ListType listAdd(const ListType &, const ListType &);
+    static EvalResult<ListType> listAdd(const ListType &, const ListType &);
 
     static ListType listSub(const ListType &, decimal_t);
     static ListType listSub(decimal_t, const ListType &);
-    static ListType listSub(const ListType &, const ListType &);
+    static EvalResult<ListType> listSub(const ListType &, const ListType &);
 
     static ListType listMul(const ListType &, decimal_t);
-    static ListType listMul(const ListType &, const ListType &);
+    static EvalResult<ListType> listMul(const ListType &, const ListType &);
 
     static ListType listDiv(const ListType &, decimal_t);
     static ListType listDiv(decimal_t, const ListType &);
-    static ListType listDiv(const ListType &, const ListType &);
+    static EvalResult<ListType> listDiv(const ListType &, const ListType &);
 
     static ListType listPow(const ListType &, decimal_t);
     static ListType listPow(decimal_t, const ListType &);
-    static ListType listPow(const ListType &, const ListType &);
+    static EvalResult<ListType> listPow(const ListType &, const ListType &);
 
 private:
     std::shared_ptr<ASTNode> m_AST;
     VarMap m_globalVarMap;
+    std::shared_ptr<const Definitions> m_definitions;
+    const SharedDefinitions *m_shared = nullptr;
+    TaskScheduler *m_scheduler = nullptr;
+    size_t m_parallelThreshold = PARALLEL_COST_THRESHOLD;
+    size_t m_parallelMapThreshold = PARALLEL_MAP_THRESHOLD;
+    bool m_fileAccess = false;
+    mutable PurityCache m_purity; // cleared whenever the globals change
+    std::shared_ptr<Profiler> m_profiler;
+    std::shared_ptr<BudgetState> m_budget;
+    AsyncEval *m_async = nullptr;
+    MemoryUsage m_memLive;
+    ASTRefs m_astRefs; // AST nodes counted in m_memLive
+    size_t m_memPeak = 0;
+    size_t m_memAllocations = 0;
 };
 } // namespace eval
 
@@ -0,0 +1,46 @@
+#ifndef EVAL_COROUTINE_H_
+#define EVAL_COROUTINE_H_
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+
+namespace eval
+{
+
+// Stackful coroutine running a function on its own stack (ucontext on POSIX,
+// fibers on Windows). resume() switches into it until the body calls yield()
+// or returns; exceptions escaping the body are rethrown by resume(). It must
+// always be resumed on the thread that first resumed it. On POSIX the stack is
+// mapped with an inaccessible guard page below it, so an overflow faults
+// instead of overwriting other memory.
+class Coroutine
+{
+public:
+    Coroutine(std::function<void()> body, size_t stackSize);
+    ~Coroutine();
+
+    Coroutine(const Coroutine &) = delete;
+    Coroutine &operator=(const Coroutine &) = delete;
+
+    // returns false once the body has finished
+    bool resume();
+    void yield();
+    bool finished() const;
+    // bytes left below the stack pointer when called from the body, SIZE_MAX
+    // when called from another stack
+    size_t stackLeft() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+// bytes left below the stack pointer on the stack the caller runs on, that of
+// the running Coroutine or of the thread, SIZE_MAX when its limits are unknown
+size_t currentStackLeft();
+
+} // namespace eval
+
+#endif
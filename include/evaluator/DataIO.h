@@ -0,0 +1,55 @@
+#ifndef EVAL_DATA_IO_H_
+#define EVAL_DATA_IO_H_
+
+#include <evaluator/Context.h>
+
+#include <functional>
+#include <string>
+
+namespace eval
+{
+
+class TaskScheduler;
+
+// files are parsed in chunks of this size, one task each
+inline constexpr size_t CSV_CHUNK_SIZE = 1 << 20;
+// foldCsv reads and parses the file in blocks of this size
+inline constexpr size_t CSV_BLOCK_SIZE = 1 << 24;
+
+// Column of a CSV file, by header name when `name` is set, otherwise by
+// zero-based index. Without a name, a first line whose field is not a number
+// is taken as a header and skipped.
+struct CsvColumn
+{
+    std::string name;
+    size_t index = 0;
+};
+
+// Raw little-endian float64 array. On little-endian hosts the list is a
+// read-only view of the mapped file, so loading does not copy; the file must
+// not be truncated while the list is alive. Throws EVAL_FILE_NOT_READABLE, or
+// EVAL_FILE_MALFORMED if the size is not a multiple of 8.
+ListType loadF64(const std::string &path);
+
+// JSON array of numbers, parsed from the mapped file without building JSON
+// nodes. null elements become NaN, and saveJson writes non-finite values as
+// null. Malformed files throw EVAL_FILE_MALFORMED.
+ListType loadJson(const std::string &path);
+void saveJson(const std::string &path, const ListType &);
+
+// One column of a comma-separated file. Fields may be quoted but must not
+// contain line breaks; empty fields are NaN, other non-numeric fields and
+// missing columns throw EVAL_FILE_MALFORMED. Lines are counted and then parsed
+// chunk by chunk with std::from_chars, in parallel when a scheduler is given,
+// into a list allocated once.
+ListType loadCsv(const std::string &path, const CsvColumn &, TaskScheduler * = nullptr);
+// Streams the column through `consume` in file order, one block of values at
+// a time, reading at most CSV_BLOCK_SIZE bytes at once, so memory use does not
+// depend on the file size. Returning false from `consume` stops the fold.
+void foldCsv(const std::string &path, const CsvColumn &,
+             const std::function<bool(const decimal_t *, size_t)> &consume,
+             TaskScheduler * = nullptr);
+
+} // namespace eval
+
+#endif
@@ -22,6 +22,17 @@ enum EvalErrCode
     EVAL_WRONG_OPERAND_TYPE,
     EVAL_DIFFERENT_LIST_LENGTHS,
     EVAL_WRONG_PARAMETER_TYPE,
+    EVAL_NOT_COMPILABLE,
+    EVAL_STEP_LIMIT_EXCEEDED,
+    EVAL_TIME_LIMIT_EXCEEDED,
+    EVAL_MEMORY_LIMIT_EXCEEDED,
+    EVAL_RECURSION_LIMIT_EXCEEDED,
+    EVAL_CANCELLED,
+    EVAL_FILE_NOT_READABLE,
+    EVAL_FILE_NOT_WRITABLE,
+    EVAL_IMAGE_INVALID,
+    EVAL_FILE_MALFORMED,
+    EVAL_FILE_ACCESS_DENIED,
 };
 
 inline const std::string EvalErrMsg[]{
@@ -37,23 +48,54 @@ inline const std::string EvalErrMsg[]{
     "runtime error: wrong operand type",
     "runtime error: different list lengths",
     "runtime error: wrong parameter type",
+    "compile error: expression not compilable",
+    "budget error: step limit exceeded",
+    "budget error: time limit exceeded",
+    "budget error: memory limit exceeded",
+    "budget error: recursion limit exceeded",
+    "runtime error: evaluation cancelled",
+    "io error: cannot read file",
+    "io error: cannot write file",
+    "image error: invalid or incompatible file",
+    "io error: malformed file contents",
+    "io error: file access disabled",
+};
+
+inline constexpr size_t EVAL_NO_POS = static_cast<size_t>(-1);
+
+// stack kept free below the deepest parse or evaluation for builtins and
+// unwinding, deeper nesting fails with EVAL_RECURSION_LIMIT_EXCEEDED
+inline constexpr size_t EVAL_STACK_MARGIN = 128 << 10;
+
+// error code and offset into the source text the failing token or AST node
+// came from, EVAL_NO_POS when unknown
+struct EvalError
+{
+    EvalErrCode code;
+    size_t pos = EVAL_NO_POS;
+
+    const char *what() const { return EvalErrMsg[static_cast<size_t>(code)].c_str(); }
 };
 
 class EvalExcept
 {
 private:
-    std::string m_whatStr;
-    EvalErrCode m_code;
+    EvalError m_error;
 
 public:
-    EvalExcept(const EvalErrCode &err)
-        : m_code(err)
+    EvalExcept(const EvalErrCode &err, size_t pos = EVAL_NO_POS)
+        : m_error{err, pos}
+    {
+    }
+    EvalExcept(const EvalError &err)
+        : m_error(err)
     {
-        m_whatStr = EvalErrMsg[static_cast<size_t>(err)];
     }
 
-    const char *what() const throw() { return m_whatStr.c_str(); }
-    EvalErrCode code() const throw() { return m_code; }
+    const char *what() const throw() { return m_error.what(); }
+    EvalErrCode code() const throw() { return m_error.code; }
+    size_t pos() const throw() { return m_error.pos; }
+    const EvalError &error() const throw() { return m_error; }
 };
 
 } // namespace eval
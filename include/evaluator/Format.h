@@ -0,0 +1,32 @@
+#ifndef EVAL_FORMAT_H_
+#define EVAL_FORMAT_H_
+
+#include <evaluator/EvalDefs.h>
+#include <evaluator/Context.h>
+
+#include <string>
+#include <vector>
+
+namespace eval
+{
+
+// enough for the shortest form of any double, e.g. -2.2250738585072014e-308
+inline constexpr size_t DECIMAL_CHARS_MAX = 32;
+
+// Shortest representation that parses back to the same value, independent of
+// the locale. Based on std::to_chars, which is Ryu-based in the common
+// standard libraries. Returns the end of the written characters.
+char *formatDecimal(char *first, decimal_t);
+
+// append to a reusable buffer, lists are written as [a, b, c]
+void appendDecimal(std::string &, decimal_t);
+void appendList(std::string &, const ListType &);
+
+// results as printed by the eval app, without a trailing newline; lambdas are
+// shown as their signature unless printAST is set
+void appendValue(std::string &, const DataType &, bool printAST = false);
+void appendError(std::string &, const EvalError &);
+
+} // namespace eval
+
+#endif
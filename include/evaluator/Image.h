@@ -0,0 +1,34 @@
+#ifndef EVAL_IMAGE_H_
+#define EVAL_IMAGE_H_
+
+#include <evaluator/Context.h>
+
+#include <cstdint>
+#include <string>
+
+namespace eval
+{
+
+inline constexpr uint32_t IMAGE_VERSION = 1;
+// alignment of the list blocks inside an image
+inline constexpr size_t IMAGE_ALIGN = 64;
+
+// Binary image of variables. It holds an interned symbol table, the AST nodes
+// of lambda bodies as flat records referring to each other by index (shared
+// subtrees are stored once), and lists as raw float64 blocks. All references
+// are offsets or indices, so the file is position-independent and is read
+// through a read-only mapping without a parse step. Builtins are stored by
+// name and resolved against Context::builtins() when loaded. The file is
+// written next to the target and renamed over it, so processes mapping the
+// old file are unaffected.
+void writeImage(const std::string &path, const VarMap &);
+
+// Lists are returned as views of the mapping, which stays alive until the last
+// of them is released or modified. Throws EVAL_FILE_NOT_READABLE, or
+// EVAL_IMAGE_INVALID for files of another version or byte order and for
+// malformed contents.
+VarMap readImage(const std::string &path);
+
+} // namespace eval
+
+#endif
@@ -40,6 +40,9 @@ INTERNAL_FUNC_DECL(lt);
 INTERNAL_FUNC_DECL(geq);
 INTERNAL_FUNC_DECL(leq);
 
+ScalarUnaryFunc scalarUnaryFunc(const std::string &);
+ScalarBinaryFunc scalarBinaryFunc(const std::string &);
+
 } // namespace eval
 
 #endif
\ No newline at end of file
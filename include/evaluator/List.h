@@ -0,0 +1,161 @@
+#ifndef EVAL_LIST_H_
+#define EVAL_LIST_H_
+
+#include <evaluator/EvalDefs.h>
+
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace eval
+{
+
+// List of decimals with value semantics. It either owns its elements or is a
+// read-only view of memory kept alive by `owner`, e.g. a block of a mapped
+// image. Copying a view only copies the reference; the first mutable access
+// copies the elements into owned storage. Const accessors never copy, so a
+// view may be read from several threads.
+class ListType
+{
+public:
+    using value_type = decimal_t;
+    using size_type = size_t;
+    using iterator = decimal_t *;
+    using const_iterator = const decimal_t *;
+
+    ListType() = default;
+    explicit ListType(size_t n, decimal_t v = 0) : m_vec(n, v) { sync(); }
+    ListType(std::initializer_list<decimal_t> l) : m_vec(l) { sync(); }
+    ListType(std::vector<decimal_t> v) : m_vec(std::move(v)) { sync(); }
+    template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+    ListType(It first, It last) : m_vec(first, last) { sync(); }
+    ListType(const decimal_t *data, size_t size, std::shared_ptr<const void> owner)
+        : m_owner(std::move(owner)), m_data(data), m_size(size) {}
+
+    ListType(const ListType &other)
+        : m_vec(other.m_owner ? std::vector<decimal_t>() : other.m_vec), m_owner(other.m_owner)
+    {
+        if (m_owner)
+        {
+            m_data = other.m_data;
+            m_size = other.m_size;
+        }
+        else
+            sync();
+    }
+    ListType(ListType &&other) noexcept
+        : m_vec(std::move(other.m_vec)), m_owner(std::move(other.m_owner)),
+          m_data(other.m_data), m_size(other.m_size)
+    {
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    ListType &operator=(const ListType &other)
+    {
+        if (this != &other)
+            *this = ListType(other);
+        return *this;
+    }
+    ListType &operator=(ListType &&other) noexcept
+    {
+        if (this == &other)
+            return *this;
+        m_vec = std::move(other.m_vec);
+        m_owner = std::move(other.m_owner);
+        m_data = other.m_data;
+        m_size = other.m_size;
+        other.m_vec.clear();
+        other.m_data = nullptr;
+        other.m_size = 0;
+        return *this;
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    // elements allocated on the heap, 0 for views
+    size_t capacity() const { return m_owner ? 0 : m_vec.capacity(); }
+    bool isView() const { return m_owner != nullptr; }
+    const std::shared_ptr<const void> &owner() const { return m_owner; }
+
+    const decimal_t *data() const { return m_data; }
+    const decimal_t &operator[](size_t i) const { return m_data[i]; }
+    const_iterator begin() const { return m_data; }
+    const_iterator end() const { return m_data + m_size; }
+    const decimal_t &front() const { return m_data[0]; }
+    const decimal_t &back() const { return m_data[m_size - 1]; }
+
+    decimal_t *data()
+    {
+        own();
+        return m_vec.data();
+    }
+    decimal_t &operator[](size_t i)
+    {
+        own();
+        return m_vec[i];
+    }
+    iterator begin() { return data(); }
+    iterator end() { return data() + m_size; }
+    decimal_t &front() { return data()[0]; }
+    decimal_t &back() { return data()[m_size - 1]; }
+
+    void reserve(size_t n)
+    {
+        own();
+        m_vec.reserve(n);
+        sync();
+    }
+    void resize(size_t n, decimal_t v = 0)
+    {
+        own();
+        m_vec.resize(n, v);
+        sync();
+    }
+    void clear()
+    {
+        m_owner.reset();
+        m_vec.clear();
+        sync();
+    }
+    void push_back(decimal_t v)
+    {
+        own();
+        m_vec.push_back(v);
+        sync();
+    }
+    template <typename It>
+    iterator insert(const_iterator pos, It first, It last)
+    {
+        size_t at = pos - m_data;
+        own();
+        m_vec.insert(m_vec.begin() + at, first, last);
+        sync();
+        return m_vec.data() + at;
+    }
+
+private:
+    void sync()
+    {
+        m_data = m_vec.data();
+        m_size = m_vec.size();
+    }
+    void own()
+    {
+        if (m_owner == nullptr)
+            return;
+        m_vec.assign(m_data, m_data + m_size);
+        m_owner.reset();
+        sync();
+    }
+
+private:
+    std::vector<decimal_t> m_vec;
+    std::shared_ptr<const void> m_owner;
+    const decimal_t *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace eval
+
+#endif
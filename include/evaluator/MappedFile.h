@@ -0,0 +1,36 @@
+#ifndef EVAL_MAPPED_FILE_H_
+#define EVAL_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace eval
+{
+
+// Read-only mapping of a whole file (mmap on POSIX, a file mapping view on
+// Windows). Pages are loaded lazily by the OS and shared with other processes
+// mapping the same file. Throws EvalExcept(EVAL_FILE_NOT_READABLE) on failure.
+class MappedFile
+{
+public:
+    static std::shared_ptr<const MappedFile> open(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    MappedFile() = default;
+
+private:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace eval
+
+#endif
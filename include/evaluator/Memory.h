@@ -0,0 +1,59 @@
+#ifndef EVAL_MEMORY_H_
+#define EVAL_MEMORY_H_
+
+#include <evaluator/EvalDefs.h>
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace eval
+{
+
+struct ASTNode;
+
+// references to AST nodes from measured values, by node address
+using ASTRefs = std::unordered_map<const ASTNode *, size_t>;
+
+// Approximate heap usage of values, counting the payload of lists, AST nodes
+// (including their control blocks, child arrays and malloc block overhead),
+// lambdas and heap-allocated strings. An AST node reachable from several
+// values, or several times from one, is counted once.
+struct MemoryUsage
+{
+    size_t listBytes = 0;
+    size_t astBytes = 0;
+    size_t lambdaBytes = 0;
+    size_t stringBytes = 0;
+    // lists viewing a mapped image, not part of the total
+    size_t mappedBytes = 0;
+
+    size_t lists = 0;
+    size_t astNodes = 0;
+    size_t lambdas = 0;
+    size_t strings = 0;
+
+    size_t totalBytes() const { return listBytes + astBytes + lambdaBytes + stringBytes; }
+
+    MemoryUsage &operator+=(const MemoryUsage &);
+    MemoryUsage &operator-=(const MemoryUsage &);
+
+    void addString(const std::string &);
+    // counts the nodes that were not referenced yet
+    void addAST(const ASTNode &, ASTRefs &);
+    // counts the nodes that are no longer referenced
+    void releaseAST(const ASTNode &, ASTRefs &);
+};
+
+struct MemoryStats
+{
+    MemoryUsage live;
+    size_t peakBytes = 0;
+    size_t allocations = 0;
+    std::vector<std::pair<std::string, size_t>> largestVars;
+};
+
+} // namespace eval
+
+#endif
@@ -1,7 +1,7 @@
 #ifndef EVAL_OPERATORS_INL_
 #define EVAL_OPERATORS_INL_
 
-DataType Context::neg(const DataType &d)
+EvalResult<DataType> Context::neg(const DataType &d)
 {
     if (d.index() == 1)
         return -std::get<1>(d);
@@ -12,7 +12,7 @@ DataType Context::neg(const DataType &d)
             x = -x;
         return ret;
     }
-    throw EvalExcept(EVAL_WRONG_OPERAND_TYPE);
+    return EvalError{EVAL_WRONG_OPERAND_TYPE};
 }
 
 ListType Context::listAdd(const ListType &l, decimal_t d)
@@ -22,13 +22,14 @@ ListType Context::listAdd(const ListType &l, decimal_t d)
         x += d;
     return ret;
 }
-ListType Context::listAdd(const ListType &l1, const ListType &l2)
+EvalResult<ListType> Context::listAdd(const ListType &l1, const ListType &l2)
 {
     if (l1.size() != l2.size())
-        throw EvalExcept(EVAL_DIFFERENT_LIST_LENGTHS);
+        return EvalError{EVAL_DIFFERENT_LIST_LENGTHS};
     auto ret = l1;
+    auto r = ret.data();
     for (size_t i = 0; i < ret.size(); ++i)
-        ret[i] += l2[i];
+        r[i] += l2[i];
     return ret;
 }
 
@@ -46,13 +47,14 @@ ListType Context::listSub(decimal_t d, const ListType &l)
         x = d - x;
     return ret;
 }
-ListType Context::listSub(const ListType &l1, const ListType &l2)
+EvalResult<ListType> Context::listSub(const ListType &l1, const ListType &l2)
 {
     if (l1.size() != l2.size())
-        throw EvalExcept(EVAL_DIFFERENT_LIST_LENGTHS);
+        return EvalError{EVAL_DIFFERENT_LIST_LENGTHS};
     auto ret = l1;
+    auto r = ret.data();
     for (size_t i = 0; i < ret.size(); ++i)
-        ret[i] -= l2[i];
+        r[i] -= l2[i];
     return ret;
 }
 
@@ -63,13 +65,14 @@ ListType Context::listMul(const ListType &l, decimal_t d)
         x *= d;
     return ret;
 }
-ListType Context::listMul(const ListType &l1, const ListType &l2)
+EvalResult<ListType> Context::listMul(const ListType &l1, const ListType &l2)
 {
     if (l1.size() != l2.size())
-        throw EvalExcept(EVAL_DIFFERENT_LIST_LENGTHS);
+        return EvalError{EVAL_DIFFERENT_LIST_LENGTHS};
     auto ret = l1;
+    auto r = ret.data();
     for (size_t i = 0; i < ret.size(); ++i)
-        ret[i] *= l2[i];
+        r[i] *= l2[i];
     return ret;
 }
 
@@ -88,13 +91,14 @@ ListType Context::listDiv(decimal_t d, const ListType &l)
         x = d / x;
     return ret;
 }
-ListType Context::listDiv(const ListType &l1, const ListType &l2)
+EvalResult<ListType> Context::listDiv(const ListType &l1, const ListType &l2)
 {
     if (l1.size() != l2.size())
-        throw EvalExcept(EVAL_DIFFERENT_LIST_LENGTHS);
+        return EvalError{EVAL_DIFFERENT_LIST_LENGTHS};
     auto ret = l1;
+    auto r = ret.data();
     for (size_t i = 0; i < ret.size(); ++i)
-        ret[i] /= l2[i];
+        r[i] /= l2[i];
     return ret;
 }
 
@@ -112,18 +116,23 @@ ListType Context::listPow(decimal_t d, const ListType &l)
         x = std::pow(d, x);
     return ret;
 }
-ListType Context::listPow(const ListType &l1, const ListType &l2)
+EvalResult<ListType> Context::listPow(const ListType &l1, const ListType &l2)
 {
     if (l1.size() != l2.size())
-        throw EvalExcept(EVAL_DIFFERENT_LIST_LENGTHS);
+        return EvalError{EVAL_DIFFERENT_LIST_LENGTHS};
     auto ret = l1;
+    auto r = ret.data();
     for (size_t i = 0; i < ret.size(); ++i)
-        ret[i] = std::pow(ret[i], l2[i]);
+        r[i] = std::pow(r[i], l2[i]);
     return ret;
 }
 
-DataType Context::binOp(const DataType &d1, const DataType &d2, OptrType op)
+EvalResult<DataType> Context::binOp(const DataType &d1, const DataType &d2, OptrType op)
 {
+    static const char *const kernelNames[]{"listAdd", "listSub", "listMul", "listDiv", "listPow"};
+    TraceSpan span(kernelNames[static_cast<size_t>(op) - static_cast<size_t>(OptrType::ADD)],
+                   (d1.index() == 2 && std::get<2>(d1).size() >= TRACE_MIN_LIST_SIZE) ||
+                       (d2.index() == 2 && std::get<2>(d2).size() >= TRACE_MIN_LIST_SIZE));
     switch (op)
     {
     case OptrType::ADD:
@@ -136,7 +145,7 @@ DataType Context::binOp(const DataType &d1, const DataType &d2, OptrType op)
             return listAdd(std::get<2>(d2), std::get<1>(d1));
         if (d1.index() == 2 && d2.index() == 2)
             return listAdd(std::get<2>(d1), std::get<2>(d2));
-        throw EvalExcept(EVAL_WRONG_OPERAND_TYPE);
+        return EvalError{EVAL_WRONG_OPERAND_TYPE};
     }
     break;
     case OptrType::SUB:
@@ -149,7 +158,7 @@ DataType Context::binOp(const DataType &d1, const DataType &d2, OptrType op)
             return listSub(std::get<1>(d1), std::get<2>(d2));
         if (d1.index() == 2 && d2.index() == 2)
             return listSub(std::get<2>(d1), std::get<2>(d2));
-        throw EvalExcept(EVAL_WRONG_OPERAND_TYPE);
+        return EvalError{EVAL_WRONG_OPERAND_TYPE};
     }
     break;
     case OptrType::MUL:
@@ -162,7 +171,7 @@ DataType Context::binOp(const DataType &d1, const DataType &d2, OptrType op)
             return listMul(std::get<2>(d2), std::get<1>(d1));
         if (d1.index() == 2 && d2.index() == 2)
             return listMul(std::get<2>(d1), std::get<2>(d2));
-        throw EvalExcept(EVAL_WRONG_OPERAND_TYPE);
+        return EvalError{EVAL_WRONG_OPERAND_TYPE};
     }
     break;
     case OptrType::DIV:
@@ -175,7 +184,7 @@ DataType Context::binOp(const DataType &d1, const DataType &d2, OptrType op)
             return listDiv(std::get<1>(d1), std::get<2>(d2));
         if (d1.index() == 2 && d2.index() == 2)
             return listDiv(std::get<2>(d1), std::get<2>(d2));
-        throw EvalExcept(EVAL_WRONG_OPERAND_TYPE);
+        return EvalError{EVAL_WRONG_OPERAND_TYPE};
     }
     break;
     case OptrType::POW:
@@ -188,7 +197,7 @@ DataType Context::binOp(const DataType &d1, const DataType &d2, OptrType op)
             return listPow(std::get<1>(d1), std::get<2>(d2));
         if (d1.index() == 2 && d2.index() == 2)
             return listPow(std::get<2>(d1), std::get<2>(d2));
-        throw EvalExcept(EVAL_WRONG_OPERAND_TYPE);
+        return EvalError{EVAL_WRONG_OPERAND_TYPE};
     }
     break;
     default:
@@ -7,12 +7,20 @@
 namespace eval
 {
 
+// nesting levels of the deepest AST a parse may build, which bounds the
+// recursion of everything walking it
+inline constexpr size_t PARSE_MAX_DEPTH = 4096;
+
 class Parser
 {
 public:
+    EvalResult<std::shared_ptr<ASTNode>> tryParse(const TokenList &);
     std::shared_ptr<ASTNode> parse(const TokenList &);
 
 private:
+    void advance();
+    bool nest();
+
     bool parseAssign(std::shared_ptr<ASTNode> &);
     bool parseExpr(std::shared_ptr<ASTNode> &);
 
@@ -30,6 +38,10 @@ private:
 private:
     TokenList::const_iterator m_pos;
     TokenList::const_iterator m_end;
+    TokenList::const_iterator m_furthest;
+    size_t m_depth = 0;
+    bool m_tooDeep = false;
+    size_t m_tooDeepPos = EVAL_NO_POS;
 };
 
 } // namespace eval
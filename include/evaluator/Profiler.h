@@ -0,0 +1,75 @@
+#ifndef EVAL_PROFILER_H_
+#define EVAL_PROFILER_H_
+
+#include <evaluator/EvalDefs.h>
+#include <evaluator/AST.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace eval
+{
+
+struct ProfileEntry
+{
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t selfNs = 0;
+    uint64_t listBytes = 0;
+
+    JsonNode toJson() const;
+};
+
+class Profiler
+{
+public:
+    // timing of one evaluated node; the time spent in nested scopes on the
+    // same thread is excluded from self time
+    class Scope
+    {
+    public:
+        Scope(Profiler &, OptrType, std::string func = {}, bool builtin = false);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        void addListBytes(size_t bytes) { m_listBytes += bytes; }
+
+        // innermost scope of the calling thread, swapped out by coroutines
+        static Scope *exchangeCurrent(Scope *);
+
+    private:
+        friend class Profiler;
+
+        Profiler &m_profiler;
+        OptrType m_optr;
+        std::string m_func;
+        bool m_builtin;
+        uint64_t m_childNs = 0;
+        uint64_t m_listBytes = 0;
+        Scope *m_parent;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    void clear();
+    JsonNode toJson() const;
+    std::string report() const;
+
+private:
+    void record(const Scope &, uint64_t totalNs, uint64_t selfNs);
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, ProfileEntry> m_optrs;
+    std::unordered_map<std::string, ProfileEntry> m_builtins;
+    std::unordered_map<std::string, ProfileEntry> m_lambdas;
+};
+
+const char *optrName(OptrType);
+
+} // namespace eval
+
+#endif
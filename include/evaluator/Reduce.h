@@ -0,0 +1,49 @@
+#ifndef EVAL_REDUCE_H_
+#define EVAL_REDUCE_H_
+
+#include <evaluator/List.h>
+
+namespace eval
+{
+
+class TaskScheduler;
+
+// lists are reduced and scanned in blocks of this many elements, one task each
+inline constexpr size_t REDUCE_BLOCK_SIZE = 1 << 14;
+// shorter lists are reduced on the calling thread
+inline constexpr size_t REDUCE_PARALLEL_THRESHOLD = 1 << 16;
+// independent accumulators per block, kept in vector registers
+inline constexpr size_t REDUCE_LANES = 8;
+
+// Reductions over whole lists. Each block is reduced in REDUCE_LANES lanes and
+// the block results are combined pairwise in index order. Block boundaries
+// only depend on the length, so the result is the same with or without a
+// scheduler and whatever its number of threads. Sums use compensated
+// summation within blocks. min and max propagate NaN, and empty lists give
+// NaN except for sum (0) and prod (1).
+decimal_t listSum(const ListType &, TaskScheduler * = nullptr);
+decimal_t listProd(const ListType &, TaskScheduler * = nullptr);
+decimal_t listMin(const ListType &, TaskScheduler * = nullptr);
+decimal_t listMax(const ListType &, TaskScheduler * = nullptr);
+decimal_t listMean(const ListType &, TaskScheduler * = nullptr);
+// sample variance, two passes around the mean
+decimal_t listVariance(const ListType &, TaskScheduler * = nullptr);
+// Euclidean norm
+decimal_t listNorm(const ListType &, TaskScheduler * = nullptr);
+// throws EVAL_DIFFERENT_LIST_LENGTHS
+decimal_t listDot(const ListType &, const ListType &, TaskScheduler * = nullptr);
+
+// Inclusive scans, one output per element, computed per block with the
+// vector scanned in registers and the carry of the previous blocks applied in
+// a second pass. Long lists run both passes on the scheduler, with the same
+// result as serially. cummax and cummin are NaN from the first NaN on.
+ListType listCumsum(const ListType &, TaskScheduler * = nullptr);
+ListType listCumprod(const ListType &, TaskScheduler * = nullptr);
+ListType listCummax(const ListType &, TaskScheduler * = nullptr);
+ListType listCummin(const ListType &, TaskScheduler * = nullptr);
+// x[i + 1] - x[i], one element shorter than the list
+ListType listDiff(const ListType &, TaskScheduler * = nullptr);
+
+} // namespace eval
+
+#endif
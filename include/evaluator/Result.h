@@ -0,0 +1,68 @@
+#ifndef EVAL_RESULT_H_
+#define EVAL_RESULT_H_
+
+#include <evaluator/EvalDefs.h>
+
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace eval
+{
+
+// Value or EvalError, used instead of exceptions on paths where failures are
+// expected to be frequent.
+template <typename T>
+class EvalResult
+{
+public:
+    template <typename U,
+              typename = std::enable_if_t<!std::is_same_v<std::decay_t<U>, EvalError> &&
+                                          !std::is_same_v<std::decay_t<U>, EvalResult> &&
+                                          std::is_constructible_v<T, U &&>>>
+    EvalResult(U &&value) : m_value(std::in_place_index<0>, std::forward<U>(value))
+    {
+    }
+    EvalResult(const EvalError &err) : m_value(std::in_place_index<1>, err) {}
+    // the value or error of a result of a type convertible to T
+    template <typename U,
+              typename = std::enable_if_t<!std::is_same_v<U, T> && std::is_constructible_v<T, U &&>>>
+    EvalResult(EvalResult<U> &&other)
+        : m_value(other ? std::variant<T, EvalError>(std::in_place_index<0>, std::move(*other))
+                        : std::variant<T, EvalError>(std::in_place_index<1>, other.error()))
+    {
+    }
+
+    bool ok() const { return m_value.index() == 0; }
+    explicit operator bool() const { return ok(); }
+
+    T &operator*() & { return std::get<0>(m_value); }
+    const T &operator*() const & { return std::get<0>(m_value); }
+    T &&operator*() && { return std::get<0>(std::move(m_value)); }
+    T *operator->() { return &std::get<0>(m_value); }
+    const T *operator->() const { return &std::get<0>(m_value); }
+
+    EvalError &error() { return std::get<1>(m_value); }
+    const EvalError &error() const { return std::get<1>(m_value); }
+
+    T valueOrThrow() &&
+    {
+        if (!ok())
+            throw EvalExcept(error());
+        return std::get<0>(std::move(m_value));
+    }
+
+private:
+    std::variant<T, EvalError> m_value;
+};
+
+// evaluates expr into a new variable, returning its error from the enclosing
+// function on failure
+#define EVAL_TRY(var, expr)             \
+    auto var = (expr);                  \
+    if (!var)                           \
+        return std::move(var.error())
+
+} // namespace eval
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef EVAL_ROLLING_H_
+#define EVAL_ROLLING_H_
+
+#include <evaluator/List.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace eval
+{
+
+enum class RollingOp
+{
+    SUM,
+    MEAN,
+    MIN,
+    MAX,
+    VAR,
+    STD
+};
+
+// Aggregate over a sliding window of a stream. Values are pushed chunk by
+// chunk and one result is appended per complete window, so the output of a
+// series of n values has n - window + 1 elements whatever the chunking. Only
+// the last `window` values are kept. Every value costs O(1) amortized: sums
+// are updated with compensation, min and max use a monotonic deque and the
+// (sample) variance uses Welford's update for adding and removing values.
+// Non-finite values are counted instead of entering that state, which they
+// would corrupt for the rest of the series: a window holding NaN yields NaN,
+// infinities give what summing the window would, and results are exact again
+// once they have left the window.
+class RollingWindow
+{
+public:
+    RollingWindow(RollingOp, size_t window);
+
+    void push(const decimal_t *values, size_t n, ListType &out);
+    void reset();
+
+private:
+    void add(decimal_t x, decimal_t old);
+    void count(decimal_t nonFinite, int delta);
+    decimal_t sum() const;
+
+private:
+    RollingOp m_op;
+    size_t m_window;
+    std::vector<decimal_t> m_ring;
+    uint64_t m_count = 0;
+    // finite values in the window, and the others by kind
+    uint64_t m_finite = 0;
+    uint64_t m_nan = 0, m_posInf = 0, m_negInf = 0;
+
+    decimal_t m_sum = 0, m_compensation = 0;
+    decimal_t m_mean = 0, m_m2 = 0;
+    std::deque<std::pair<uint64_t, decimal_t>> m_extremes;
+};
+
+// Exponentially weighted moving average y[0] = x[0],
+// y[i] = alpha * x[i] + (1 - alpha) * y[i - 1], one output per input.
+class Ewma
+{
+public:
+    explicit Ewma(decimal_t alpha) : m_alpha(alpha) {}
+
+    void push(const decimal_t *values, size_t n, ListType &out);
+    void reset() { m_started = false; }
+
+private:
+    decimal_t m_alpha;
+    decimal_t m_value = 0;
+    bool m_started = false;
+};
+
+} // namespace eval
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef EVAL_SCHEDULER_H_
+#define EVAL_SCHEDULER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eval
+{
+
+class TaskScheduler
+{
+public:
+    struct Task
+    {
+        std::function<void()> func;
+        std::atomic<bool> done{false};
+        bool detached = false;
+        // exception escaping func, rethrown by wait() or handed to onError
+        std::exception_ptr error;
+        std::function<void(std::exception_ptr)> onError;
+    };
+
+    explicit TaskScheduler(size_t threadCount = 0);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler &) = delete;
+    TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+    size_t threadCount() const { return m_workers.size(); }
+
+    void spawn(Task &);
+    // Runs other fork-join tasks while the task is pending and sleeps when
+    // there are none. Detached tasks are left to the workers, so waiting never
+    // runs an unrelated long job. Rethrows the exception of the task.
+    void wait(Task &);
+    // Runs func on the pool without a handle to wait on. An exception escaping
+    // func is passed to onError, or dropped without one; it never reaches the
+    // worker thread.
+    void post(std::function<void()> func, std::function<void(std::exception_ptr)> onError = nullptr);
+
+    // runs f(0), ..., f(n - 1) as a fork-join group; the caller runs f(0) and
+    // helps with other tasks while waiting. The exception of the lowest index
+    // is rethrown, which matches what a serial loop would report.
+    template <typename Func>
+    void parallelFor(size_t n, Func &&f);
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Task *> tasks;
+    };
+
+    Task *findTask(size_t self, bool joinableOnly);
+    Task *take(WorkerQueue &, bool fromBack, bool joinableOnly);
+    void run(Task *);
+    void workerLoop(size_t);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues; // one per worker, the last one is shared by external threads
+    std::atomic<size_t> m_pending{0};
+    std::atomic<size_t> m_pendingJoinable{0};
+    std::atomic<bool> m_stop{false};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCv; // idle workers
+    std::condition_variable m_waitCv;  // threads in wait()
+};
+
+template <typename Func>
+void TaskScheduler::parallelFor(size_t n, Func &&f)
+{
+    if (n == 0)
+        return;
+    std::vector<std::exception_ptr> errors(n);
+    std::unique_ptr<Task[]> tasks(new Task[n]);
+    for (size_t i = n - 1; i > 0; --i)
+    {
+        tasks[i].func = [&, i]
+        {
+            try
+            {
+                f(i);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        };
+        spawn(tasks[i]);
+    }
+    try
+    {
+        f(0);
+    }
+    catch (...)
+    {
+        errors[0] = std::current_exception();
+    }
+    for (size_t i = 1; i < n; ++i)
+        wait(tasks[i]);
+    for (auto &e : errors)
+        if (e)
+            std::rethrow_exception(e);
+}
+
+} // namespace eval
+
+#endif
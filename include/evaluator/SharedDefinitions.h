@@ -0,0 +1,41 @@
+#ifndef EVAL_SHARED_DEFINITIONS_H_
+#define EVAL_SHARED_DEFINITIONS_H_
+
+#include <evaluator/Context.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace eval
+{
+
+// Definitions shared by many per-thread Contexts. Readers grab the current
+// immutable snapshot; writers build a new one and publish it atomically, old
+// snapshots stay alive until the last Context using them moves on.
+class SharedDefinitions
+{
+public:
+    SharedDefinitions();
+    explicit SharedDefinitions(std::shared_ptr<const Definitions>);
+
+    SharedDefinitions(const SharedDefinitions &) = delete;
+    SharedDefinitions &operator=(const SharedDefinitions &) = delete;
+
+    std::shared_ptr<const Definitions> snapshot() const { return std::atomic_load(&m_current); }
+    uint64_t version() const { return m_version.load(std::memory_order_acquire); }
+
+    void define(const std::string &);
+    void define(const std::vector<std::string> &);
+
+private:
+    void publish(std::shared_ptr<Definitions>);
+
+private:
+    std::shared_ptr<const Definitions> m_current;
+    std::atomic<uint64_t> m_version{0};
+    std::mutex m_writeMutex;
+};
+
+} // namespace eval
+
+#endif
@@ -2,8 +2,10 @@
 #define EVAL_TOKENIZER_H_
 
 #include <evaluator/EvalDefs.h>
+#include <evaluator/Result.h>
 
 #include <cassert>
+#include <cstdlib>
 #include <string>
 #include <variant>
 #include <vector>
@@ -18,6 +20,7 @@ enum class TokenType
 {
     DECIMAL,
     IDENT,
+    STRING, // "..."
 
     ADD, // +
     SUB, // -
@@ -42,6 +45,7 @@ enum class TokenType
 inline std::unordered_map<TokenType, std::string> tokenRepr{
     {TokenType::DECIMAL, "DECIMAL"},
     {TokenType::IDENT, "IDENT"},
+    {TokenType::STRING, "STRING"},
     {TokenType::ADD, "ADD"},
     {TokenType::SUB, "SUB"},
     {TokenType::MUL, "MUL"},
@@ -63,10 +67,12 @@ struct Token
 {
     TokenType type;
     std::variant<decimal_t, std::string> value;
+    size_t pos = EVAL_NO_POS;
 
     Token() = default;
     Token(const decimal_t &v) : type(TokenType::DECIMAL), value(v) {}
     Token(const std::string &v) : type(TokenType::IDENT), value(v) {}
+    Token(const TokenType &ty, const std::string &v) : type(ty), value(v) {}
     Token(const TokenType &ty) : type(ty) { assert((ty != TokenType::DECIMAL) && (ty != TokenType::IDENT)); }
 
     std::string getIdent() const
@@ -75,6 +81,12 @@ struct Token
         return std::get<1>(value);
     }
 
+    std::string getString() const
+    {
+        assert((type == TokenType::STRING) && (value.index() == 1));
+        return std::get<1>(value);
+    }
+
     decimal_t getDecimal() const
     {
         assert((type == TokenType::DECIMAL));
@@ -83,16 +95,19 @@ struct Token
     }
 };
 
+// strto* instead of sto* so that failed conversions, which happen for every
+// identifier, do not throw
 template <typename Ty>
-inline Ty strToDecimal(const std::string &, size_t *) {}
+inline Ty strToDecimal(const char *, char **) {}
 template <>
-inline float strToDecimal<float>(const std::string &s, size_t *idx) { return std::stof(s, idx); }
+inline float strToDecimal<float>(const char *s, char **end) { return std::strtof(s, end); }
 template <>
-inline double strToDecimal<double>(const std::string &s, size_t *idx) { return std::stod(s, idx); }
+inline double strToDecimal<double>(const char *s, char **end) { return std::strtod(s, end); }
 template <>
-inline long double strToDecimal<long double>(const std::string &s, size_t *idx) { return std::stold(s, idx); }
+inline long double strToDecimal<long double>(const char *s, char **end) { return std::strtold(s, end); }
 
 using TokenList = std::vector<Token>;
+EvalResult<TokenList> tryTokenize(const std::string &src);
 TokenList tokenize(const std::string &src);
 
 } // namespace eval
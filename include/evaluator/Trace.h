@@ -0,0 +1,135 @@
+#ifndef EVAL_TRACE_H_
+#define EVAL_TRACE_H_
+
+#include <JsonParser.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace eval
+{
+
+inline constexpr size_t TRACE_BUFFER_EVENTS = 1 << 16;
+inline constexpr size_t TRACE_MIN_LIST_SIZE = 1 << 12;
+
+struct TraceEvent
+{
+    const char *name;
+    uint64_t startNs;
+    uint64_t durNs;
+};
+
+// Spans open on the current thread and whether they were sampled. Tasks forked
+// from inside a span adopt the state of the forking thread, so their spans
+// follow its sampling decision instead of drawing their own.
+struct TraceState
+{
+    size_t depth = 0;
+    bool sampled = false;
+};
+
+TraceState traceState();
+void setTraceState(TraceState);
+
+// Process-wide span recorder. Every thread writes complete events into its own
+// fixed-size ring buffer without locking, so memory is bounded and old events
+// are overwritten. The buffer of an exited thread stays readable until a new
+// thread reuses it, so there are never more buffers than concurrent tracing
+// threads. Sampling is decided per top-level span (e.g. one exec) and applies
+// to everything nested in it.
+class Tracer
+{
+public:
+    static Tracer &instance();
+
+    void start(size_t sampleEvery = 1, size_t bufferEvents = TRACE_BUFFER_EVENTS);
+    // waits for the sampled spans open on other threads to be recorded
+    void stop();
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // safe while other threads record, events overwritten meanwhile are skipped
+    JsonNode toJson() const;
+    // also frees the buffers of exited threads and the interned names, so no
+    // span may be open
+    void clear();
+    size_t bufferCount() const;
+
+    bool sample();
+    // false when tracing stopped meanwhile, otherwise record() must follow
+    bool open();
+    void record(const char *name, uint64_t startNs, uint64_t durNs);
+    const char *intern(const std::string &);
+    uint64_t now() const;
+
+private:
+    // seq is the index of the event plus one once it is complete and 0 while
+    // it is written, so readers can tell a torn slot
+    struct Slot
+    {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<const char *> name{nullptr};
+        std::atomic<uint64_t> startNs{0};
+        std::atomic<uint64_t> durNs{0};
+    };
+
+    struct ThreadBuffer
+    {
+        uint32_t tid;
+        bool inUse = true;
+        size_t capacity = 0;
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<uint64_t> head{0};
+        std::atomic<size_t> open{0}; // opened spans not recorded yet
+    };
+
+    // returns the buffer to the pool when the thread exits
+    struct BufferLease
+    {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~BufferLease();
+    };
+
+    static BufferLease &lease();
+    ThreadBuffer &threadBuffer();
+    std::shared_ptr<ThreadBuffer> acquireBuffer();
+
+private:
+    std::atomic<bool> m_enabled{false};
+    std::atomic<uint64_t> m_sampleEvery{1};
+    std::atomic<uint64_t> m_sampleCounter{0};
+    size_t m_bufferEvents = TRACE_BUFFER_EVENTS;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+    uint32_t m_nextTid = 0;
+    std::unordered_set<std::string> m_names;
+    std::atomic<uint64_t> m_namesGeneration{0}; // invalidates per-thread intern caches
+};
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name, bool active = true);
+    explicit TraceSpan(const std::string &name, bool active = true);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    bool enter(bool active);
+
+private:
+    bool m_entered = false;
+    const char *m_name = nullptr;
+    uint64_t m_start = 0;
+};
+
+} // namespace eval
+
+#endif
@@ -121,6 +121,9 @@ JsonNode ASTNode::toJson() const
         return {{"TYPE", jsptr("PARAM_LIST")},
                 {"PARAMS", jsptr(arr)}};
     }
+    case OptrType::STRING:
+        return {{"TYPE", jsptr("STRING")},
+                {"STRING", jsptr(children[0]->getIdent())}};
     default:
         return JsonNull;
     }
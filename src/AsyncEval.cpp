@@ -0,0 +1,81 @@
+#include <evaluator/AsyncEval.h>
+
+#include <algorithm>
+
+namespace eval
+{
+
+AsyncEval::AsyncEval(Context &context, std::string input, uint64_t yieldEvery,
+                     std::optional<EvalBudget> budget, size_t stackSize)
+    : m_context(context), m_input(std::move(input)), m_yieldEvery(std::max<uint64_t>(1, yieldEvery)),
+      m_budget(std::move(budget)), m_coroutine([this]
+                                               {
+                                                   try
+                                                   {
+                                                       m_result = m_budget ? m_context.exec(m_input, *m_budget)
+                                                                           : m_context.exec(m_input);
+                                                       m_state = AsyncState::DONE;
+                                                   }
+                                                   catch (const EvalExcept &e)
+                                                   {
+                                                       m_error = e;
+                                                       m_state = e.code() == EVAL_CANCELLED ? AsyncState::CANCELLED
+                                                                                            : AsyncState::FAILED;
+                                                   } },
+                                               std::max(stackSize, 2 * ASYNC_STACK_MARGIN))
+{
+}
+
+AsyncEval::~AsyncEval()
+{
+    try
+    {
+        cancel();
+    }
+    catch (...)
+    {
+    }
+}
+
+AsyncState AsyncEval::resume()
+{
+    if (done())
+        return m_state;
+
+    m_context.m_async = this;
+    try
+    {
+        m_coroutine.resume();
+    }
+    catch (...)
+    {
+        m_context.m_async = nullptr;
+        m_state = AsyncState::FAILED;
+        throw;
+    }
+    m_context.m_async = nullptr;
+    return m_state;
+}
+
+void AsyncEval::cancel()
+{
+    if (done())
+        return;
+    if (m_steps == 0)
+    {
+        // never started, nothing to unwind
+        m_error = EvalExcept(EVAL_CANCELLED);
+        m_state = AsyncState::CANCELLED;
+        return;
+    }
+    m_cancelled = true;
+    resume();
+}
+
+bool AsyncEval::yield()
+{
+    m_coroutine.yield();
+    return m_cancelled;
+}
+
+} // namespace eval
@@ -0,0 +1,55 @@
+#include <evaluator/Budget.h>
+
+#include <algorithm>
+
+namespace eval
+{
+
+thread_local BudgetState::Pending BudgetState::t_pending;
+
+static std::atomic<uint64_t> s_nextBudgetId{1};
+
+BudgetState::BudgetState(const EvalBudget &budget)
+    : m_id(s_nextBudgetId.fetch_add(1, std::memory_order_relaxed)),
+      m_budget(budget),
+      m_interval(budget.maxSteps == 0 ? BUDGET_CHECK_INTERVAL : std::min(budget.maxSteps, BUDGET_CHECK_INTERVAL)),
+      m_deadline(std::chrono::steady_clock::now() + budget.timeout)
+{
+}
+
+BudgetState::~BudgetState()
+{
+    if (t_pending.owner == m_id)
+        t_pending = {};
+}
+
+// publishes the counts of the previous budget without checking its limits,
+// which happens the next time it flushes on its own
+void BudgetState::adopt()
+{
+    if (auto prev = t_pending.ownerRef.lock())
+    {
+        prev->m_steps.fetch_add(t_pending.steps, std::memory_order_relaxed);
+        prev->m_bytes.fetch_add(t_pending.bytes, std::memory_order_relaxed);
+    }
+    t_pending = {m_id, weak_from_this(), 0, 0};
+}
+
+std::optional<EvalErrCode> BudgetState::flush()
+{
+    auto &p = pending();
+    auto steps = m_steps.fetch_add(p.steps, std::memory_order_relaxed) + p.steps;
+    auto bytes = m_bytes.fetch_add(p.bytes, std::memory_order_relaxed) + p.bytes;
+    p.steps = 0;
+    p.bytes = 0;
+
+    if (m_budget.maxSteps != 0 && steps > m_budget.maxSteps)
+        return EVAL_STEP_LIMIT_EXCEEDED;
+    if (m_budget.maxBytes != 0 && bytes > m_budget.maxBytes)
+        return EVAL_MEMORY_LIMIT_EXCEEDED;
+    if (m_budget.timeout.count() != 0 && std::chrono::steady_clock::now() > m_deadline)
+        return EVAL_TIME_LIMIT_EXCEEDED;
+    return std::nullopt;
+}
+
+} // namespace eval
@@ -0,0 +1,353 @@
+#include <evaluator/Compiler.h>
+#include <evaluator/Context.h>
+#include <evaluator/InternalFunc.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace eval
+{
+
+template <typename Func>
+static inline void mapBlock(decimal_t *out, const decimal_t *x, size_t n, Func f)
+{
+    for (size_t k = 0; k < n; ++k)
+        out[k] = f(x[k]);
+}
+
+template <typename Func>
+static inline void zipBlock(decimal_t *out, const decimal_t *x, const decimal_t *y, size_t n, Func f)
+{
+    for (size_t k = 0; k < n; ++k)
+        out[k] = f(x[k], y[k]);
+}
+
+decimal_t CompiledProgram::evalNode(uint32_t idx, const decimal_t *args) const
+{
+    const CompiledNode &node = m_nodes[idx];
+    switch (node.op)
+    {
+    case CompiledOp::CONST:
+        return node.value;
+    case CompiledOp::ARG:
+        return args[node.a];
+    case CompiledOp::NEG:
+        return -evalNode(node.a, args);
+    case CompiledOp::ADD:
+        return evalNode(node.a, args) + evalNode(node.b, args);
+    case CompiledOp::SUB:
+        return evalNode(node.a, args) - evalNode(node.b, args);
+    case CompiledOp::MUL:
+        return evalNode(node.a, args) * evalNode(node.b, args);
+    case CompiledOp::DIV:
+        return evalNode(node.a, args) / evalNode(node.b, args);
+    case CompiledOp::POW:
+        return std::pow(evalNode(node.a, args), evalNode(node.b, args));
+    case CompiledOp::UNARY:
+        return node.unary(evalNode(node.a, args));
+    case CompiledOp::BINARY:
+        return node.binary(evalNode(node.a, args), evalNode(node.b, args));
+    case CompiledOp::AND:
+        if (!evalNode(node.a, args))
+            return decimal_t(0);
+        return decimal_t(static_cast<bool>(evalNode(node.b, args)));
+    case CompiledOp::OR:
+        if (evalNode(node.a, args))
+            return decimal_t(1);
+        return decimal_t(static_cast<bool>(evalNode(node.b, args)));
+    case CompiledOp::IF_ELSE:
+        return evalNode(evalNode(node.a, args) != decimal_t(0) ? node.b : node.c, args);
+    case CompiledOp::CALL:
+    {
+        decimal_t argv[COMPILED_MAX_ARITY];
+        for (uint32_t i = 0; i < node.c; ++i)
+            argv[i] = evalNode(m_callArgs[node.b + i], args);
+        return evalNode(m_funcs[node.a].root, argv);
+    }
+    default:
+        assert(0);
+        return decimal_t(0);
+    }
+}
+
+void CompiledProgram::runBatch(const ColumnView *columns, size_t rows, decimal_t *out) const
+{
+    if (!vectorizable())
+    {
+        const size_t arity = m_funcs[0].arity;
+        decimal_t argv[COMPILED_MAX_ARITY];
+        for (size_t r = 0; r < rows; ++r)
+        {
+            for (size_t i = 0; i < arity; ++i)
+                argv[i] = columns[i].data[r];
+            out[r] = run(argv);
+        }
+        return;
+    }
+
+    std::vector<decimal_t> scratch(m_nodes.size() * COMPILED_BATCH_BLOCK);
+    std::vector<const decimal_t *> slots(m_nodes.size());
+    for (size_t offset = 0; offset < rows; offset += COMPILED_BATCH_BLOCK)
+        evalBlock(columns, offset, std::min(COMPILED_BATCH_BLOCK, rows - offset),
+                  scratch.data(), slots.data(), out + offset);
+}
+
+// nodes are emitted in post-order, so a single forward pass evaluates every
+// node over the whole block; if_else/and/or are resolved by per-lane selects
+void CompiledProgram::evalBlock(const ColumnView *columns, size_t offset, size_t n,
+                                decimal_t *scratch, const decimal_t **slots, decimal_t *out) const
+{
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        const CompiledNode &node = m_nodes[i];
+        decimal_t *o = scratch + i * COMPILED_BATCH_BLOCK;
+        slots[i] = o;
+        const decimal_t *x = node.a < i ? slots[node.a] : nullptr;
+        const decimal_t *y = node.b < i ? slots[node.b] : nullptr;
+        switch (node.op)
+        {
+        case CompiledOp::CONST:
+            std::fill(o, o + n, node.value);
+            break;
+        case CompiledOp::ARG:
+            slots[i] = columns[node.a].data + offset;
+            break;
+        case CompiledOp::NEG:
+            mapBlock(o, x, n, [](decimal_t a) { return -a; });
+            break;
+        case CompiledOp::ADD:
+            zipBlock(o, x, y, n, [](decimal_t a, decimal_t b) { return a + b; });
+            break;
+        case CompiledOp::SUB:
+            zipBlock(o, x, y, n, [](decimal_t a, decimal_t b) { return a - b; });
+            break;
+        case CompiledOp::MUL:
+            zipBlock(o, x, y, n, [](decimal_t a, decimal_t b) { return a * b; });
+            break;
+        case CompiledOp::DIV:
+            zipBlock(o, x, y, n, [](decimal_t a, decimal_t b) { return a / b; });
+            break;
+        case CompiledOp::POW:
+            zipBlock(o, x, y, n, [](decimal_t a, decimal_t b) { return std::pow(a, b); });
+            break;
+        case CompiledOp::UNARY:
+            mapBlock(o, x, n, node.unary);
+            break;
+        case CompiledOp::BINARY:
+            zipBlock(o, x, y, n, node.binary);
+            break;
+        case CompiledOp::AND:
+            zipBlock(o, x, y, n, [](decimal_t a, decimal_t b) { return decimal_t(a != 0 && b != 0); });
+            break;
+        case CompiledOp::OR:
+            zipBlock(o, x, y, n, [](decimal_t a, decimal_t b) { return decimal_t(a != 0 || b != 0); });
+            break;
+        case CompiledOp::IF_ELSE:
+        {
+            const decimal_t *z = slots[node.c];
+            for (size_t k = 0; k < n; ++k)
+                o[k] = x[k] != decimal_t(0) ? y[k] : z[k];
+        }
+        break;
+        default:
+            assert(0);
+        }
+    }
+    const decimal_t *ret = slots[m_funcs[0].root];
+    std::copy(ret, ret + n, out);
+}
+
+class ProgramBuilder
+{
+public:
+    explicit ProgramBuilder(const Context &context)
+        : m_context(context), m_program(std::make_shared<CompiledProgram>()) {}
+
+    std::shared_ptr<const CompiledProgram> build(const std::string &name, size_t arity)
+    {
+        const LambdaType &lambda = findLambda(name);
+        if (lambda.params.size() != arity)
+            throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
+        compileFunction(name, lambda);
+        return m_program;
+    }
+
+    std::shared_ptr<const CompiledProgram> buildExpr(const std::shared_ptr<ASTNode> &ast,
+                                                     const std::vector<std::string> &params)
+    {
+        if (params.size() > COMPILED_MAX_ARITY)
+            throw EvalExcept(EVAL_NOT_COMPILABLE);
+        m_program->m_funcs.push_back({0, static_cast<uint32_t>(params.size())});
+        auto root = compileNode(ast, params);
+        m_program->m_funcs[0].root = root;
+        return m_program;
+    }
+
+private:
+    const LambdaType &findLambda(const std::string &name) const
+    {
+        auto var = m_context.find(name);
+        if (var == nullptr)
+            throw EvalExcept(EVAL_IDENTIFIER_UNDEFINED);
+        if (var->index() != 3)
+            throw EvalExcept(EVAL_OBJECT_NOT_CALLABLE);
+        return std::get<3>(*var);
+    }
+
+    uint32_t compileFunction(const std::string &name, const LambdaType &lambda)
+    {
+        auto ite = m_funcIdx.find(name);
+        if (ite != m_funcIdx.end())
+            return ite->second;
+
+        if (lambda.isInternalFunc || lambda.params.size() > COMPILED_MAX_ARITY)
+            throw EvalExcept(EVAL_NOT_COMPILABLE);
+
+        uint32_t idx = static_cast<uint32_t>(m_program->m_funcs.size());
+        m_funcIdx[name] = idx;
+        m_program->m_funcs.push_back({0, static_cast<uint32_t>(lambda.params.size())});
+
+        auto root = compileNode(lambda.expr, lambda.params);
+        m_program->m_funcs[idx].root = root;
+        return idx;
+    }
+
+    uint32_t push(const CompiledNode &node)
+    {
+        m_program->m_nodes.push_back(node);
+        return static_cast<uint32_t>(m_program->m_nodes.size() - 1);
+    }
+
+    uint32_t compileNode(const std::shared_ptr<ASTNode> &ast, const std::vector<std::string> &params)
+    {
+        if (ast->isDecimal())
+            return push({CompiledOp::CONST, 0, 0, 0, ast->getDecimal()});
+        if (ast->isIdent())
+        {
+            auto ident = ast->getIdent();
+            for (size_t i = 0; i < params.size(); ++i)
+                if (params[i] == ident)
+                    return push({CompiledOp::ARG, static_cast<uint32_t>(i)});
+            auto var = m_context.find(ident);
+            if (var == nullptr)
+                throw EvalExcept(EVAL_IDENTIFIER_UNDEFINED);
+            if (var->index() != 1)
+                throw EvalExcept(EVAL_NOT_COMPILABLE);
+            return push({CompiledOp::CONST, 0, 0, 0, std::get<1>(*var)});
+        }
+
+        switch (ast->getOptr())
+        {
+        case OptrType::NEG:
+        {
+            auto a = compileNode(ast->children[0], params);
+            return push({CompiledOp::NEG, a});
+        }
+        case OptrType::ADD:
+        case OptrType::SUB:
+        case OptrType::MUL:
+        case OptrType::DIV:
+        case OptrType::POW:
+        {
+            static const CompiledOp ops[]{CompiledOp::ADD, CompiledOp::SUB, CompiledOp::MUL,
+                                          CompiledOp::DIV, CompiledOp::POW};
+            auto a = compileNode(ast->children[0], params);
+            auto b = compileNode(ast->children[1], params);
+            auto op = ops[static_cast<size_t>(ast->getOptr()) - static_cast<size_t>(OptrType::ADD)];
+            return push({op, a, b});
+        }
+        case OptrType::CALL:
+            return compileCall(ast, params);
+        default:
+            throw EvalExcept(EVAL_NOT_COMPILABLE);
+        }
+    }
+
+    uint32_t compileCall(const std::shared_ptr<ASTNode> &ast, const std::vector<std::string> &params)
+    {
+        auto &callee = ast->children[0];
+        auto &args = ast->children[1]->children;
+        if (!callee->isIdent())
+            throw EvalExcept(EVAL_NOT_COMPILABLE);
+        auto name = callee->getIdent();
+        for (auto &p : params)
+            if (p == name)
+                throw EvalExcept(EVAL_NOT_COMPILABLE);
+
+        const LambdaType &lambda = findLambda(name);
+        if (lambda.params.size() != args.size())
+            throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
+
+        std::vector<uint32_t> argIdx;
+        argIdx.reserve(args.size());
+        for (auto &a : args)
+            argIdx.push_back(compileNode(a, params));
+
+        if (!lambda.isInternalFunc)
+        {
+            CompiledNode node{CompiledOp::CALL, compileFunction(name, lambda)};
+            node.b = static_cast<uint32_t>(m_program->m_callArgs.size());
+            node.c = static_cast<uint32_t>(argIdx.size());
+            m_program->m_callArgs.insert(m_program->m_callArgs.end(), argIdx.begin(), argIdx.end());
+            return push(node);
+        }
+
+        const auto &fname = lambda.internalFuncName;
+        if (auto f = scalarUnaryFunc(fname))
+        {
+            CompiledNode node{CompiledOp::UNARY, argIdx[0]};
+            node.unary = f;
+            return push(node);
+        }
+        if (auto f = scalarBinaryFunc(fname))
+        {
+            CompiledNode node{CompiledOp::BINARY, argIdx[0], argIdx[1]};
+            node.binary = f;
+            return push(node);
+        }
+        if (fname == "and")
+            return push({CompiledOp::AND, argIdx[0], argIdx[1]});
+        if (fname == "or")
+            return push({CompiledOp::OR, argIdx[0], argIdx[1]});
+        if (fname == "if_else")
+            return push({CompiledOp::IF_ELSE, argIdx[0], argIdx[1], argIdx[2]});
+        throw EvalExcept(EVAL_NOT_COMPILABLE);
+    }
+
+private:
+    const Context &m_context;
+    std::shared_ptr<CompiledProgram> m_program;
+    std::unordered_map<std::string, uint32_t> m_funcIdx;
+};
+
+std::shared_ptr<const CompiledProgram> Context::compileProgram(const std::string &name, size_t arity) const
+{
+    return ProgramBuilder(*this).build(name, arity);
+}
+
+std::shared_ptr<const CompiledProgram> Context::compileExpr(const std::string &expr,
+                                                            const std::vector<std::string> &vars) const
+{
+    Parser parser;
+    auto ast = parser.parse(tokenize(expr));
+    return ProgramBuilder(*this).buildExpr(ast, vars);
+}
+
+ListType Context::evalBatch(const std::string &expr,
+                            const std::vector<std::string> &vars,
+                            const std::vector<ColumnView> &columns) const
+{
+    if (vars.size() != columns.size())
+        throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
+    size_t rows = columns.empty() ? 0 : columns[0].size;
+    for (auto &c : columns)
+        if (c.size != rows)
+            throw EvalExcept(EVAL_DIFFERENT_LIST_LENGTHS);
+
+    auto program = compileExpr(expr, vars);
+    ListType ret(rows);
+    program->runBatch(columns.data(), rows, ret.data());
+    return ret;
+}
+
+} // namespace eval
@@ -1,42 +1,360 @@
 #include <evaluator/Context.h>
 #include <evaluator/InternalFunc.h>
+#include <evaluator/SharedDefinitions.h>
+#include <evaluator/Scheduler.h>
+#include <evaluator/Profiler.h>
+#include <evaluator/Trace.h>
+#include <evaluator/Budget.h>
+#include <evaluator/AsyncEval.h>
+#include <evaluator/Coroutine.h>
+#include <evaluator/Image.h>
+#include <evaluator/DataIO.h>
+#include <evaluator/Rolling.h>
+#include <evaluator/Reduce.h>
+
+#include <algorithm>
+#include <mutex>
 
 namespace eval
 {
 
+static thread_local size_t t_forkDepth = 0;
+static thread_local size_t t_callDepth = 0;
+
+// forked tasks pass the trace state of the forking thread
+struct ForkDepthGuard
+{
+    size_t saved;
+    size_t savedCalls;
+    TraceState savedTrace;
+    ForkDepthGuard(size_t depth, size_t callDepth, TraceState trace = traceState())
+        : saved(t_forkDepth), savedCalls(t_callDepth), savedTrace(traceState())
+    {
+        t_forkDepth = depth;
+        t_callDepth = callDepth;
+        setTraceState(trace);
+    }
+    ~ForkDepthGuard()
+    {
+        t_forkDepth = saved;
+        t_callDepth = savedCalls;
+        setTraceState(savedTrace);
+    }
+};
+
+Context::Context(const SharedDefinitions &shared)
+    : m_definitions(shared.snapshot()), m_shared(&shared)
+{
+}
+
+Context::Context(std::shared_ptr<const Definitions> definitions)
+    : m_definitions(std::move(definitions))
+{
+}
+
+const std::shared_ptr<const Definitions> &Context::builtins()
+{
+    static const std::shared_ptr<const Definitions> builtins = []
+    {
+        Context context;
+        context.setupInternalFunc();
+        auto definitions = std::make_shared<Definitions>();
+        definitions->varMap = std::move(context.m_globalVarMap);
+        return definitions;
+    }();
+    return builtins;
+}
+
 void Context::init()
 {
     m_globalVarMap.clear();
-    setupInternalFunc();
+    m_purity.clear();
+    m_memLive = {};
+    m_astRefs.clear();
+    m_memPeak = 0;
+    m_memAllocations = 0;
+    if (m_definitions == nullptr)
+        m_definitions = builtins();
+}
+
+std::shared_ptr<const Definitions> Context::freeze() const
+{
+    auto definitions = std::make_shared<Definitions>();
+    definitions->varMap = m_globalVarMap;
+    definitions->varMap.erase("ans");
+    definitions->parent = m_definitions;
+    return definitions;
+}
+
+void Context::saveDefinitions(const std::string &path) const
+{
+    // flatten every layer above the builtins, inner definitions win
+    VarMap varMap = m_globalVarMap;
+    varMap.erase("ans");
+    for (auto layer = m_definitions.get(); layer != nullptr && layer != builtins().get(); layer = layer->parent.get())
+        for (auto &v : layer->varMap)
+            varMap.insert(v);
+    writeImage(path, varMap);
+}
+
+void Context::saveSnapshot(const std::string &path) const
+{
+    writeImage(path, m_globalVarMap);
+}
+
+void Context::loadSnapshot(const std::string &path)
+{
+    auto varMap = readImage(path);
+    init();
+    for (auto &v : varMap)
+    {
+        m_memLive += measure(v.second, m_astRefs, false);
+        m_memLive.addString(v.first);
+    }
+    m_memPeak = m_memLive.totalBytes();
+    m_globalVarMap = std::move(varMap);
+    m_purity.clear();
+}
+
+std::shared_ptr<const Definitions> Context::loadDefinitions(const std::string &path)
+{
+    auto definitions = std::make_shared<Definitions>();
+    definitions->varMap = readImage(path);
+    definitions->parent = builtins();
+    return definitions;
+}
+
+const DataType *Context::find(const std::string &ident) const
+{
+    auto ite = m_globalVarMap.find(ident);
+    if (ite != m_globalVarMap.end())
+        return &ite->second;
+    for (auto layer = m_definitions.get(); layer != nullptr; layer = layer->parent.get())
+    {
+        auto base = layer->varMap.find(ident);
+        if (base != layer->varMap.end())
+            return &base->second;
+    }
+    return nullptr;
+}
+
+std::vector<std::string> Context::identifiers() const
+{
+    std::vector<std::string> ret;
+    std::unordered_set<std::string> seen;
+    for (auto &v : m_globalVarMap)
+        if (seen.insert(v.first).second)
+            ret.push_back(v.first);
+    for (auto layer = m_definitions.get(); layer != nullptr; layer = layer->parent.get())
+        for (auto &v : layer->varMap)
+            if (seen.insert(v.first).second)
+                ret.push_back(v.first);
+    return ret;
 }
 
 DataType Context::exec(const std::string &input)
 {
+    return tryExec(input).valueOrThrow();
+}
+
+EvalResult<DataType> Context::tryExec(const std::string &input)
+{
+    TraceSpan span("exec");
+    if (m_shared != nullptr && m_shared->version() != m_definitions->version)
+    {
+        m_definitions = m_shared->snapshot();
+        m_purity.clear();
+    }
+
+    EVAL_TRY(tokens, tryTokenize(input));
     Parser parser;
-    m_AST = parser.parse(tokenize(input));
-    auto ret = eval(m_AST);
-    if (ret.index() != 0)
-        m_globalVarMap["ans"] = ret;
+    EVAL_TRY(ast, parser.tryParse(*tokens));
+    m_AST = std::move(*ast);
+
+    auto ret = tryEval(m_AST);
+    if (ret && ret->index() != 0)
+        setVar("ans", *ret);
     return ret;
 }
 
+DataType Context::exec(const std::string &input, const EvalBudget &budget)
+{
+    struct BudgetGuard
+    {
+        std::shared_ptr<BudgetState> &budget;
+        ~BudgetGuard() { budget.reset(); }
+    } guard{m_budget};
+
+    m_budget = std::make_shared<BudgetState>(budget);
+    return exec(input);
+}
+
+void Context::setVar(const std::string &name, DataType value)
+{
+    auto usage = measure(value, m_astRefs, false);
+    auto ite = m_globalVarMap.find(name);
+    if (ite == m_globalVarMap.end())
+    {
+        usage.addString(name);
+        ite = m_globalVarMap.emplace(name, VoidType{}).first;
+    }
+    else
+        m_memLive -= measure(ite->second, m_astRefs, true);
+    // only lambdas change the purity of the expressions naming them
+    if (ite->second.index() == 3 || value.index() == 3)
+        m_purity.clear();
+    ite->second = std::move(value);
+
+    m_memLive += usage;
+    m_memPeak = std::max(m_memPeak, m_memLive.totalBytes());
+    ++m_memAllocations;
+}
+
+MemoryUsage Context::measure(const DataType &d)
+{
+    ASTRefs refs;
+    return measure(d, refs, false);
+}
+
+// with release, counts what is no longer referenced once d is gone
+MemoryUsage Context::measure(const DataType &d, ASTRefs &refs, bool release)
+{
+    MemoryUsage usage;
+    if (d.index() == 2)
+    {
+        auto &l = std::get<2>(d);
+        if (l.isView())
+            usage.mappedBytes += l.size() * sizeof(decimal_t);
+        else
+            usage.listBytes += l.capacity() * sizeof(decimal_t);
+        ++usage.lists;
+    }
+    else if (d.index() == 3)
+    {
+        auto &l = std::get<3>(d);
+        usage.lambdaBytes += sizeof(LambdaType) + l.params.capacity() * sizeof(std::string);
+        ++usage.lambdas;
+        for (auto &p : l.params)
+            usage.addString(p);
+        usage.addString(l.internalFuncName);
+        if (l.expr != nullptr && release)
+            usage.releaseAST(*l.expr, refs);
+        else if (l.expr != nullptr)
+            usage.addAST(*l.expr, refs);
+    }
+    return usage;
+}
+
+MemoryStats Context::memoryStats(size_t largest) const
+{
+    MemoryStats stats;
+    stats.live = m_memLive;
+    stats.peakBytes = m_memPeak;
+    stats.allocations = m_memAllocations;
+
+    stats.largestVars.reserve(m_globalVarMap.size());
+    for (auto &v : m_globalVarMap)
+        stats.largestVars.emplace_back(v.first, measure(v.second).totalBytes());
+    largest = std::min(largest, stats.largestVars.size());
+    std::partial_sort(stats.largestVars.begin(), stats.largestVars.begin() + largest, stats.largestVars.end(),
+                      [](auto &a, auto &b)
+                      { return a.second > b.second; });
+    stats.largestVars.resize(largest);
+    return stats;
+}
+
 DataType Context::eval(std::shared_ptr<ASTNode> ast)
+{
+    return tryEval(ast).valueOrThrow();
+}
+
+EvalResult<DataType> Context::tryEval(const std::shared_ptr<ASTNode> &ast)
 {
     assert(ast != nullptr);
+    if (currentStackLeft() < EVAL_STACK_MARGIN)
+        return EvalError{EVAL_RECURSION_LIMIT_EXCEEDED, ast->pos};
+    auto ret = m_budget != nullptr || m_async != nullptr ? checkedEval(ast)
+               : m_profiler == nullptr || !ast->isOptr()  ? evalNode(ast)
+                                                          : profiledEval(ast);
+    // the innermost failing node sets the position
+    if (!ret && ret.error().pos == EVAL_NO_POS)
+        ret.error().pos = ast->pos;
+    return ret;
+}
+
+EvalResult<DataType> Context::checkedEval(const std::shared_ptr<ASTNode> &ast)
+{
+    if (m_async != nullptr && t_forkDepth == 0 && m_async->shouldYield())
+    {
+        // the resumer and other coroutines run on this thread in between
+        auto callDepth = std::exchange(t_callDepth, 0);
+        auto scope = Profiler::Scope::exchangeCurrent(nullptr);
+        bool cancelled = m_async->yield();
+        Profiler::Scope::exchangeCurrent(scope);
+        t_callDepth = callDepth;
+        if (cancelled)
+            return EvalError{EVAL_CANCELLED};
+    }
+    if (m_budget != nullptr)
+        if (auto exceeded = m_budget->step())
+            return EvalError{*exceeded};
+
+    auto ret = m_profiler == nullptr || !ast->isOptr() ? evalNode(ast) : profiledEval(ast);
+    if (m_budget != nullptr && ret && ret->index() == 2)
+        if (auto exceeded = m_budget->allocate(std::get<2>(*ret).capacity() * sizeof(decimal_t)))
+            return EvalError{*exceeded};
+    return ret;
+}
+
+void Context::setProfiling(bool enabled)
+{
+    if (!enabled)
+        m_profiler.reset();
+    else if (m_profiler == nullptr)
+        m_profiler = std::make_shared<Profiler>();
+}
+
+EvalResult<DataType> Context::profiledEval(const std::shared_ptr<ASTNode> &ast)
+{
+    std::string func;
+    bool builtin = false;
+    if (ast->getOptr() == OptrType::CALL)
+    {
+        auto &callee = ast->children[0];
+        auto f = callee->isIdent() ? find(callee->getIdent()) : nullptr;
+        builtin = f != nullptr && f->index() == 3 && std::get<3>(*f).isInternalFunc;
+        if (builtin)
+            func = std::get<3>(*f).internalFuncName;
+        else
+            func = callee->isIdent() ? callee->getIdent() : "<lambda>";
+    }
+
+    Profiler::Scope scope(*m_profiler, ast->getOptr(), std::move(func), builtin);
+    auto ret = evalNode(ast);
+    if (ret && ret->index() == 2)
+        scope.addListBytes(std::get<2>(*ret).capacity() * sizeof(decimal_t));
+    return ret;
+}
+
+EvalResult<DataType> Context::evalNode(const std::shared_ptr<ASTNode> &ast)
+{
     if (ast->isDecimal())
         return ast->getDecimal();
     if (ast->isIdent())
     {
-        auto ite = m_globalVarMap.find(ast->getIdent());
-        if (ite == m_globalVarMap.end())
-            throw EvalExcept(EVAL_IDENTIFIER_UNDEFINED);
-        return ite->second;
+        auto var = find(ast->getIdent());
+        if (var == nullptr)
+            return EvalError{EVAL_IDENTIFIER_UNDEFINED};
+        return *var;
     }
     switch (ast->getOptr())
     {
     case OptrType::ASSIGN:
-        m_globalVarMap[ast->children[0]->getIdent()] = eval(ast->children[1]);
+    {
+        EVAL_TRY(val, tryEval(ast->children[1]));
+        setVar(ast->children[0]->getIdent(), std::move(*val));
         return VoidType{};
+    }
     case OptrType::ASSIGN_LAMBDA:
     {
         LambdaType lambda;
@@ -44,61 +362,84 @@ DataType Context::eval(std::shared_ptr<ASTNode> ast)
         for (auto &p : ast->children[1]->children)
             lambda.params.push_back(p->getIdent());
         lambda.expr = ast->children[2];
-        m_globalVarMap[ast->children[0]->getIdent()] = lambda;
+        setVar(ast->children[0]->getIdent(), std::move(lambda));
         return VoidType{};
     }
     case OptrType::NEG:
-        return neg(eval(ast->children[0]));
+    {
+        EVAL_TRY(val, tryEval(ast->children[0]));
+        return neg(*val);
+    }
     case OptrType::ADD:
     case OptrType::SUB:
     case OptrType::MUL:
     case OptrType::DIV:
     case OptrType::POW:
-        return binOp(eval(ast->children[0]), eval(ast->children[1]), ast->getOptr());
+        if (shouldFork(ast->children[0]) && shouldFork(ast->children[1]))
+        {
+            DataType operands[2];
+            if (auto err = evalParallel(ast->children, operands))
+                return *err;
+            return binOp(operands[0], operands[1], ast->getOptr());
+        }
+    {
+        EVAL_TRY(lhs, tryEval(ast->children[0]));
+        EVAL_TRY(rhs, tryEval(ast->children[1]));
+        return binOp(*lhs, *rhs, ast->getOptr());
+    }
     case OptrType::CALL:
     {
-        auto lambda = eval(ast->children[0]);
-        if (lambda.index() != 3)
-            throw EvalExcept(EVAL_OBJECT_NOT_CALLABLE);
-        auto &l = std::get<3>(lambda);
+        EVAL_TRY(lambda, tryEval(ast->children[0]));
+        if (lambda->index() != 3)
+            return EvalError{EVAL_OBJECT_NOT_CALLABLE};
+        auto &l = std::get<3>(*lambda);
         if (l.isInternalFunc)
-        {
-            auto ret = l.internalFuncDef(ast->children[1]->children, *this);
-            if (ret.type == InternalFuncRetType::DECIMAL)
-                return ret.decimal;
-            else if (ret.type == InternalFuncRetType::LIST)
-                return ret.list;
-            else
-                return ret.lambda;
-        }
+            return fromInternalFuncRet(l.internalFuncDef(ast->children[1]->children, *this));
+
+        static const std::string anonymous = "<lambda>";
+        auto &callee = ast->children[0];
+        TraceSpan span(callee->isIdent() ? std::get<2>(callee->value) : anonymous);
         return call(l, ast->children[1]->children);
     }
     case OptrType::INDEX:
     {
-        auto list = eval(ast->children[0]);
-        if (list.index() != 2)
-            throw EvalExcept(EVAL_OBJECT_NOT_LIST);
+        EVAL_TRY(list, tryEval(ast->children[0]));
+        if (list->index() != 2)
+            return EvalError{EVAL_OBJECT_NOT_LIST};
 
-        auto idx = eval(ast->children[1]);
-        if (idx.index() != 1)
-            throw EvalExcept(EVAL_INDEX_NOT_DECIMAL);
+        EVAL_TRY(idx, tryEval(ast->children[1]));
+        if (idx->index() != 1)
+            return EvalError{EVAL_INDEX_NOT_DECIMAL};
 
-        size_t i = static_cast<size_t>(std::round(std::get<1>(idx)));
-        auto l = std::get<2>(list);
+        size_t i = static_cast<size_t>(std::round(std::get<1>(*idx)));
+        const auto &l = std::get<2>(*list);
         if (i >= l.size())
-            throw EvalExcept(EVAL_INDEX_OUT_OF_RANGE);
+            return EvalError{EVAL_INDEX_OUT_OF_RANGE};
         return l[i];
     }
     case OptrType::LIST:
     {
         ListType list;
         list.reserve(ast->children.size());
+        if (ast->children.size() > 1 && shouldFork(ast))
+        {
+            std::vector<DataType> vals(ast->children.size());
+            if (auto err = evalParallel(ast->children, vals.data()))
+                return *err;
+            for (auto &val : vals)
+            {
+                if (val.index() != 1)
+                    return EvalError{EVAL_LIST_MEMBER_NOT_DECIMAL};
+                list.push_back(std::get<1>(val));
+            }
+            return list;
+        }
         for (auto &c : ast->children)
         {
-            auto val = eval(c);
-            if (val.index() != 1)
-                throw EvalExcept(EVAL_LIST_MEMBER_NOT_DECIMAL);
-            list.push_back(std::get<1>(val));
+            EVAL_TRY(val, tryEval(c));
+            if (val->index() != 1)
+                return EvalError{EVAL_LIST_MEMBER_NOT_DECIMAL, c->pos};
+            list.push_back(std::get<1>(*val));
         }
         return list;
     }
@@ -111,28 +452,271 @@ DataType Context::eval(std::shared_ptr<ASTNode> ast)
         lambda.expr = ast->children[1];
         return lambda;
     }
+    case OptrType::STRING:
+        return EvalError{EVAL_WRONG_OPERAND_TYPE};
     default:
         assert(0);
         return VoidType{};
     }
 }
 
-DataType Context::call(const LambdaType &lambda, const std::vector<std::shared_ptr<ASTNode>> &paramList)
+EvalResult<DataType> Context::call(const LambdaType &lambda, const std::vector<std::shared_ptr<ASTNode>> &paramList)
 {
     if (lambda.params.size() != paramList.size())
-        throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
+        return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
 
     VarMap local;
-    for (size_t i = 0; i < lambda.params.size(); ++i)
-        local[lambda.params[i]] = eval(paramList[i]);
+    if (paramList.size() > 1 && m_scheduler != nullptr &&
+        std::count_if(paramList.begin(), paramList.end(), [this](auto &p)
+                      { return shouldFork(p); }) > 1)
+    {
+        std::vector<DataType> vals(paramList.size());
+        if (auto err = evalParallel(paramList, vals.data()))
+            return *err;
+        for (size_t i = 0; i < lambda.params.size(); ++i)
+            local[lambda.params[i]] = std::move(vals[i]);
+    }
+    else
+        for (size_t i = 0; i < lambda.params.size(); ++i)
+        {
+            EVAL_TRY(val, tryEval(paramList[i]));
+            local[lambda.params[i]] = std::move(*val);
+        }
+
+    ForkDepthGuard guard(t_forkDepth, t_callDepth + 1);
+    if (m_budget != nullptr)
+        if (auto exceeded = m_budget->checkDepth(t_callDepth))
+            return EvalError{*exceeded};
+    return tryEval(substitude(lambda.expr, local, {}));
+}
+
+DataType Context::apply(const LambdaType &lambda, const std::vector<DataType> &args)
+{
+    return tryApply(lambda, args).valueOrThrow();
+}
+
+EvalResult<DataType> Context::tryApply(const LambdaType &lambda, const std::vector<DataType> &args)
+{
+    std::vector<std::shared_ptr<ASTNode>> params;
+    params.reserve(args.size());
+    for (auto &a : args)
+        params.push_back(toAST(a));
+    if (lambda.isInternalFunc)
+        return fromInternalFuncRet(lambda.internalFuncDef(params, *this));
+    return call(lambda, params);
+}
+
+EvalResult<DataType> Context::fromInternalFuncRet(InternalFuncRet &&ret)
+{
+    if (ret.type == InternalFuncRetType::DECIMAL)
+        return ret.decimal;
+    else if (ret.type == InternalFuncRetType::LIST)
+        return std::move(ret.list);
+    else if (ret.type == InternalFuncRetType::LAMBDA)
+        return std::move(ret.lambda);
+    else
+        return ret.error;
+}
+
+std::shared_ptr<ASTNode> Context::toAST(const DataType &d)
+{
+    assert(d.index() != 0);
+    switch (d.index())
+    {
+    case 1:
+        return std::make_shared<ASTNode>(std::get<1>(d));
+    case 2:
+    {
+        auto ret = std::make_shared<ASTNode>(OptrType::LIST);
+        auto &l = std::get<2>(d);
+        ret->alloc(l.size());
+        for (size_t i = 0; i < l.size(); ++i)
+            ret->children[i] = std::make_shared<ASTNode>(l[i]);
+        return ret;
+    }
+    case 3:
+    {
+        auto &l = std::get<3>(d);
+        if (l.isInternalFunc)
+            return std::make_shared<ASTNode>(l.internalFuncName);
+        auto ret = std::make_shared<ASTNode>(OptrType::LAMBDA);
+        ret->alloc(2);
+        ret->children[0]->value = OptrType::PARAM_LIST;
+        ret->children[0]->alloc(l.params.size());
+        for (size_t i = 0; i < l.params.size(); ++i)
+            ret->children[0]->children[i]->value = l.params[i];
+        ret->children[1] = l.expr;
+        return ret;
+    }
+    }
+    assert(0);
+    return nullptr;
+}
+
+void Context::setParallelEval(TaskScheduler *scheduler, size_t costThreshold)
+{
+    m_scheduler = scheduler;
+    m_parallelThreshold = costThreshold;
+}
+
+// builtins touching files, whose results depend on the order of evaluation
+static bool hasSideEffects(const LambdaType &lambda)
+{
+    static const std::unordered_set<std::string> names{
+        "load_f64", "load_json", "save_json", "load_csv", "fold_csv"};
+    return lambda.isInternalFunc && names.count(lambda.internalFuncName) != 0;
+}
+
+bool Context::isPure(const ASTNode &ast) const
+{
+    std::unordered_set<const ASTNode *> visited;
+    return isPure(ast, visited);
+}
+
+// Identifiers are resolved against the globals, following the bodies of the
+// lambdas they name, so a parameter shadowing an impure global is treated as
+// impure.
+bool Context::isPure(const ASTNode &ast, std::unordered_set<const ASTNode *> &visited) const
+{
+    if (ast.isIdent())
+    {
+        auto v = find(ast.getIdent());
+        if (v == nullptr || v->index() != 3)
+            return true;
+        auto &lambda = std::get<3>(*v);
+        if (lambda.isInternalFunc)
+            return !hasSideEffects(lambda);
+        // outside of any lambda body the answer only depends on the global
+        if (visited.empty())
+            return isPureGlobal(ast.getIdent(), lambda);
+        return !visited.insert(lambda.expr.get()).second || isPure(*lambda.expr, visited);
+    }
+    if (!ast.isOptr())
+        return true;
+    switch (ast.getOptr())
+    {
+    case OptrType::ASSIGN:
+    case OptrType::ASSIGN_LAMBDA:
+        return false;
+    case OptrType::STRING:
+    case OptrType::PARAM_LIST:
+        return true;
+    default:
+        break;
+    }
+    for (auto &c : ast.children)
+        if (!isPure(*c, visited))
+            return false;
+    return true;
+}
+
+size_t Context::parallelCost(const ASTNode &ast, size_t limit) const
+{
+    size_t cost = 1;
+    if (ast.isOptr() && ast.getOptr() == OptrType::CALL)
+    {
+        auto &callee = ast.children[0];
+        auto f = callee->isIdent() ? find(callee->getIdent()) : nullptr;
+        if (f == nullptr || f->index() != 3 || !std::get<3>(*f).isInternalFunc)
+            cost += PARALLEL_CALL_COST;
+    }
+    for (auto &c : ast.children)
+    {
+        if (cost >= limit)
+            break;
+        cost += parallelCost(*c, limit - cost);
+    }
+    return cost;
+}
 
-    return eval(substitude(lambda.expr, local, {}));
+// only subtrees without assignments are forked, assignments never run
+// concurrently and keep their serial order
+bool Context::shouldFork(const std::shared_ptr<ASTNode> &ast) const
+{
+    return m_scheduler != nullptr && m_scheduler->threadCount() > 1 && t_forkDepth < PARALLEL_MAX_DEPTH &&
+           parallelCost(*ast, m_parallelThreshold) >= m_parallelThreshold && isPure(*ast);
+}
+
+bool Context::isPure(const LambdaType &lambda) const
+{
+    if (lambda.isInternalFunc)
+        return !hasSideEffects(lambda);
+    std::unordered_set<const ASTNode *> visited{lambda.expr.get()};
+    return isPure(*lambda.expr, visited);
+}
+
+bool Context::isPureGlobal(const std::string &name, const LambdaType &lambda) const
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(m_purity.mutex);
+        auto ite = m_purity.pure.find(name);
+        if (ite != m_purity.pure.end())
+            return ite->second;
+    }
+    bool pure = isPure(lambda);
+    std::unique_lock<std::shared_mutex> lock(m_purity.mutex);
+    m_purity.pure.emplace(name, pure);
+    return pure;
+}
+
+// chunk boundaries only depend on n, so results of order-sensitive
+// combinations do not depend on the number of threads. Returns the error of
+// the first failing chunk, the one a serial loop would report.
+std::optional<EvalError> Context::forEachChunk(size_t n, const LambdaType &f,
+                                               const std::function<std::optional<EvalError>(size_t, size_t)> &body)
+{
+    if (m_scheduler == nullptr || n < m_parallelMapThreshold || !isPure(f))
+        return body(0, n);
+    const size_t grain = std::max<size_t>(1, m_parallelMapThreshold);
+    const size_t chunks = (n + grain - 1) / grain;
+    const size_t depth = t_forkDepth + 1;
+    const size_t callDepth = t_callDepth;
+    const TraceState trace = traceState();
+    std::vector<std::optional<EvalError>> errors(chunks);
+    m_scheduler->parallelFor(chunks, [&](size_t chunk)
+                             {
+                                 ForkDepthGuard guard(depth, callDepth, trace);
+                                 errors[chunk] = body(chunk * grain, std::min(n, (chunk + 1) * grain)); });
+    for (auto &err : errors)
+        if (err)
+            return err;
+    return std::nullopt;
+}
+
+// returns the error of the first failing expression in order
+std::optional<EvalError> Context::evalParallel(const std::vector<std::shared_ptr<ASTNode>> &asts, DataType *out)
+{
+    const size_t depth = t_forkDepth + 1;
+    const size_t callDepth = t_callDepth;
+    const TraceState trace = traceState();
+    const size_t n = asts.size();
+    const size_t chunks = std::min(n, m_scheduler->threadCount() * 4);
+    std::vector<std::optional<EvalError>> errors(chunks);
+    m_scheduler->parallelFor(chunks, [&](size_t chunk)
+                             {
+                                 ForkDepthGuard guard(depth, callDepth, trace);
+                                 for (size_t i = chunk * n / chunks; i < (chunk + 1) * n / chunks; ++i)
+                                 {
+                                     auto ret = tryEval(asts[i]);
+                                     if (!ret)
+                                     {
+                                         errors[chunk] = ret.error();
+                                         return;
+                                     }
+                                     out[i] = std::move(*ret);
+                                 } });
+    for (auto &err : errors)
+        if (err)
+            return err;
+    return std::nullopt;
 }
 
 std::shared_ptr<ASTNode> Context::substitude(const std::shared_ptr<ASTNode> &expr,
                                              const VarMap &varMap,
                                              std::unordered_set<std::string> masked)
 {
+    if (expr->isOptr() && expr->getOptr() == OptrType::STRING)
+        return expr;
     if (expr->isOptr() && expr->getOptr() == OptrType::LAMBDA)
         for (auto &c : expr->children[0]->children)
             masked.insert(c->getIdent());
@@ -141,37 +725,7 @@ std::shared_ptr<ASTNode> Context::substitude(const std::shared_ptr<ASTNode> &exp
         auto ite = varMap.find(expr->getIdent());
         if (ite == varMap.end())
             return std::make_shared<ASTNode>(*expr);
-        auto d = ite->second;
-        assert(d.index() != 0);
-        switch (d.index())
-        {
-        case 1:
-            return std::make_shared<ASTNode>(std::get<1>(d));
-        case 2:
-        {
-            auto ret = std::make_shared<ASTNode>(OptrType::LIST);
-            auto &l = std::get<2>(d);
-            ret->alloc(l.size());
-            for (size_t i = 0; i < l.size(); ++i)
-                ret->children[i] = std::make_shared<ASTNode>(l[i]);
-            return ret;
-        }
-        case 3:
-        {
-            auto &l = std::get<3>(d);
-            if (l.isInternalFunc)
-                return std::make_shared<ASTNode>(l.internalFuncName);
-            auto ret = std::make_shared<ASTNode>(OptrType::LAMBDA);
-            ret->alloc(2);
-            ret->children[0]->value = OptrType::PARAM_LIST;
-            ret->children[0]->alloc(l.params.size());
-            for (size_t i = 0; i < l.params.size(); ++i)
-                ret->children[0]->children[i]->value = l.params[i];
-            ret->children[1] = l.expr;
-            return ret;
-        }
-        }
-        assert(0);
+        return toAST(ite->second);
     }
 
     auto ret = std::make_shared<ASTNode>(*expr);
@@ -182,6 +736,49 @@ std::shared_ptr<ASTNode> Context::substitude(const std::shared_ptr<ASTNode> &exp
 
 #include <evaluator/Operators.inl>
 
+// evaluates an argument of a builtin, returning its error from the builtin
+#define EVAL_ARG(var, expr)                       \
+    EVAL_TRY(var##Result, context.tryEval(expr)); \
+    auto &var = *var##Result
+
+// string literal argument of a builtin
+static EvalResult<std::string> stringParam(const std::shared_ptr<ASTNode> &param)
+{
+    if (!param->isOptr() || param->getOptr() != OptrType::STRING)
+        return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+    return param->children[0]->getIdent();
+}
+
+// CSV column given as a header name or a zero-based index
+static EvalResult<CsvColumn> csvColumnParam(const std::shared_ptr<ASTNode> &param, Context &context)
+{
+    CsvColumn column;
+    if (param->isOptr() && param->getOptr() == OptrType::STRING)
+    {
+        column.name = param->children[0]->getIdent();
+        return column;
+    }
+    EVAL_ARG(idx, param);
+    if (idx.index() != 1 || std::get<1>(idx) < 0)
+        return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+    column.index = static_cast<size_t>(std::round(std::get<1>(idx)));
+    return column;
+}
+
+// the file library reports failures by throwing, builtins return them
+static std::optional<EvalError> fileError(const std::function<void()> &io)
+{
+    try
+    {
+        io();
+    }
+    catch (const EvalExcept &e)
+    {
+        return e.error();
+    }
+    return std::nullopt;
+}
+
 #define PUSH_UNARY_FUNC(f)               \
     do                                   \
     {                                    \
@@ -247,15 +844,15 @@ void Context::setupInternalFunc()
         [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
         {
             if (params.size() != 2)
-                throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
-            auto x = context.eval(params[0]);
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(x, params[0]);
             if (x.index() != 1)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
             if (!std::get<1>(x))
                 return decimal_t(0);
-            auto y = context.eval(params[1]);
+            EVAL_ARG(y, params[1]);
             if (y.index() != 1)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
             return decimal_t(static_cast<bool>(std::get<1>(y)));
         },
         "and"};
@@ -267,15 +864,15 @@ void Context::setupInternalFunc()
         [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
         {
             if (params.size() != 2)
-                throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
-            auto x = context.eval(params[0]);
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(x, params[0]);
             if (x.index() != 1)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
             if (std::get<1>(x))
                 return decimal_t(1);
-            auto y = context.eval(params[1]);
+            EVAL_ARG(y, params[1]);
             if (y.index() != 1)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
             return decimal_t(static_cast<bool>(std::get<1>(y)));
         },
         "or"};
@@ -287,12 +884,12 @@ void Context::setupInternalFunc()
         [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
         {
             if (params.size() != 3)
-                throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
-            auto cond = context.eval(params[0]);
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(cond, params[0]);
             if (cond.index() != 1)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
 
-            auto ret = context.eval(params[std::get<1>(cond) != decimal_t(0) ? 1 : 2]);
+            EVAL_ARG(ret, params[std::get<1>(cond) != decimal_t(0) ? 1 : 2]);
 
             switch (ret.index())
             {
@@ -316,13 +913,81 @@ void Context::setupInternalFunc()
         [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
         {
             if (params.size() != 1)
-                throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
-            auto l = context.eval(params[0]);
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(l, params[0]);
             if (l.index() != 2)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
             return static_cast<decimal_t>(std::get<2>(l).size());
         },
         "len"};
+
+    static const std::pair<const char *, decimal_t (*)(const ListType &, TaskScheduler *)> reductions[] = {
+        {"sum", listSum},
+        {"prod", listProd},
+        {"min", listMin},
+        {"max", listMax},
+        {"mean", listMean},
+        {"variance", listVariance},
+        {"norm", listNorm},
+    };
+    for (auto &[name, reduce] : reductions)
+    {
+        m_globalVarMap[name] = LambdaType{
+            {"list"},
+            nullptr,
+            true,
+            [reduce = reduce](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+            {
+                if (params.size() != 1)
+                    return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+                EVAL_ARG(l, params[0]);
+                if (l.index() != 2)
+                    return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+                return reduce(std::get<2>(l), context.m_scheduler);
+            },
+            name};
+    }
+    static const std::pair<const char *, ListType (*)(const ListType &, TaskScheduler *)> scans[] = {
+        {"cumsum", listCumsum},
+        {"cumprod", listCumprod},
+        {"cummax", listCummax},
+        {"cummin", listCummin},
+        {"diff", listDiff},
+    };
+    for (auto &[name, scan] : scans)
+    {
+        m_globalVarMap[name] = LambdaType{
+            {"list"},
+            nullptr,
+            true,
+            [scan = scan](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+            {
+                if (params.size() != 1)
+                    return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+                EVAL_ARG(l, params[0]);
+                if (l.index() != 2)
+                    return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+                return scan(std::get<2>(l), context.m_scheduler);
+            },
+            name};
+    }
+    m_globalVarMap["dot"] = LambdaType{
+        {"x", "y"},
+        nullptr,
+        true,
+        [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+        {
+            if (params.size() != 2)
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(x, params[0]);
+            EVAL_ARG(y, params[1]);
+            if (x.index() != 2 || y.index() != 2)
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+            if (std::get<2>(x).size() != std::get<2>(y).size())
+                return EvalError{EVAL_DIFFERENT_LIST_LENGTHS};
+            return listDot(std::get<2>(x), std::get<2>(y), context.m_scheduler);
+        },
+        "dot"};
     m_globalVarMap["assign"] = LambdaType{
         {"list", "idx", "val"},
         nullptr,
@@ -330,21 +995,21 @@ void Context::setupInternalFunc()
         [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
         {
             if (params.size() != 3)
-                throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
-            auto list = context.eval(params[0]);
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(list, params[0]);
             if (list.index() != 2)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
 
             auto ret = std::get<2>(list);
-            auto idx = context.eval(params[1]);
+            EVAL_ARG(idx, params[1]);
             if (idx.index() != 1)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
             size_t i = static_cast<size_t>(std::round(std::get<1>(idx)));
             if (i >= ret.size())
-                throw EvalExcept(EVAL_INDEX_OUT_OF_RANGE);
-            auto val = context.eval(params[2]);
+                return EvalError{EVAL_INDEX_OUT_OF_RANGE};
+            EVAL_ARG(val, params[2]);
             if (val.index() != 1)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
             ret[i] = std::get<1>(val);
             return ret;
         },
@@ -356,14 +1021,14 @@ void Context::setupInternalFunc()
         [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
         {
             if (params.size() != 2)
-                throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
-            auto list = context.eval(params[0]);
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(list, params[0]);
             if (list.index() != 2)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
 
             auto v1 = std::get<2>(list);
 
-            auto v2 = context.eval(params[1]);
+            EVAL_ARG(v2, params[1]);
             if (v2.index() == 1)
             {
                 v1.push_back(std::get<1>(v2));
@@ -371,14 +1036,13 @@ void Context::setupInternalFunc()
             }
             if (v2.index() == 2)
             {
-                auto v = std::get<2>(v2);
+                const auto &v = std::get<2>(v2);
                 v1.reserve(v1.size() + v.size());
                 v1.insert(v1.end(), v.begin(), v.end());
                 return v1;
             }
 
-            throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
-            return v1;
+            return EvalError{EVAL_WRONG_PARAMETER_TYPE};
         },
         "append"};
     m_globalVarMap["slice"] = LambdaType{
@@ -388,29 +1052,139 @@ void Context::setupInternalFunc()
         [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
         {
             if (params.size() != 3)
-                throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
-            auto list = context.eval(params[0]);
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(list, params[0]);
             if (list.index() != 2)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
 
-            auto l = std::get<2>(list);
+            const auto &l = std::get<2>(list);
 
-            auto st = context.eval(params[1]);
+            EVAL_ARG(st, params[1]);
             if (st.index() != 1)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
             auto s = std::round(std::get<1>(st));
             if (s < 0 || s > l.size())
-                throw EvalExcept(EVAL_INDEX_OUT_OF_RANGE);
+                return EvalError{EVAL_INDEX_OUT_OF_RANGE};
 
-            auto ed = context.eval(params[2]);
+            EVAL_ARG(ed, params[2]);
             if (ed.index() != 1)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
             auto e = std::round(std::get<1>(ed));
             if (e < s || e < 0 || e > l.size())
-                throw EvalExcept(EVAL_INDEX_OUT_OF_RANGE);
-            return std::vector<decimal_t>(l.begin() + static_cast<size_t>(s), l.begin() + static_cast<size_t>(e));
+                return EvalError{EVAL_INDEX_OUT_OF_RANGE};
+            return ListType(l.begin() + static_cast<size_t>(s), l.begin() + static_cast<size_t>(e));
         },
         "slice"};
+    m_globalVarMap["pmap"] = LambdaType{
+        {"list", "f"},
+        nullptr,
+        true,
+        [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+        {
+            if (params.size() != 2)
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(list, params[0]);
+            if (list.index() != 2)
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+            EVAL_ARG(f, params[1]);
+            if (f.index() != 3)
+                return EvalError{EVAL_OBJECT_NOT_CALLABLE};
+
+            const auto &l = std::get<2>(list);
+            auto &lambda = std::get<3>(f);
+            ListType ret(l.size());
+            auto err = context.forEachChunk(l.size(), lambda, [&](size_t st, size_t ed) -> std::optional<EvalError>
+                                            {
+                                                for (size_t i = st; i < ed; ++i)
+                                                {
+                                                    auto y = context.tryApply(lambda, {l[i]});
+                                                    if (!y)
+                                                        return y.error();
+                                                    if (y->index() != 1)
+                                                        return EvalError{EVAL_LIST_MEMBER_NOT_DECIMAL};
+                                                    ret[i] = std::get<1>(*y);
+                                                }
+                                                return std::nullopt; });
+            if (err)
+                return *err;
+            return ret;
+        },
+        "pmap"};
+    m_globalVarMap["preduce"] = LambdaType{
+        {"list", "f", "init", "combine"},
+        nullptr,
+        true,
+        [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+        {
+            if (params.size() != 3 && params.size() != 4)
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(list, params[0]);
+            if (list.index() != 2)
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+            EVAL_ARG(f, params[1]);
+            if (f.index() != 3)
+                return EvalError{EVAL_OBJECT_NOT_CALLABLE};
+            EVAL_ARG(acc, params[2]);
+
+            const auto &l = std::get<2>(list);
+            auto &lambda = std::get<3>(f);
+            if (params.size() == 3)
+            {
+                // without a combine function chunks have no seed of their
+                // own, so the fold stays serial
+                for (size_t i = 0; i < l.size(); ++i)
+                {
+                    EVAL_TRY(next, context.tryApply(lambda, {acc, l[i]}));
+                    acc = std::move(*next);
+                }
+            }
+            else
+            {
+                EVAL_ARG(c, params[3]);
+                if (c.index() != 3)
+                    return EvalError{EVAL_OBJECT_NOT_CALLABLE};
+                auto &combine = std::get<3>(c);
+                // every chunk folds from init, a serial run is one chunk
+                std::vector<std::pair<size_t, DataType>> partials;
+                std::mutex partialsMutex;
+                auto err = context.forEachChunk(l.size(), lambda, [&](size_t st, size_t ed) -> std::optional<EvalError>
+                                                {
+                                                    DataType partial = acc;
+                                                    for (size_t i = st; i < ed; ++i)
+                                                    {
+                                                        auto next = context.tryApply(lambda, {partial, l[i]});
+                                                        if (!next)
+                                                            return next.error();
+                                                        partial = std::move(*next);
+                                                    }
+                                                    std::lock_guard<std::mutex> lock(partialsMutex);
+                                                    partials.emplace_back(st, std::move(partial));
+                                                    return std::nullopt; });
+                if (err)
+                    return *err;
+                std::sort(partials.begin(), partials.end(), [](auto &a, auto &b)
+                          { return a.first < b.first; });
+                acc = std::move(partials[0].second);
+                for (size_t i = 1; i < partials.size(); ++i)
+                {
+                    EVAL_TRY(next, context.tryApply(combine, {acc, partials[i].second}));
+                    acc = std::move(*next);
+                }
+            }
+
+            switch (acc.index())
+            {
+            case 1:
+                return std::get<1>(acc);
+            case 2:
+                return std::get<2>(acc);
+            case 3:
+                return std::get<3>(acc);
+            default:
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+            }
+        },
+        "preduce"};
     m_globalVarMap["reverse"] = LambdaType{
         {"list"},
         nullptr,
@@ -418,16 +1192,199 @@ void Context::setupInternalFunc()
         [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
         {
             if (params.size() != 1)
-                throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);
-            auto list = context.eval(params[0]);
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(list, params[0]);
             if (list.index() != 2)
-                throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
 
-            std::vector<decimal_t> l = std::get<2>(list);
+            auto l = std::get<2>(list);
             std::reverse(l.begin(), l.end());
             return l;
         },
         "reverse"};
+    m_globalVarMap["load_f64"] = LambdaType{
+        {"path"},
+        nullptr,
+        true,
+        [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+        {
+            if (!context.fileAccess())
+                return EvalError{EVAL_FILE_ACCESS_DENIED};
+            if (params.size() != 1)
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_TRY(path, stringParam(params[0]));
+            ListType ret;
+            if (auto err = fileError([&]
+                                     { ret = loadF64(*path); }))
+                return *err;
+            return ret;
+        },
+        "load_f64"};
+    m_globalVarMap["load_json"] = LambdaType{
+        {"path"},
+        nullptr,
+        true,
+        [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+        {
+            if (!context.fileAccess())
+                return EvalError{EVAL_FILE_ACCESS_DENIED};
+            if (params.size() != 1)
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_TRY(path, stringParam(params[0]));
+            ListType ret;
+            if (auto err = fileError([&]
+                                     { ret = loadJson(*path); }))
+                return *err;
+            return ret;
+        },
+        "load_json"};
+    m_globalVarMap["save_json"] = LambdaType{
+        {"path", "list"},
+        nullptr,
+        true,
+        [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+        {
+            if (!context.fileAccess())
+                return EvalError{EVAL_FILE_ACCESS_DENIED};
+            if (params.size() != 2)
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_TRY(path, stringParam(params[0]));
+            EVAL_ARG(list, params[1]);
+            if (list.index() != 2)
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+            if (auto err = fileError([&]
+                                     { saveJson(*path, std::get<2>(list)); }))
+                return *err;
+            return static_cast<decimal_t>(std::get<2>(list).size());
+        },
+        "save_json"};
+    m_globalVarMap["load_csv"] = LambdaType{
+        {"path", "column"},
+        nullptr,
+        true,
+        [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+        {
+            if (!context.fileAccess())
+                return EvalError{EVAL_FILE_ACCESS_DENIED};
+            if (params.size() != 2)
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_TRY(path, stringParam(params[0]));
+            EVAL_TRY(column, csvColumnParam(params[1], context));
+            ListType ret;
+            if (auto err = fileError([&]
+                                     { ret = loadCsv(*path, *column, context.m_scheduler); }))
+                return *err;
+            return ret;
+        },
+        "load_csv"};
+    m_globalVarMap["fold_csv"] = LambdaType{
+        {"path", "column", "f", "init"},
+        nullptr,
+        true,
+        [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+        {
+            if (!context.fileAccess())
+                return EvalError{EVAL_FILE_ACCESS_DENIED};
+            if (params.size() != 4)
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_TRY(path, stringParam(params[0]));
+            EVAL_TRY(column, csvColumnParam(params[1], context));
+            EVAL_ARG(f, params[2]);
+            if (f.index() != 3)
+                return EvalError{EVAL_OBJECT_NOT_CALLABLE};
+            EVAL_ARG(acc, params[3]);
+
+            auto &lambda = std::get<3>(f);
+            std::optional<EvalError> failed;
+            auto err = fileError([&]
+                                 { foldCsv(*path, *column, [&](const decimal_t *values, size_t n)
+                                           {
+                                               for (size_t i = 0; i < n; ++i)
+                                               {
+                                                   auto next = context.tryApply(lambda, {acc, values[i]});
+                                                   if (!next)
+                                                   {
+                                                       failed = next.error();
+                                                       return false;
+                                                   }
+                                                   acc = std::move(*next);
+                                               }
+                                               return true; },
+                                           context.m_scheduler); });
+            if (failed)
+                return *failed;
+            if (err)
+                return *err;
+
+            switch (acc.index())
+            {
+            case 1:
+                return std::get<1>(acc);
+            case 2:
+                return std::get<2>(acc);
+            case 3:
+                return std::get<3>(acc);
+            default:
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+            }
+        },
+        "fold_csv"};
+
+    static const std::pair<const char *, RollingOp> rollingFuncs[] = {
+        {"rolling_sum", RollingOp::SUM},
+        {"rolling_mean", RollingOp::MEAN},
+        {"rolling_min", RollingOp::MIN},
+        {"rolling_max", RollingOp::MAX},
+        {"rolling_var", RollingOp::VAR},
+        {"rolling_std", RollingOp::STD},
+    };
+    for (auto &[name, op] : rollingFuncs)
+    {
+        m_globalVarMap[name] = LambdaType{
+            {"list", "w"},
+            nullptr,
+            true,
+            [op = op](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+            {
+                if (params.size() != 2)
+                    return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+                EVAL_ARG(list, params[0]);
+                EVAL_ARG(w, params[1]);
+                if (list.index() != 2 || w.index() != 1)
+                    return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+                auto window = std::round(std::get<1>(w));
+                if (!(window >= 1) || (window < 2 && (op == RollingOp::VAR || op == RollingOp::STD)))
+                    return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+
+                const auto &l = std::get<2>(list);
+                ListType ret;
+                if (window <= l.size())
+                    RollingWindow(op, static_cast<size_t>(window)).push(l.data(), l.size(), ret);
+                return ret;
+            },
+            name};
+    }
+    m_globalVarMap["ewma"] = LambdaType{
+        {"list", "alpha"},
+        nullptr,
+        true,
+        [](const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) -> InternalFuncRet
+        {
+            if (params.size() != 2)
+                return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};
+            EVAL_ARG(list, params[0]);
+            EVAL_ARG(alpha, params[1]);
+            if (list.index() != 2 || alpha.index() != 1)
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+            if (!(std::get<1>(alpha) > 0 && std::get<1>(alpha) <= 1))
+                return EvalError{EVAL_WRONG_PARAMETER_TYPE};
+
+            const auto &l = std::get<2>(list);
+            ListType ret;
+            Ewma(std::get<1>(alpha)).push(l.data(), l.size(), ret);
+            return ret;
+        },
+        "ewma"};
 }
 
 } // namespace eval
\ No newline at end of file
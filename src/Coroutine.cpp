@@ -0,0 +1,225 @@
+#include <evaluator/Coroutine.h>
+
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+namespace eval
+{
+
+#ifndef _WIN32
+// limits of the stack of the coroutine running on this thread, 0 when none
+static thread_local uintptr_t t_coroutineLow = 0;
+static thread_local uintptr_t t_coroutineHigh = 0;
+#endif
+
+struct Coroutine::Impl
+{
+    std::function<void()> body;
+    std::exception_ptr exception;
+    bool finished = false;
+    bool running = false;
+
+#ifdef _WIN32
+    LPVOID fiber = nullptr;
+    LPVOID caller = nullptr;
+
+    static void CALLBACK entry(LPVOID arg)
+    {
+        auto impl = static_cast<Impl *>(arg);
+        impl->run();
+        while (true)
+            SwitchToFiber(impl->caller);
+    }
+#else
+    ucontext_t context;
+    ucontext_t caller;
+    // guard page followed by the usable stack
+    void *mapping = MAP_FAILED;
+    size_t mappingSize = 0;
+    uintptr_t stackLow = 0;
+    uintptr_t stackHigh = 0;
+
+    ~Impl()
+    {
+        if (mapping != MAP_FAILED)
+            munmap(mapping, mappingSize);
+    }
+
+    // makecontext only passes int arguments
+    static void entry(unsigned lo, unsigned hi)
+    {
+        auto impl = reinterpret_cast<Impl *>((static_cast<uintptr_t>(hi) << 16 << 16) | lo);
+        impl->run();
+    }
+#endif
+
+    void run()
+    {
+        try
+        {
+            body();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        finished = true;
+    }
+};
+
+Coroutine::Coroutine(std::function<void()> body, size_t stackSize)
+    : m_impl(std::make_unique<Impl>())
+{
+    m_impl->body = std::move(body);
+#ifdef _WIN32
+    m_impl->fiber = CreateFiber(stackSize, &Impl::entry, m_impl.get());
+    if (m_impl->fiber == nullptr)
+        throw std::bad_alloc();
+#else
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    stackSize = (stackSize + page - 1) / page * page;
+    m_impl->mappingSize = stackSize + page;
+    m_impl->mapping = mmap(nullptr, m_impl->mappingSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m_impl->mapping == MAP_FAILED)
+        throw std::bad_alloc();
+    // stacks grow down, the guard page is the lowest one
+    if (mprotect(m_impl->mapping, page, PROT_NONE) != 0)
+        throw std::bad_alloc();
+    m_impl->stackLow = reinterpret_cast<uintptr_t>(m_impl->mapping) + page;
+    m_impl->stackHigh = m_impl->stackLow + stackSize;
+
+    getcontext(&m_impl->context);
+    m_impl->context.uc_stack.ss_sp = reinterpret_cast<void *>(m_impl->stackLow);
+    m_impl->context.uc_stack.ss_size = stackSize;
+    m_impl->context.uc_link = &m_impl->caller;
+    auto p = reinterpret_cast<uintptr_t>(m_impl.get());
+    makecontext(&m_impl->context, reinterpret_cast<void (*)()>(&Impl::entry), 2,
+                static_cast<unsigned>(p & 0xffffffffu), static_cast<unsigned>(p >> 16 >> 16));
+#endif
+}
+
+Coroutine::~Coroutine()
+{
+    assert(!m_impl->running);
+#ifdef _WIN32
+    if (m_impl->fiber != nullptr)
+        DeleteFiber(m_impl->fiber);
+#endif
+}
+
+bool Coroutine::resume()
+{
+    assert(!m_impl->running);
+    if (m_impl->finished)
+        return false;
+
+    m_impl->running = true;
+#ifdef _WIN32
+    if (!IsThreadAFiber())
+        ConvertThreadToFiber(nullptr);
+    m_impl->caller = GetCurrentFiber();
+    SwitchToFiber(m_impl->fiber);
+#else
+    auto savedLow = std::exchange(t_coroutineLow, m_impl->stackLow);
+    auto savedHigh = std::exchange(t_coroutineHigh, m_impl->stackHigh);
+    swapcontext(&m_impl->caller, &m_impl->context);
+    t_coroutineLow = savedLow;
+    t_coroutineHigh = savedHigh;
+#endif
+    m_impl->running = false;
+
+    if (m_impl->exception != nullptr)
+        std::rethrow_exception(std::exchange(m_impl->exception, nullptr));
+    return !m_impl->finished;
+}
+
+void Coroutine::yield()
+{
+    assert(m_impl->running);
+#ifdef _WIN32
+    SwitchToFiber(m_impl->caller);
+#else
+    swapcontext(&m_impl->context, &m_impl->caller);
+#endif
+}
+
+bool Coroutine::finished() const
+{
+    return m_impl->finished;
+}
+
+size_t Coroutine::stackLeft() const
+{
+#ifdef _WIN32
+    if (!m_impl->running || GetCurrentFiber() != m_impl->fiber)
+        return SIZE_MAX;
+    // the limits of the running fiber, the low end includes its guard pages
+    ULONG_PTR low, high;
+    GetCurrentThreadStackLimits(&low, &high);
+    const uintptr_t stackLow = low, stackHigh = high;
+#else
+    const uintptr_t stackLow = m_impl->stackLow, stackHigh = m_impl->stackHigh;
+#endif
+    char probe;
+    auto sp = reinterpret_cast<uintptr_t>(&probe);
+    if (sp < stackLow || sp >= stackHigh)
+        return SIZE_MAX;
+    return sp - stackLow;
+}
+
+size_t currentStackLeft()
+{
+    uintptr_t stackLow = 0, stackHigh = 0;
+#ifdef _WIN32
+    // also reports the limits of the running fiber
+    ULONG_PTR low, high;
+    GetCurrentThreadStackLimits(&low, &high);
+    stackLow = low;
+    stackHigh = high;
+#else
+    if (t_coroutineLow != 0)
+    {
+        stackLow = t_coroutineLow;
+        stackHigh = t_coroutineHigh;
+    }
+    else
+    {
+#ifdef __linux__
+        static thread_local const std::pair<uintptr_t, uintptr_t> threadStack = []
+        {
+            std::pair<uintptr_t, uintptr_t> ret{0, 0};
+            pthread_attr_t attr;
+            if (pthread_getattr_np(pthread_self(), &attr) != 0)
+                return ret;
+            void *addr;
+            size_t size;
+            if (pthread_attr_getstack(&attr, &addr, &size) == 0)
+                ret = {reinterpret_cast<uintptr_t>(addr), reinterpret_cast<uintptr_t>(addr) + size};
+            pthread_attr_destroy(&attr);
+            return ret;
+        }();
+        stackLow = threadStack.first;
+        stackHigh = threadStack.second;
+#endif
+    }
+#endif
+    char probe;
+    auto sp = reinterpret_cast<uintptr_t>(&probe);
+    if (sp < stackLow || sp >= stackHigh)
+        return SIZE_MAX;
+    return sp - stackLow;
+}
+
+} // namespace eval
@@ -0,0 +1,308 @@
+#include <evaluator/DataIO.h>
+#include <evaluator/MappedFile.h>
+#include <evaluator/Format.h>
+#include <evaluator/Scheduler.h>
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+namespace eval
+{
+
+constexpr size_t WRITE_BUFFER_SIZE = 1 << 16;
+
+static bool littleEndian()
+{
+    const uint16_t one = 1;
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+ListType loadF64(const std::string &path)
+{
+    static_assert(sizeof(decimal_t) == 8, "float64 files need a 64-bit decimal_t");
+    auto file = MappedFile::open(path);
+    if (file->size() % sizeof(decimal_t) != 0)
+        throw EvalExcept(EVAL_FILE_MALFORMED);
+    const size_t n = file->size() / sizeof(decimal_t);
+    if (n == 0)
+        return ListType();
+    if (littleEndian())
+        return ListType(reinterpret_cast<const decimal_t *>(file->data()), n, file);
+
+    ListType ret(n);
+    auto out = ret.data();
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned char bytes[sizeof(decimal_t)];
+        std::memcpy(bytes, file->data() + i * sizeof(decimal_t), sizeof(bytes));
+        for (size_t b = 0; b < sizeof(bytes) / 2; ++b)
+            std::swap(bytes[b], bytes[sizeof(bytes) - 1 - b]);
+        std::memcpy(out + i, bytes, sizeof(bytes));
+    }
+    return ret;
+}
+
+ListType loadJson(const std::string &path)
+{
+    auto file = MappedFile::open(path);
+    std::vector<decimal_t> list;
+    try
+    {
+        JsonParser().parseNumberArray(std::string_view(file->data(), file->size()), list);
+    }
+    catch (const JsonParseExcept &)
+    {
+        throw EvalExcept(EVAL_FILE_MALFORMED);
+    }
+    return list;
+}
+
+void saveJson(const std::string &path, const ListType &list)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        throw EvalExcept(EVAL_FILE_NOT_WRITABLE);
+    std::string buf;
+    buf.reserve(WRITE_BUFFER_SIZE + DECIMAL_CHARS_MAX + 2);
+    buf += '[';
+    for (size_t i = 0; i < list.size(); ++i)
+    {
+        if (i != 0)
+            buf += ", ";
+        if (std::isfinite(list[i]))
+            appendDecimal(buf, list[i]);
+        else
+            buf += "null";
+        if (buf.size() >= WRITE_BUFFER_SIZE)
+        {
+            out.write(buf.data(), buf.size());
+            buf.clear();
+        }
+    }
+    buf += "]\n";
+    out.write(buf.data(), buf.size());
+    if (!out.flush())
+        throw EvalExcept(EVAL_FILE_NOT_WRITABLE);
+}
+
+namespace
+{
+
+const char *lineEnd(const char *p, const char *end)
+{
+    auto nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    return nl == nullptr ? end : nl;
+}
+
+bool isBlank(const char *first, const char *last)
+{
+    for (; first != last; ++first)
+        if (*first != ' ' && *first != '\t' && *first != '\r')
+            return false;
+    return true;
+}
+
+// field `column` of the line [first, last), false if the line is shorter
+bool findField(const char *first, const char *last, size_t column, const char *&fieldFirst, const char *&fieldLast)
+{
+    for (size_t i = 0;; ++i)
+    {
+        const char *start = first;
+        while (first != last && *first == ' ')
+            ++first;
+        if (first != last && *first == '"')
+        {
+            for (++first; first != last; ++first)
+                if (*first == '"' && (++first == last || *first != '"'))
+                    break;
+        }
+        while (first != last && *first != ',')
+            ++first;
+        if (i == column)
+        {
+            fieldFirst = start;
+            fieldLast = first;
+            return true;
+        }
+        if (first == last)
+            return false;
+        ++first;
+    }
+}
+
+bool parseField(const char *first, const char *last, decimal_t &out)
+{
+    while (first != last && (*first == ' ' || *first == '\t'))
+        ++first;
+    while (first != last && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+        --last;
+    if (last - first >= 2 && *first == '"' && last[-1] == '"')
+    {
+        ++first;
+        --last;
+    }
+    if (first == last)
+    {
+        out = std::nan("");
+        return true;
+    }
+    if (*first == '+')
+        ++first;
+    auto ret = std::from_chars(first, last, out);
+    return ret.ec == std::errc() && ret.ptr == last;
+}
+
+size_t countRows(const char *first, const char *last)
+{
+    size_t n = 0;
+    while (first != last)
+    {
+        const char *eol = lineEnd(first, last);
+        n += !isBlank(first, eol);
+        first = eol == last ? last : eol + 1;
+    }
+    return n;
+}
+
+void parseRows(const char *first, const char *last, size_t column, decimal_t *out)
+{
+    while (first != last)
+    {
+        const char *eol = lineEnd(first, last);
+        const char *fieldFirst, *fieldLast;
+        if (!isBlank(first, eol))
+        {
+            if (!findField(first, eol, column, fieldFirst, fieldLast) || !parseField(fieldFirst, fieldLast, *out++))
+                throw EvalExcept(EVAL_FILE_MALFORMED);
+        }
+        first = eol == last ? last : eol + 1;
+    }
+}
+
+// parses the whole lines in [first, last) into out, resized to fit
+void parseRegion(const char *first, const char *last, size_t column, TaskScheduler *scheduler,
+                 std::vector<decimal_t> &out)
+{
+    std::vector<const char *> bounds{first};
+    while (bounds.back() != last)
+    {
+        const char *p = bounds.back();
+        bounds.push_back(last - p <= static_cast<ptrdiff_t>(CSV_CHUNK_SIZE) ? last : lineEnd(p + CSV_CHUNK_SIZE, last));
+        if (bounds.back() != last)
+            ++bounds.back();
+    }
+    const size_t chunks = bounds.size() - 1;
+    auto forEachChunk = [&](auto &&f)
+    {
+        if (scheduler == nullptr || chunks < 2)
+            for (size_t i = 0; i < chunks; ++i)
+                f(i);
+        else
+            scheduler->parallelFor(chunks, f);
+    };
+
+    std::vector<size_t> offsets(chunks + 1, 0);
+    forEachChunk([&](size_t i)
+                 { offsets[i + 1] = countRows(bounds[i], bounds[i + 1]); });
+    for (size_t i = 0; i < chunks; ++i)
+        offsets[i + 1] += offsets[i];
+    out.resize(offsets[chunks]);
+    forEachChunk([&](size_t i)
+                 { parseRows(bounds[i], bounds[i + 1], column, out.data() + offsets[i]); });
+}
+
+// Resolves the column against the first line of the file and returns the
+// offset where the data starts, after the header if there is one.
+size_t readHeader(const char *first, const char *last, const CsvColumn &column, size_t &index)
+{
+    const char *eol = lineEnd(first, last);
+    const size_t next = eol == last ? last - first : eol - first + 1;
+    const char *fieldFirst, *fieldLast;
+    if (column.name.empty())
+    {
+        index = column.index;
+        decimal_t d;
+        bool header = findField(first, eol, index, fieldFirst, fieldLast) && !parseField(fieldFirst, fieldLast, d);
+        return header ? next : 0;
+    }
+    for (index = 0; findField(first, eol, index, fieldFirst, fieldLast); ++index)
+    {
+        while (fieldFirst != fieldLast && (*fieldFirst == ' ' || *fieldFirst == '"'))
+            ++fieldFirst;
+        while (fieldFirst != fieldLast && (fieldLast[-1] == ' ' || fieldLast[-1] == '"' || fieldLast[-1] == '\r'))
+            --fieldLast;
+        if (std::string(fieldFirst, fieldLast) == column.name)
+            return next;
+    }
+    throw EvalExcept(EVAL_FILE_MALFORMED);
+}
+
+} // namespace
+
+ListType loadCsv(const std::string &path, const CsvColumn &column, TaskScheduler *scheduler)
+{
+    auto file = MappedFile::open(path);
+    const char *first = file->data(), *last = first + file->size();
+    size_t index;
+    first += readHeader(first, last, column, index);
+    std::vector<decimal_t> list;
+    parseRegion(first, last, index, scheduler, list);
+    return list;
+}
+
+void foldCsv(const std::string &path, const CsvColumn &column,
+             const std::function<bool(const decimal_t *, size_t)> &consume,
+             TaskScheduler *scheduler)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw EvalExcept(EVAL_FILE_NOT_READABLE);
+    std::vector<char> buf(CSV_BLOCK_SIZE);
+    std::vector<decimal_t> values;
+    size_t carried = 0, index = 0;
+    bool first = true;
+    while (true)
+    {
+        in.read(buf.data() + carried, buf.size() - carried);
+        const size_t size = carried + static_cast<size_t>(in.gcount());
+        const bool eof = size < buf.size();
+        if (in.bad())
+            throw EvalExcept(EVAL_FILE_NOT_READABLE);
+
+        // parse whole lines only and carry the rest over to the next block
+        const char *begin = buf.data(), *end = begin + size;
+        if (!eof)
+        {
+            while (end != begin && end[-1] != '\n')
+                --end;
+            if (end == begin)
+            {
+                // a single line longer than the block
+                buf.resize(buf.size() * 2);
+                carried = size;
+                continue;
+            }
+        }
+        if (first)
+        {
+            begin += readHeader(begin, end, column, index);
+            first = false;
+        }
+        parseRegion(begin, end, index, scheduler, values);
+        if (!values.empty() && !consume(values.data(), values.size()))
+            return;
+
+        if (eof)
+            return;
+        carried = buf.data() + size - end;
+        std::memmove(buf.data(), end, carried);
+    }
+}
+
+} // namespace eval
@@ -0,0 +1,82 @@
+#include <evaluator/Format.h>
+
+#include <charconv>
+
+namespace eval
+{
+
+char *formatDecimal(char *first, decimal_t d)
+{
+    return std::to_chars(first, first + DECIMAL_CHARS_MAX, d).ptr;
+}
+
+void appendDecimal(std::string &out, decimal_t d)
+{
+    char buf[DECIMAL_CHARS_MAX];
+    out.append(buf, formatDecimal(buf, d));
+}
+
+void appendList(std::string &out, const ListType &l)
+{
+    // write straight into the string, sized for the worst case
+    const size_t begin = out.size();
+    out.resize(begin + 2 + l.size() * (DECIMAL_CHARS_MAX + 2));
+    char *p = &out[begin];
+    *p++ = '[';
+    for (size_t i = 0; i < l.size(); ++i)
+    {
+        if (i != 0)
+        {
+            *p++ = ',';
+            *p++ = ' ';
+        }
+        p = formatDecimal(p, l[i]);
+    }
+    *p++ = ']';
+    out.resize(p - out.data());
+}
+
+void appendValue(std::string &out, const DataType &val, bool printAST)
+{
+    switch (val.index())
+    {
+    case 1:
+        appendDecimal(out, std::get<1>(val));
+        break;
+    case 2:
+        appendList(out, std::get<2>(val));
+        break;
+    case 3:
+    {
+        auto &l = std::get<3>(val);
+        out += "@(";
+        for (size_t i = 0; i < l.params.size(); ++i)
+        {
+            if (i != 0)
+                out += ", ";
+            out += l.params[i];
+        }
+        if (!printAST || l.expr == nullptr)
+            out += "){...}";
+        else
+        {
+            out += "){\n";
+            out += l.expr->toJson().toStringFormatted();
+            out += "\n}";
+        }
+        break;
+    }
+    }
+}
+
+void appendError(std::string &out, const EvalError &err)
+{
+    out += err.what();
+    if (err.pos != EVAL_NO_POS)
+    {
+        out += " at ";
+        out += std::to_string(err.pos);
+    }
+}
+
+} // namespace eval
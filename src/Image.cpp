@@ -0,0 +1,518 @@
+#include <evaluator/Image.h>
+#include <evaluator/MappedFile.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace eval
+{
+
+namespace
+{
+
+constexpr char IMAGE_MAGIC[8] = {'E', 'V', 'A', 'L', 'I', 'M', 'G', '\0'};
+constexpr uint32_t IMAGE_BYTE_ORDER = 0x01020304;
+constexpr uint32_t IMAGE_NO_INDEX = UINT32_MAX;
+
+static_assert(sizeof(decimal_t) == 8, "images store decimals as float64");
+
+struct ImageSection
+{
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct ImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t fileSize;
+    ImageSection strings;
+    ImageSection symbols;
+    ImageSection nodes;
+    ImageSection children;
+    ImageSection params;
+    ImageSection vars;
+};
+
+struct ImageSymbol
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+enum ImageNodeKind : uint8_t
+{
+    NODE_OPTR,
+    NODE_DECIMAL,
+    NODE_IDENT
+};
+
+// children always precede their parent
+struct ImageNode
+{
+    uint8_t kind;
+    uint8_t optr;
+    uint16_t reserved;
+    uint32_t symbol;
+    uint32_t firstChild;
+    uint32_t childCount;
+    uint64_t pos;
+    decimal_t decimal;
+};
+
+enum ImageVarKind : uint32_t
+{
+    VAR_VOID,
+    VAR_DECIMAL,
+    VAR_LIST,
+    VAR_LAMBDA,
+    VAR_BUILTIN
+};
+
+// lists: offset of the block in the file and its length; lambdas: first
+// parameter, number of parameters and the body node; builtins: node holds the
+// symbol of the internal function
+struct ImageVar
+{
+    uint32_t name;
+    uint32_t kind;
+    uint64_t offset;
+    uint64_t count;
+    uint32_t node;
+    uint32_t reserved;
+    decimal_t decimal;
+};
+
+static_assert(sizeof(ImageHeader) == 120 && sizeof(ImageNode) == 32 && sizeof(ImageVar) == 40,
+              "image records must not depend on the compiler");
+
+size_t alignUp(size_t n, size_t align)
+{
+    return (n + align - 1) / align * align;
+}
+
+class ImageWriter
+{
+public:
+    void addVar(const std::string &name, const DataType &val)
+    {
+        ImageVar var{};
+        var.name = intern(name);
+        var.node = IMAGE_NO_INDEX;
+        switch (val.index())
+        {
+        case 1:
+            var.kind = VAR_DECIMAL;
+            var.decimal = std::get<1>(val);
+            break;
+        case 2:
+            var.kind = VAR_LIST;
+            var.count = std::get<2>(val).size();
+            m_lists.push_back(&std::get<2>(val));
+            break;
+        case 3:
+        {
+            auto &lambda = std::get<3>(val);
+            if (lambda.isInternalFunc)
+            {
+                var.kind = VAR_BUILTIN;
+                var.node = intern(lambda.internalFuncName);
+                break;
+            }
+            var.kind = VAR_LAMBDA;
+            var.offset = m_params.size();
+            var.count = lambda.params.size();
+            for (auto &p : lambda.params)
+                m_params.push_back(intern(p));
+            var.node = addNode(lambda.expr);
+            break;
+        }
+        default:
+            var.kind = VAR_VOID;
+        }
+        m_vars.push_back(var);
+    }
+
+    void write(std::ostream &out)
+    {
+        ImageHeader header{};
+        std::memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+        header.version = IMAGE_VERSION;
+        header.byteOrder = IMAGE_BYTE_ORDER;
+
+        size_t offset = sizeof(ImageHeader);
+        auto place = [&](ImageSection &section, size_t count, size_t elemSize)
+        {
+            offset = alignUp(offset, 8);
+            section = {offset, count};
+            offset += count * elemSize;
+        };
+        place(header.strings, m_strings.size(), 1);
+        place(header.symbols, m_symbols.size(), sizeof(ImageSymbol));
+        place(header.nodes, m_nodes.size(), sizeof(ImageNode));
+        place(header.children, m_children.size(), sizeof(uint32_t));
+        place(header.params, m_params.size(), sizeof(uint32_t));
+        place(header.vars, m_vars.size(), sizeof(ImageVar));
+        for (size_t i = 0, l = 0; i < m_vars.size(); ++i)
+        {
+            if (m_vars[i].kind != VAR_LIST)
+                continue;
+            offset = alignUp(offset, IMAGE_ALIGN);
+            m_vars[i].offset = offset;
+            offset += m_lists[l++]->size() * sizeof(decimal_t);
+        }
+        header.fileSize = offset;
+
+        size_t written = 0;
+        auto put = [&](size_t at, const void *data, size_t bytes)
+        {
+            static const char zeros[IMAGE_ALIGN] = {};
+            out.write(zeros, at - written);
+            out.write(static_cast<const char *>(data), bytes);
+            written = at + bytes;
+        };
+        put(0, &header, sizeof(header));
+        put(header.strings.offset, m_strings.data(), m_strings.size());
+        put(header.symbols.offset, m_symbols.data(), m_symbols.size() * sizeof(ImageSymbol));
+        put(header.nodes.offset, m_nodes.data(), m_nodes.size() * sizeof(ImageNode));
+        put(header.children.offset, m_children.data(), m_children.size() * sizeof(uint32_t));
+        put(header.params.offset, m_params.data(), m_params.size() * sizeof(uint32_t));
+        put(header.vars.offset, m_vars.data(), m_vars.size() * sizeof(ImageVar));
+        for (size_t i = 0, l = 0; i < m_vars.size(); ++i)
+            if (m_vars[i].kind == VAR_LIST)
+            {
+                auto &list = *m_lists[l++];
+                put(m_vars[i].offset, list.data(), list.size() * sizeof(decimal_t));
+            }
+    }
+
+private:
+    uint32_t intern(const std::string &s)
+    {
+        auto ite = m_symbolIds.find(s);
+        if (ite != m_symbolIds.end())
+            return ite->second;
+        uint32_t id = static_cast<uint32_t>(m_symbols.size());
+        m_symbols.push_back({static_cast<uint32_t>(m_strings.size()), static_cast<uint32_t>(s.size())});
+        m_strings += s;
+        m_symbolIds.emplace(s, id);
+        return id;
+    }
+
+    uint32_t addNode(const std::shared_ptr<ASTNode> &node)
+    {
+        if (node == nullptr)
+            return IMAGE_NO_INDEX;
+        auto ite = m_nodeIds.find(node.get());
+        if (ite != m_nodeIds.end())
+            return ite->second;
+
+        std::vector<uint32_t> children;
+        children.reserve(node->children.size());
+        for (auto &c : node->children)
+            children.push_back(addNode(c));
+
+        ImageNode rec{};
+        switch (node->value.index())
+        {
+        case 0:
+            rec.kind = NODE_OPTR;
+            rec.optr = static_cast<uint8_t>(node->getOptr());
+            break;
+        case 1:
+            rec.kind = NODE_DECIMAL;
+            rec.decimal = node->getDecimal();
+            break;
+        default:
+            rec.kind = NODE_IDENT;
+            rec.symbol = intern(std::get<2>(node->value));
+        }
+        rec.firstChild = static_cast<uint32_t>(m_children.size());
+        rec.childCount = static_cast<uint32_t>(children.size());
+        rec.pos = node->pos;
+        m_children.insert(m_children.end(), children.begin(), children.end());
+
+        uint32_t id = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(rec);
+        m_nodeIds.emplace(node.get(), id);
+        return id;
+    }
+
+private:
+    std::string m_strings;
+    std::vector<ImageSymbol> m_symbols;
+    std::unordered_map<std::string, uint32_t> m_symbolIds;
+    std::vector<ImageNode> m_nodes;
+    std::unordered_map<const ASTNode *, uint32_t> m_nodeIds;
+    std::vector<uint32_t> m_children;
+    std::vector<uint32_t> m_params;
+    std::vector<ImageVar> m_vars;
+    std::vector<const ListType *> m_lists;
+};
+
+class ImageReader
+{
+public:
+    explicit ImageReader(std::shared_ptr<const MappedFile> file)
+        : m_file(std::move(file)), m_base(m_file->data()), m_size(m_file->size())
+    {
+        check(m_size >= sizeof(ImageHeader));
+        std::memcpy(&m_header, m_base, sizeof(ImageHeader));
+        check(std::memcmp(m_header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0 &&
+              m_header.version == IMAGE_VERSION &&
+              m_header.byteOrder == IMAGE_BYTE_ORDER &&
+              m_header.fileSize == m_size);
+    }
+
+    VarMap read()
+    {
+        auto strings = section<char>(m_header.strings);
+        auto symbols = section<ImageSymbol>(m_header.symbols);
+        m_symbols.reserve(m_header.symbols.count);
+        for (size_t i = 0; i < m_header.symbols.count; ++i)
+        {
+            check(uint64_t(symbols[i].offset) + symbols[i].length <= m_header.strings.count);
+            m_symbols.emplace_back(strings + symbols[i].offset, symbols[i].length);
+        }
+
+        auto nodes = section<ImageNode>(m_header.nodes);
+        auto children = section<uint32_t>(m_header.children);
+        m_nodes.reserve(m_header.nodes.count);
+        for (size_t i = 0; i < m_header.nodes.count; ++i)
+        {
+            auto &rec = nodes[i];
+            std::shared_ptr<ASTNode> node;
+            if (rec.kind == NODE_OPTR)
+            {
+                check(rec.optr <= static_cast<uint8_t>(OptrType::STRING));
+                node = std::make_shared<ASTNode>(static_cast<OptrType>(rec.optr));
+            }
+            else if (rec.kind == NODE_DECIMAL)
+                node = std::make_shared<ASTNode>(rec.decimal);
+            else
+            {
+                check(rec.kind == NODE_IDENT);
+                node = std::make_shared<ASTNode>(symbol(rec.symbol));
+            }
+            node->pos = static_cast<size_t>(rec.pos);
+
+            check(uint64_t(rec.firstChild) + rec.childCount <= m_header.children.count);
+            node->children.reserve(rec.childCount);
+            for (size_t c = 0; c < rec.childCount; ++c)
+                node->children.push_back(this->node(children[rec.firstChild + c], i));
+            checkShape(*node);
+            m_nodes.push_back(std::move(node));
+        }
+
+        auto params = section<uint32_t>(m_header.params);
+        auto vars = section<ImageVar>(m_header.vars);
+        VarMap varMap;
+        varMap.reserve(m_header.vars.count);
+        for (size_t i = 0; i < m_header.vars.count; ++i)
+        {
+            auto &rec = vars[i];
+            DataType val;
+            switch (rec.kind)
+            {
+            case VAR_VOID:
+                break;
+            case VAR_DECIMAL:
+                val = rec.decimal;
+                break;
+            case VAR_LIST:
+            {
+                check(rec.offset % alignof(decimal_t) == 0 && rec.offset <= m_size &&
+                      rec.count <= (m_size - rec.offset) / sizeof(decimal_t));
+                val = ListType(reinterpret_cast<const decimal_t *>(m_base + rec.offset), rec.count, m_file);
+                break;
+            }
+            case VAR_LAMBDA:
+            {
+                check(rec.offset <= m_header.params.count && rec.count <= m_header.params.count - rec.offset);
+                LambdaType lambda;
+                lambda.params.reserve(rec.count);
+                for (size_t p = 0; p < rec.count; ++p)
+                    lambda.params.push_back(symbol(params[rec.offset + p]));
+                check(rec.node != IMAGE_NO_INDEX);
+                lambda.expr = node(rec.node, m_nodes.size());
+                check(isExpr(*lambda.expr));
+                val = std::move(lambda);
+                break;
+            }
+            case VAR_BUILTIN:
+            {
+                auto &builtins = Context::builtins()->varMap;
+                auto ite = builtins.find(symbol(rec.node));
+                check(ite != builtins.end());
+                val = ite->second;
+                break;
+            }
+            default:
+                check(false);
+            }
+            varMap.insert_or_assign(symbol(rec.name), std::move(val));
+        }
+        return varMap;
+    }
+
+private:
+    static void check(bool ok)
+    {
+        if (!ok)
+            throw EvalExcept(EVAL_IMAGE_INVALID);
+    }
+
+    static bool hasOptr(const ASTNode &node, OptrType optr)
+    {
+        return node.isOptr() && node.getOptr() == optr;
+    }
+
+    // what the parser may produce where a value is expected
+    static bool isExpr(const ASTNode &node)
+    {
+        if (!node.isOptr())
+            return true;
+        switch (node.getOptr())
+        {
+        case OptrType::ASSIGN:
+        case OptrType::ASSIGN_LAMBDA:
+        case OptrType::EXPR_LIST:
+        case OptrType::PARAM_LIST:
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    // the evaluator indexes children without checking, so every node must
+    // have the children the parser gives its operator
+    static void checkShape(const ASTNode &node)
+    {
+        auto &c = node.children;
+        for (auto &child : c)
+            check(child != nullptr);
+        if (!node.isOptr())
+        {
+            check(c.empty());
+            return;
+        }
+        switch (node.getOptr())
+        {
+        case OptrType::ASSIGN:
+            check(c.size() == 2 && c[0]->isIdent() && isExpr(*c[1]));
+            break;
+        case OptrType::ASSIGN_LAMBDA:
+            check(c.size() == 3 && c[0]->isIdent() && hasOptr(*c[1], OptrType::PARAM_LIST) && isExpr(*c[2]));
+            break;
+        case OptrType::NEG:
+            check(c.size() == 1 && isExpr(*c[0]));
+            break;
+        case OptrType::ADD:
+        case OptrType::SUB:
+        case OptrType::MUL:
+        case OptrType::DIV:
+        case OptrType::POW:
+        case OptrType::INDEX:
+            check(c.size() == 2 && isExpr(*c[0]) && isExpr(*c[1]));
+            break;
+        case OptrType::CALL:
+            check(c.size() == 2 && isExpr(*c[0]) && hasOptr(*c[1], OptrType::EXPR_LIST));
+            break;
+        case OptrType::LAMBDA:
+            check(c.size() == 2 && hasOptr(*c[0], OptrType::PARAM_LIST) && isExpr(*c[1]));
+            break;
+        case OptrType::LIST:
+        case OptrType::EXPR_LIST:
+            for (auto &child : c)
+                check(isExpr(*child));
+            break;
+        case OptrType::PARAM_LIST:
+            for (auto &child : c)
+                check(child->isIdent());
+            break;
+        case OptrType::STRING:
+            check(c.size() == 1 && c[0]->isIdent());
+            break;
+        }
+    }
+
+    template <typename T>
+    const T *section(const ImageSection &s) const
+    {
+        check(s.offset % alignof(T) == 0 && s.offset <= m_size && s.count <= (m_size - s.offset) / sizeof(T));
+        return reinterpret_cast<const T *>(m_base + s.offset);
+    }
+
+    const std::string &symbol(uint32_t id) const
+    {
+        check(id < m_symbols.size());
+        return m_symbols[id];
+    }
+
+    // only earlier nodes may be referenced, which rules out cycles
+    std::shared_ptr<ASTNode> node(uint32_t id, size_t before) const
+    {
+        if (id == IMAGE_NO_INDEX)
+            return nullptr;
+        check(id < before);
+        return m_nodes[id];
+    }
+
+private:
+    std::shared_ptr<const MappedFile> m_file;
+    const char *m_base;
+    size_t m_size;
+    ImageHeader m_header;
+    std::vector<std::string> m_symbols;
+    std::vector<std::shared_ptr<ASTNode>> m_nodes;
+};
+
+} // namespace
+
+void writeImage(const std::string &path, const VarMap &varMap)
+{
+    std::vector<const VarMap::value_type *> vars;
+    vars.reserve(varMap.size());
+    for (auto &v : varMap)
+        vars.push_back(&v);
+    std::sort(vars.begin(), vars.end(), [](auto a, auto b)
+              { return a->first < b->first; });
+
+    ImageWriter writer;
+    for (auto v : vars)
+        writer.addVar(v->first, v->second);
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw EvalExcept(EVAL_FILE_NOT_WRITABLE);
+        writer.write(out);
+        out.flush();
+        if (!out)
+        {
+            out.close();
+            std::remove(tmp.c_str());
+            throw EvalExcept(EVAL_FILE_NOT_WRITABLE);
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec)
+    {
+        std::remove(tmp.c_str());
+        throw EvalExcept(EVAL_FILE_NOT_WRITABLE);
+    }
+}
+
+VarMap readImage(const std::string &path)
+{
+    return ImageReader(MappedFile::open(path)).read();
+}
+
+} // namespace eval
@@ -2,35 +2,35 @@
 #include <cmath>
 
 #define UNARY_FUNC_IMPL(name, impl)                                                                        \
+    static decimal_t scalar_##name(decimal_t x) { return impl(x); }                                        \
     InternalFuncRet internal_##name(const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) \
     {                                                                                                      \
         if (params.size() != 1)                                                                            \
-            throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);                                             \
-        auto x = context.eval(params[0]);                                                                  \
-        if (x.index() == 1)                                                                                \
-            return impl(std::get<1>(x));                                                                   \
-        if (x.index() == 2)                                                                                \
+            return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};                                             \
+        EVAL_TRY(x, context.tryEval(params[0]));                                                           \
+        if (x->index() == 1)                                                                               \
+            return scalar_##name(std::get<1>(*x));                                                         \
+        if (x->index() == 2)                                                                               \
         {                                                                                                  \
-            auto l = std::get<2>(x);                                                                       \
+            auto l = std::get<2>(std::move(*x));                                                           \
             for (auto &x : l)                                                                              \
-                x = impl(x);                                                                               \
+                x = scalar_##name(x);                                                                      \
             return l;                                                                                      \
         }                                                                                                  \
-        throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);                                                       \
-        return decimal_t(0);                                                                               \
+        return EvalError{EVAL_WRONG_PARAMETER_TYPE};                                                       \
     }
 
 #define CMP_OPTR_IMPL(name, optr)                                                                          \
+    static decimal_t scalar_##name(decimal_t x, decimal_t y) { return decimal_t(x optr y); }               \
     InternalFuncRet internal_##name(const std::vector<std::shared_ptr<ASTNode>> &params, Context &context) \
     {                                                                                                      \
         if (params.size() != 2)                                                                            \
-            throw EvalExcept(EVAL_WRONG_NUMBER_OF_PARAMETERS);                                             \
-        auto x = context.eval(params[0]);                                                                  \
-        auto y = context.eval(params[1]);                                                                  \
-        if (x.index() == 1 && y.index() == 1)                                                              \
-            return decimal_t(std::get<1>(x) optr std::get<1>(y));                                          \
-        throw EvalExcept(EVAL_WRONG_PARAMETER_TYPE);                                                       \
-        return decimal_t(0);                                                                               \
+            return EvalError{EVAL_WRONG_NUMBER_OF_PARAMETERS};                                             \
+        EVAL_TRY(x, context.tryEval(params[0]));                                                           \
+        EVAL_TRY(y, context.tryEval(params[1]));                                                           \
+        if (x->index() == 1 && y->index() == 1)                                                            \
+            return scalar_##name(std::get<1>(*x), std::get<1>(*y));                                        \
+        return EvalError{EVAL_WRONG_PARAMETER_TYPE};                                                       \
     }
 
 namespace eval
@@ -64,4 +64,47 @@ CMP_OPTR_IMPL(gt, >)
 CMP_OPTR_IMPL(lt, <)
 CMP_OPTR_IMPL(geq, >=)
 CMP_OPTR_IMPL(leq, <=)
+
+#define SCALAR_FUNC_ENTRY(f) \
+    {                        \
+        #f, scalar_##f       \
+    }
+
+ScalarUnaryFunc scalarUnaryFunc(const std::string &name)
+{
+    static const std::unordered_map<std::string, ScalarUnaryFunc> funcs{
+        SCALAR_FUNC_ENTRY(sin),
+        SCALAR_FUNC_ENTRY(cos),
+        SCALAR_FUNC_ENTRY(tan),
+        SCALAR_FUNC_ENTRY(asin),
+        SCALAR_FUNC_ENTRY(acos),
+        SCALAR_FUNC_ENTRY(atan),
+        SCALAR_FUNC_ENTRY(exp),
+        SCALAR_FUNC_ENTRY(ln),
+        SCALAR_FUNC_ENTRY(abs),
+        SCALAR_FUNC_ENTRY(floor),
+        SCALAR_FUNC_ENTRY(ceil),
+        SCALAR_FUNC_ENTRY(round),
+        SCALAR_FUNC_ENTRY(sqrt),
+        SCALAR_FUNC_ENTRY(erf),
+        SCALAR_FUNC_ENTRY(gamma),
+        SCALAR_FUNC_ENTRY(not ),
+    };
+    auto ite = funcs.find(name);
+    return ite == funcs.end() ? nullptr : ite->second;
+}
+
+ScalarBinaryFunc scalarBinaryFunc(const std::string &name)
+{
+    static const std::unordered_map<std::string, ScalarBinaryFunc> funcs{
+        SCALAR_FUNC_ENTRY(eq),
+        SCALAR_FUNC_ENTRY(neq),
+        SCALAR_FUNC_ENTRY(gt),
+        SCALAR_FUNC_ENTRY(lt),
+        SCALAR_FUNC_ENTRY(geq),
+        SCALAR_FUNC_ENTRY(leq),
+    };
+    auto ite = funcs.find(name);
+    return ite == funcs.end() ? nullptr : ite->second;
+}
 } // namespace eval
\ No newline at end of file
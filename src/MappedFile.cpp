@@ -0,0 +1,76 @@
+#include <evaluator/MappedFile.h>
+#include <evaluator/EvalDefs.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace eval
+{
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::string &path)
+{
+    std::shared_ptr<MappedFile> file(new MappedFile);
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        throw EvalExcept(EVAL_FILE_NOT_READABLE);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size))
+    {
+        CloseHandle(handle);
+        throw EvalExcept(EVAL_FILE_NOT_READABLE);
+    }
+    file->m_size = static_cast<size_t>(size.QuadPart);
+    if (file->m_size != 0)
+    {
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr)
+        {
+            file->m_data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(handle);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw EvalExcept(EVAL_FILE_NOT_READABLE);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        throw EvalExcept(EVAL_FILE_NOT_READABLE);
+    }
+    file->m_size = static_cast<size_t>(st.st_size);
+    if (file->m_size != 0)
+    {
+        void *p = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+            file->m_data = static_cast<const char *>(p);
+    }
+    close(fd);
+#endif
+    if (file->m_size != 0 && file->m_data == nullptr)
+        throw EvalExcept(EVAL_FILE_NOT_READABLE);
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data == nullptr)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap(const_cast<char *>(m_data), m_size);
+#endif
+}
+
+} // namespace eval
@@ -0,0 +1,95 @@
+#include <evaluator/Memory.h>
+#include <evaluator/AST.h>
+
+#include <cstddef>
+
+namespace eval
+{
+
+static constexpr size_t roundUp(size_t n, size_t align)
+{
+    return (n + align - 1) / align * align;
+}
+
+// std::make_shared puts the node behind a control block with a vtable pointer
+// and the use and weak counts, padded to the alignment of the node
+static constexpr size_t SHARED_PTR_CONTROL_BYTES = roundUp(sizeof(void *) + 2 * sizeof(int), alignof(ASTNode));
+
+// malloc keeps a size header in front of every block and rounds blocks up to
+// its alignment
+static constexpr size_t heapBlockBytes(size_t n)
+{
+    return n == 0 ? 0 : roundUp(n + sizeof(size_t), alignof(std::max_align_t));
+}
+
+static size_t nodeBytes(const ASTNode &ast)
+{
+    return heapBlockBytes(SHARED_PTR_CONTROL_BYTES + sizeof(ASTNode)) +
+           heapBlockBytes(ast.children.capacity() * sizeof(std::shared_ptr<ASTNode>));
+}
+
+MemoryUsage &MemoryUsage::operator+=(const MemoryUsage &other)
+{
+    listBytes += other.listBytes;
+    astBytes += other.astBytes;
+    lambdaBytes += other.lambdaBytes;
+    stringBytes += other.stringBytes;
+    mappedBytes += other.mappedBytes;
+    lists += other.lists;
+    astNodes += other.astNodes;
+    lambdas += other.lambdas;
+    strings += other.strings;
+    return *this;
+}
+
+MemoryUsage &MemoryUsage::operator-=(const MemoryUsage &other)
+{
+    listBytes -= other.listBytes;
+    astBytes -= other.astBytes;
+    lambdaBytes -= other.lambdaBytes;
+    stringBytes -= other.stringBytes;
+    mappedBytes -= other.mappedBytes;
+    lists -= other.lists;
+    astNodes -= other.astNodes;
+    lambdas -= other.lambdas;
+    strings -= other.strings;
+    return *this;
+}
+
+void MemoryUsage::addString(const std::string &s)
+{
+    // short strings live inside the object
+    if (s.capacity() < sizeof(std::string))
+        return;
+    stringBytes += s.capacity() + 1;
+    ++strings;
+}
+
+void MemoryUsage::addAST(const ASTNode &ast, ASTRefs &refs)
+{
+    // the children of a referenced node are referenced already
+    if (refs[&ast]++ > 0)
+        return;
+    astBytes += nodeBytes(ast);
+    ++astNodes;
+    if (ast.isIdent())
+        addString(std::get<2>(ast.value));
+    for (auto &c : ast.children)
+        addAST(*c, refs);
+}
+
+void MemoryUsage::releaseAST(const ASTNode &ast, ASTRefs &refs)
+{
+    auto ite = refs.find(&ast);
+    if (ite == refs.end() || --ite->second > 0)
+        return;
+    refs.erase(ite);
+    astBytes += nodeBytes(ast);
+    ++astNodes;
+    if (ast.isIdent())
+        addString(std::get<2>(ast.value));
+    for (auto &c : ast.children)
+        releaseAST(*c, refs);
+}
+
+} // namespace eval
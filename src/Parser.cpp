@@ -1,4 +1,6 @@
 #include <evaluator/Parser.h>
+#include <evaluator/Coroutine.h>
+#include <evaluator/Trace.h>
 #include <stdexcept>
 
 namespace eval
@@ -11,23 +13,65 @@ namespace eval
             return false;   \
     } while (0)
 
-std::shared_ptr<ASTNode> Parser::parse(const TokenList &tkl)
+// restores the nesting depth when a parse function returns
+struct DepthGuard
+{
+    size_t &depth;
+    size_t saved;
+    explicit DepthGuard(size_t &depth) : depth(depth), saved(depth) {}
+    ~DepthGuard() { depth = saved; }
+};
+
+EvalResult<std::shared_ptr<ASTNode>> Parser::tryParse(const TokenList &tkl)
 {
+    TraceSpan span("parse");
     std::shared_ptr<ASTNode> ast = std::make_shared<ASTNode>();
 
     m_pos = tkl.begin();
     m_end = tkl.end();
+    m_furthest = m_pos;
+    m_depth = 0;
+    m_tooDeep = false;
 
     auto p0 = m_pos;
     if (parseAssign(ast) && m_pos == m_end)
         return ast;
+    if (m_tooDeep)
+        return EvalError{EVAL_RECURSION_LIMIT_EXCEEDED, m_tooDeepPos};
 
     m_pos = p0;
     if (parseExpr(ast) && m_pos == m_end)
         return ast;
+    if (m_tooDeep)
+        return EvalError{EVAL_RECURSION_LIMIT_EXCEEDED, m_tooDeepPos};
+
+    if (m_furthest != m_end)
+        return EvalError{EVAL_PARSE_FAILED, m_furthest->pos};
+    return EvalError{EVAL_PARSE_FAILED, tkl.empty() ? EVAL_NO_POS : tkl.back().pos};
+}
+
+std::shared_ptr<ASTNode> Parser::parse(const TokenList &tkl)
+{
+    return tryParse(tkl).valueOrThrow();
+}
 
-    throw EvalExcept(EVAL_PARSE_FAILED);
-    return nullptr;
+void Parser::advance()
+{
+    if (++m_pos > m_furthest)
+        m_furthest = m_pos;
+}
+
+// one more level of the AST being built, false once it gets too deep
+bool Parser::nest()
+{
+    if (++m_depth <= PARSE_MAX_DEPTH && currentStackLeft() >= EVAL_STACK_MARGIN)
+        return true;
+    if (!m_tooDeep)
+    {
+        m_tooDeep = true;
+        m_tooDeepPos = m_pos != m_end ? m_pos->pos : EVAL_NO_POS;
+    }
+    return false;
 }
 
 bool Parser::parseAssign(std::shared_ptr<ASTNode> &ast)
@@ -36,8 +80,10 @@ bool Parser::parseAssign(std::shared_ptr<ASTNode> &ast)
     if (m_pos != m_end && m_pos->type == TokenType::IDENT)
     {
         ast->value = OptrType::ASSIGN;
+        ast->pos = m_pos->pos;
         ast->children[0]->value = m_pos->getIdent();
-        ++m_pos;
+        ast->children[0]->pos = m_pos->pos;
+        advance();
     }
     else
         return false;
@@ -45,16 +91,16 @@ bool Parser::parseAssign(std::shared_ptr<ASTNode> &ast)
     CHECK_END;
     if (m_pos->type == TokenType::LPAR)
     {
-        ++m_pos;
+        advance();
         ast->value = OptrType::ASSIGN_LAMBDA;
         if (parseParamList(ast->children[1]) && m_pos != m_end && m_pos->type == TokenType::RPAR)
-            ++m_pos;
+            advance();
         else
             return false;
         ast->children.push_back(std::make_shared<ASTNode>());
     }
     if (m_pos != m_end && m_pos->type == TokenType::ASSIGN)
-        ++m_pos;
+        advance();
     else
         return false;
 
@@ -63,7 +109,8 @@ bool Parser::parseAssign(std::shared_ptr<ASTNode> &ast)
 
 bool Parser::parseExpr(std::shared_ptr<ASTNode> &ast)
 {
-    return parseExprL1(ast);
+    DepthGuard guard(m_depth);
+    return nest() && parseExprL1(ast);
 }
 
 bool Parser::parseExprUnary(std::shared_ptr<ASTNode> &ast)
@@ -71,9 +118,13 @@ bool Parser::parseExprUnary(std::shared_ptr<ASTNode> &ast)
     CHECK_END;
     if (m_pos->type == TokenType::SUB)
     {
+        DepthGuard guard(m_depth);
+        if (!nest())
+            return false;
         ast->alloc(1);
         ast->value = OptrType::NEG;
-        ++m_pos;
+        ast->pos = m_pos->pos;
+        advance();
         return parseExprL2(ast->children[0]);
     }
     return parseExprL2(ast);
@@ -83,13 +134,17 @@ bool Parser::parseExprL1(std::shared_ptr<ASTNode> &ast)
 {
     if (!parseExprUnary(ast))
         return false;
+    DepthGuard guard(m_depth);
     while (m_pos != m_end && (m_pos->type == TokenType::ADD || m_pos->type == TokenType::SUB))
     {
+        if (!nest())
+            return false;
         auto cpy = std::make_shared<ASTNode>(*ast);
         ast->alloc(2);
         ast->children[0] = cpy;
         ast->value = m_pos->type == TokenType::ADD ? OptrType::ADD : OptrType::SUB;
-        ++m_pos;
+        ast->pos = m_pos->pos;
+        advance();
         if (!parseExprUnary(ast->children[1]))
             return false;
     }
@@ -100,13 +155,17 @@ bool Parser::parseExprL2(std::shared_ptr<ASTNode> &ast)
 {
     if (!parseExprL3(ast))
         return false;
+    DepthGuard guard(m_depth);
     while (m_pos != m_end && (m_pos->type == TokenType::MUL || m_pos->type == TokenType::DIV))
     {
+        if (!nest())
+            return false;
         auto cpy = std::make_shared<ASTNode>(*ast);
         ast->alloc(2);
         ast->children[0] = cpy;
         ast->value = m_pos->type == TokenType::MUL ? OptrType::MUL : OptrType::DIV;
-        ++m_pos;
+        ast->pos = m_pos->pos;
+        advance();
         if (!parseExprL3(ast->children[1]))
             return false;
     }
@@ -115,16 +174,21 @@ bool Parser::parseExprL2(std::shared_ptr<ASTNode> &ast)
 
 bool Parser::parseExprL3(std::shared_ptr<ASTNode> &ast)
 {
+    DepthGuard guard(m_depth);
     auto node = ast;
     while (parseTerm(node))
     {
         if (m_pos == m_end || m_pos->type != TokenType::POW)
             return true;
-        ++m_pos;
+        if (!nest())
+            return false;
+        size_t pos = m_pos->pos;
+        advance();
         auto cpy = std::make_shared<ASTNode>(*node);
         node->alloc(2);
         node->children[0] = cpy;
         node->value = OptrType::POW;
+        node->pos = pos;
         node = node->children[1];
     }
     return false;
@@ -134,27 +198,39 @@ bool Parser::parseTerm(std::shared_ptr<ASTNode> &ast)
 {
     CHECK_END;
 
-    auto p0 = m_pos;
     if (m_pos->type == TokenType::DECIMAL)
     {
         ast->value = m_pos->getDecimal();
-        ++m_pos;
+        ast->pos = m_pos->pos;
+        advance();
+        return true;
+    }
+
+    if (m_pos->type == TokenType::STRING)
+    {
+        ast->alloc(1);
+        ast->value = OptrType::STRING;
+        ast->pos = m_pos->pos;
+        ast->children[0]->value = m_pos->getString();
+        ast->children[0]->pos = m_pos->pos;
+        advance();
         return true;
     }
 
     if (m_pos->type == TokenType::IDENT)
     {
         ast->value = m_pos->getIdent();
-        ++m_pos;
+        ast->pos = m_pos->pos;
+        advance();
     }
     else if (m_pos->type == TokenType::LPAR)
     {
-        ++m_pos;
+        advance();
         if (!parseExpr(ast))
             return false;
         if (m_pos == m_end || m_pos->type != TokenType::RPAR)
             return false;
-        ++m_pos;
+        advance();
     }
     else if (m_pos->type == TokenType::LSQR)
     {
@@ -169,33 +245,40 @@ bool Parser::parseTerm(std::shared_ptr<ASTNode> &ast)
     else
         return false;
 
+    DepthGuard guard(m_depth);
     while (m_pos != m_end)
     {
+        if ((m_pos->type == TokenType::LPAR || m_pos->type == TokenType::LSQR) && !nest())
+            return false;
         if (m_pos->type == TokenType::LPAR)
         {
-            ++m_pos;
+            size_t pos = m_pos->pos;
+            advance();
             auto cpy = std::make_shared<ASTNode>(*ast);
             ast->value = OptrType::CALL;
+            ast->pos = pos;
             ast->alloc(2);
             ast->children[0] = cpy;
             if (!parseExprList(ast->children[1]))
                 return false;
             if (m_pos == m_end || m_pos->type != TokenType::RPAR)
                 return false;
-            ++m_pos;
+            advance();
         }
         else if (m_pos->type == TokenType::LSQR)
         {
-            ++m_pos;
+            size_t pos = m_pos->pos;
+            advance();
             auto cpy = std::make_shared<ASTNode>(*ast);
             ast->value = OptrType::INDEX;
+            ast->pos = pos;
             ast->alloc(2);
             ast->children[0] = cpy;
             if (!parseExpr(ast->children[1]))
                 return false;
             if (m_pos == m_end || m_pos->type != TokenType::RSQR)
                 return false;
-            ++m_pos;
+            advance();
             return true;
         }
         else
@@ -208,12 +291,14 @@ bool Parser::parseList(std::shared_ptr<ASTNode> &ast)
 {
     if (m_pos == m_end || m_pos->type != TokenType::LSQR)
         return false;
-    ++m_pos;
+    size_t pos = m_pos->pos;
+    advance();
     CHECK_END;
     if (parseExprList(ast) && m_pos->type == TokenType::RSQR)
     {
-        ++m_pos;
+        advance();
         ast->value = OptrType::LIST;
+        ast->pos = pos;
         return true;
     }
     else
@@ -227,10 +312,11 @@ bool Parser::parseParamList(std::shared_ptr<ASTNode> &ast)
     while (m_pos != m_end && m_pos->type == TokenType::IDENT)
     {
         ast->children.push_back(std::make_shared<ASTNode>(m_pos->getIdent()));
-        ++m_pos;
+        ast->children.back()->pos = m_pos->pos;
+        advance();
         if (m_pos == m_end || m_pos->type != TokenType::COMMA)
             return true;
-        ++m_pos;
+        advance();
     }
     return true;
 }
@@ -245,7 +331,7 @@ bool Parser::parseExprList(std::shared_ptr<ASTNode> &ast)
         ast->children.push_back(tmp);
         if (m_pos == m_end || m_pos->type != TokenType::COMMA)
             return true;
-        ++m_pos;
+        advance();
         tmp = std::make_shared<ASTNode>();
     }
     return true;
@@ -255,24 +341,26 @@ bool Parser::parseLambda(std::shared_ptr<ASTNode> &ast)
 {
     if (m_pos == m_end || m_pos->type != TokenType::LAMBDA)
         return false;
-    ++m_pos;
+    size_t pos = m_pos->pos;
+    advance();
     if (m_pos == m_end || m_pos->type != TokenType::LPAR)
         return false;
-    ++m_pos;
+    advance();
     ast->value = OptrType::LAMBDA;
+    ast->pos = pos;
     ast->alloc(2);
     parseParamList(ast->children[0]);
     if (m_pos == m_end || m_pos->type != TokenType::RPAR)
         return false;
-    ++m_pos;
+    advance();
     if (m_pos == m_end || m_pos->type != TokenType::LCUR)
         return false;
-    ++m_pos;
+    advance();
     if (!parseExpr(ast->children[1]))
         return false;
     if (m_pos == m_end || m_pos->type != TokenType::RCUR)
         return false;
-    ++m_pos;
+    advance();
     return true;
 }
 
@@ -0,0 +1,137 @@
+#include <evaluator/Profiler.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace eval
+{
+
+static thread_local Profiler::Scope *t_currentScope = nullptr;
+
+const char *optrName(OptrType optr)
+{
+    static const char *names[]{
+        "ASSIGN",
+        "ASSIGN_LAMBDA",
+        "NEG",
+        "ADD",
+        "SUB",
+        "MUL",
+        "DIV",
+        "POW",
+        "CALL",
+        "INDEX",
+        "LIST",
+        "LAMBDA",
+        "EXPR_LIST",
+        "PARAM_LIST",
+        "STRING",
+    };
+    return names[static_cast<size_t>(optr)];
+}
+
+JsonNode ProfileEntry::toJson() const
+{
+    return {{"calls", jsptr(static_cast<double>(calls))},
+            {"total_ns", jsptr(static_cast<double>(totalNs))},
+            {"self_ns", jsptr(static_cast<double>(selfNs))},
+            {"list_bytes", jsptr(static_cast<double>(listBytes))}};
+}
+
+Profiler::Scope::Scope(Profiler &profiler, OptrType optr, std::string func, bool builtin)
+    : m_profiler(profiler), m_optr(optr), m_func(std::move(func)), m_builtin(builtin),
+      m_parent(t_currentScope), m_start(std::chrono::steady_clock::now())
+{
+    t_currentScope = this;
+}
+
+Profiler::Scope *Profiler::Scope::exchangeCurrent(Scope *scope)
+{
+    return std::exchange(t_currentScope, scope);
+}
+
+Profiler::Scope::~Scope()
+{
+    auto totalNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now() - m_start)
+                                             .count());
+    t_currentScope = m_parent;
+    if (m_parent != nullptr)
+        m_parent->m_childNs += totalNs;
+    m_profiler.record(*this, totalNs, totalNs - std::min(totalNs, m_childNs));
+}
+
+void Profiler::record(const Scope &scope, uint64_t totalNs, uint64_t selfNs)
+{
+    auto update = [&](ProfileEntry &e)
+    {
+        ++e.calls;
+        e.totalNs += totalNs;
+        e.selfNs += selfNs;
+        e.listBytes += scope.m_listBytes;
+    };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    update(m_optrs[optrName(scope.m_optr)]);
+    if (!scope.m_func.empty())
+        update((scope.m_builtin ? m_builtins : m_lambdas)[scope.m_func]);
+}
+
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_optrs.clear();
+    m_builtins.clear();
+    m_lambdas.clear();
+}
+
+JsonNode Profiler::toJson() const
+{
+    auto toObj = [](const std::unordered_map<std::string, ProfileEntry> &entries)
+    {
+        JsonObj_t obj;
+        for (auto &e : entries)
+            obj.insert({e.first, jsptr(e.second.toJson())});
+        return obj;
+    };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {{"optrs", jsptr(toObj(m_optrs))},
+            {"builtins", jsptr(toObj(m_builtins))},
+            {"lambdas", jsptr(toObj(m_lambdas))}};
+}
+
+std::string Profiler::report() const
+{
+    std::stringstream ss;
+    auto section = [&ss](const char *title, const std::unordered_map<std::string, ProfileEntry> &entries)
+    {
+        std::vector<std::pair<std::string, ProfileEntry>> sorted(entries.begin(), entries.end());
+        std::sort(sorted.begin(), sorted.end(), [](auto &a, auto &b)
+                  { return a.second.totalNs > b.second.totalNs; });
+
+        ss << title << '\n'
+           << std::left << std::setw(20) << "  name" << std::right
+           << std::setw(12) << "calls"
+           << std::setw(14) << "total(ms)"
+           << std::setw(14) << "self(ms)"
+           << std::setw(14) << "list(KiB)" << '\n';
+        for (auto &e : sorted)
+            ss << "  " << std::left << std::setw(18) << e.first << std::right
+               << std::setw(12) << e.second.calls
+               << std::setw(14) << std::fixed << std::setprecision(3) << e.second.totalNs * 1e-6
+               << std::setw(14) << e.second.selfNs * 1e-6
+               << std::setw(14) << e.second.listBytes / 1024.0 << '\n';
+    };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    section("operators", m_optrs);
+    section("builtins", m_builtins);
+    section("lambdas", m_lambdas);
+    return ss.str();
+}
+
+} // namespace eval
@@ -0,0 +1,482 @@
+#include <evaluator/Reduce.h>
+#include <evaluator/Scheduler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EVAL_REDUCE_SSE2
+#endif
+
+namespace eval
+{
+
+namespace
+{
+
+constexpr decimal_t NaN = std::numeric_limits<decimal_t>::quiet_NaN();
+
+// One lane. The kernels are written once over Lane and Vec; both do the same
+// IEEE operations per lane, so results do not depend on which one is used.
+struct Lane
+{
+    static constexpr size_t WIDTH = 1;
+    decimal_t v;
+
+    static Lane load(const decimal_t *p) { return {*p}; }
+    static Lane broadcast(decimal_t x) { return {x}; }
+    void store(decimal_t *p) const { *p = v; }
+    friend Lane operator+(Lane a, Lane b) { return {a.v + b.v}; }
+    friend Lane operator-(Lane a, Lane b) { return {a.v - b.v}; }
+    friend Lane operator*(Lane a, Lane b) { return {a.v * b.v}; }
+    friend Lane max(Lane a, Lane b) { return {a.v > b.v ? a.v : b.v}; }
+    friend Lane min(Lane a, Lane b) { return {a.v < b.v ? a.v : b.v}; }
+    // accumulates whether any value was NaN
+    friend Lane markNaN(Lane mark, Lane x) { return {x.v != x.v ? 1 : mark.v}; }
+    bool anyMarked() const { return v != 0; }
+    // lanes moved up by one, `fill` entering the first; with a single lane
+    // the in-register prefix is the value itself
+    Lane shiftIn(decimal_t fill) const { return {fill}; }
+    Lane broadcastLast() const { return {v}; }
+};
+
+#ifdef EVAL_REDUCE_SSE2
+struct Vec
+{
+    static constexpr size_t WIDTH = 2;
+    __m128d v;
+
+    static Vec load(const decimal_t *p) { return {_mm_loadu_pd(p)}; }
+    static Vec broadcast(decimal_t x) { return {_mm_set1_pd(x)}; }
+    void store(decimal_t *p) const { _mm_storeu_pd(p, v); }
+    friend Vec operator+(Vec a, Vec b) { return {_mm_add_pd(a.v, b.v)}; }
+    friend Vec operator-(Vec a, Vec b) { return {_mm_sub_pd(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {_mm_mul_pd(a.v, b.v)}; }
+    friend Vec max(Vec a, Vec b) { return {_mm_max_pd(a.v, b.v)}; }
+    friend Vec min(Vec a, Vec b) { return {_mm_min_pd(a.v, b.v)}; }
+    friend Vec markNaN(Vec mark, Vec x) { return {_mm_or_pd(mark.v, _mm_cmpunord_pd(x.v, x.v))}; }
+    bool anyMarked() const { return _mm_movemask_pd(_mm_cmpneq_pd(v, _mm_setzero_pd())) != 0; }
+    Vec shiftIn(decimal_t fill) const { return {_mm_unpacklo_pd(_mm_set1_pd(fill), v)}; }
+    Vec broadcastLast() const { return {_mm_unpackhi_pd(v, v)}; }
+};
+#else
+using Vec = Lane;
+#endif
+
+constexpr size_t VECS = REDUCE_LANES / Vec::WIDTH;
+
+// sum + compensation, Neumaier's variant so that adding a larger term does
+// not lose the running error
+struct CompensatedSum
+{
+    decimal_t sum = 0;
+    decimal_t compensation = 0;
+
+    void add(decimal_t v)
+    {
+        decimal_t t = sum + v;
+        if (std::abs(sum) >= std::abs(v))
+            compensation += (sum - t) + v;
+        else
+            compensation += (v - t) + sum;
+        sum = t;
+    }
+    void add(const CompensatedSum &other)
+    {
+        add(other.sum);
+        add(other.compensation);
+    }
+    decimal_t value() const { return sum + compensation; }
+};
+
+// runs block(st, ed) over [0, n) in blocks, in parallel when worth it
+template <typename Block>
+void forBlocks(size_t n, TaskScheduler *scheduler, Block block)
+{
+    const size_t blocks = std::max<size_t>(1, (n + REDUCE_BLOCK_SIZE - 1) / REDUCE_BLOCK_SIZE);
+    auto run = [&](size_t b)
+    { block(b, b * REDUCE_BLOCK_SIZE, std::min(n, (b + 1) * REDUCE_BLOCK_SIZE)); };
+    if (scheduler != nullptr && n >= REDUCE_PARALLEL_THRESHOLD)
+        scheduler->parallelFor(blocks, run);
+    else
+        for (size_t b = 0; b < blocks; ++b)
+            run(b);
+}
+
+// reduces each block and combines the block results pairwise in index order
+template <typename T, typename Block, typename Combine>
+T reduceBlocks(size_t n, TaskScheduler *scheduler, Block block, Combine combine)
+{
+    std::vector<T> partials(std::max<size_t>(1, (n + REDUCE_BLOCK_SIZE - 1) / REDUCE_BLOCK_SIZE));
+    forBlocks(n, scheduler, [&](size_t b, size_t st, size_t ed)
+              { partials[b] = block(st, ed); });
+
+    for (size_t step = 1; step < partials.size(); step *= 2)
+        for (size_t b = 0; b + step < partials.size(); b += 2 * step)
+            partials[b] = combine(partials[b], partials[b + step]);
+    return partials[0];
+}
+
+// Kahan summation of term(i) over [st, ed) with one accumulator per lane.
+// `term` is called with a Vec for full groups of lanes and with a Lane for
+// the rest.
+template <typename Term>
+CompensatedSum sumBlock(size_t st, size_t ed, Term term)
+{
+    Vec s[VECS], c[VECS];
+    std::fill(s, s + VECS, Vec::broadcast(0));
+    std::fill(c, c + VECS, Vec::broadcast(0));
+    size_t i = st;
+    for (; i + REDUCE_LANES <= ed; i += REDUCE_LANES)
+        for (size_t k = 0; k < VECS; ++k)
+        {
+            Vec y = term(Vec(), i + k * Vec::WIDTH) - c[k];
+            Vec t = s[k] + y;
+            c[k] = (t - s[k]) - y;
+            s[k] = t;
+        }
+    decimal_t sums[REDUCE_LANES], errors[REDUCE_LANES];
+    for (size_t k = 0; k < VECS; ++k)
+    {
+        s[k].store(sums + k * Vec::WIDTH);
+        c[k].store(errors + k * Vec::WIDTH);
+    }
+    CompensatedSum ret;
+    for (size_t k = 0; k < REDUCE_LANES; ++k)
+    {
+        ret.add(sums[k]);
+        ret.add(-errors[k]);
+    }
+    for (; i < ed; ++i)
+        ret.add(term(Lane(), i).v);
+    return ret;
+}
+
+template <typename Term>
+decimal_t compensatedSum(size_t n, TaskScheduler *scheduler, Term term)
+{
+    return reduceBlocks<CompensatedSum>(
+               n, scheduler, [&](size_t st, size_t ed)
+               { return sumBlock(st, ed, term); },
+               [](CompensatedSum a, const CompensatedSum &b)
+               {
+                   a.add(b);
+                   return a;
+               })
+        .value();
+}
+
+// `pick(a, b)` keeps the lane value a or takes the element b; NaN elements
+// are tracked separately and make the result NaN
+template <bool IsMax>
+decimal_t extremum(const ListType &l, TaskScheduler *scheduler)
+{
+    if (l.empty())
+        return NaN;
+    const decimal_t *x = l.data();
+    auto pick = [](decimal_t a, decimal_t b)
+    { return (IsMax ? b > a : b < a) || b != b ? b : a; };
+    return reduceBlocks<decimal_t>(
+        l.size(), scheduler, [&](size_t st, size_t ed)
+        {
+            Vec m[VECS], nan[VECS];
+            std::fill(m, m + VECS, Vec::broadcast(x[st]));
+            std::fill(nan, nan + VECS, Vec::broadcast(0));
+            size_t i = st;
+            for (; i + REDUCE_LANES <= ed; i += REDUCE_LANES)
+                for (size_t k = 0; k < VECS; ++k)
+                {
+                    Vec v = Vec::load(x + i + k * Vec::WIDTH);
+                    m[k] = IsMax ? max(m[k], v) : min(m[k], v);
+                    nan[k] = markNaN(nan[k], v);
+                }
+            decimal_t lanes[REDUCE_LANES];
+            bool anyNaN = false;
+            for (size_t k = 0; k < VECS; ++k)
+            {
+                m[k].store(lanes + k * Vec::WIDTH);
+                anyNaN = anyNaN || nan[k].anyMarked();
+            }
+            decimal_t ret = lanes[0];
+            for (size_t k = 1; k < REDUCE_LANES; ++k)
+                ret = pick(ret, lanes[k]);
+            for (; i < ed; ++i)
+                ret = pick(ret, x[i]);
+            return anyNaN ? NaN : ret; },
+        pick);
+}
+
+struct AddOp
+{
+    static constexpr decimal_t IDENTITY = 0;
+    static constexpr bool ORDERED = false;
+    template <typename V>
+    static V apply(V a, V b) { return a + b; }
+};
+
+struct MulOp
+{
+    static constexpr decimal_t IDENTITY = 1;
+    static constexpr bool ORDERED = false;
+    template <typename V>
+    static V apply(V a, V b) { return a * b; }
+};
+
+struct MaxOp
+{
+    static constexpr decimal_t IDENTITY = -std::numeric_limits<decimal_t>::infinity();
+    static constexpr bool ORDERED = true;
+    template <typename V>
+    static V apply(V a, V b) { return max(a, b); }
+};
+
+struct MinOp
+{
+    static constexpr decimal_t IDENTITY = std::numeric_limits<decimal_t>::infinity();
+    static constexpr bool ORDERED = true;
+    template <typename V>
+    static V apply(V a, V b) { return min(a, b); }
+};
+
+// Inclusive scan of [st, ed) from the identity, returning the last value.
+// Groups of REDUCE_LANES elements are scanned in registers, each vector by
+// combining it with itself shifted by one lane and then with the last lane of
+// the previous vector. This does not depend on the carry, so the carry chain
+// only costs one operation per group. Comparisons drop NaN, so for ORDERED ops
+// the output is filled with NaN from the first one.
+template <typename Op>
+decimal_t scanBlock(const decimal_t *x, decimal_t *out, size_t st, size_t ed)
+{
+    Vec carry = Vec::broadcast(Op::IDENTITY), nan = Vec::broadcast(0);
+    size_t i = st;
+    for (; i + REDUCE_LANES <= ed; i += REDUCE_LANES)
+    {
+        Vec v[VECS];
+        for (size_t k = 0; k < VECS; ++k)
+        {
+            v[k] = Vec::load(x + i + k * Vec::WIDTH);
+            if (Op::ORDERED)
+                nan = markNaN(nan, v[k]);
+            v[k] = Op::apply(v[k], v[k].shiftIn(Op::IDENTITY));
+            if (k > 0)
+                v[k] = Op::apply(v[k - 1].broadcastLast(), v[k]);
+        }
+        for (size_t k = 0; k < VECS; ++k)
+            Op::apply(carry, v[k]).store(out + i + k * Vec::WIDTH);
+        carry = Op::apply(carry, v[VECS - 1].broadcastLast());
+    }
+    decimal_t c[Vec::WIDTH];
+    carry.store(c);
+    Lane last{c[0]};
+    bool anyNaN = Op::ORDERED && nan.anyMarked();
+    for (; i < ed; ++i)
+    {
+        last = Op::apply(last, Lane::load(x + i));
+        out[i] = last.v;
+        anyNaN = anyNaN || (Op::ORDERED && x[i] != x[i]);
+    }
+    if (anyNaN)
+    {
+        auto first = std::find_if(x + st, x + ed, [](decimal_t v)
+                                  { return v != v; });
+        std::fill(out + (first - x), out + ed, NaN);
+    }
+    return st < ed ? out[ed - 1] : Op::IDENTITY;
+}
+
+// out[i] = carry op out[i]; a NaN carry makes the whole block NaN
+template <typename Op>
+void applyCarry(decimal_t *out, size_t st, size_t ed, decimal_t carry)
+{
+    if (carry != carry)
+    {
+        std::fill(out + st, out + ed, NaN);
+        return;
+    }
+    const Vec c = Vec::broadcast(carry);
+    size_t i = st;
+    for (; i + Vec::WIDTH <= ed; i += Vec::WIDTH)
+        Op::apply(c, Vec::load(out + i)).store(out + i);
+    for (; i < ed; ++i)
+        out[i] = Op::apply(Lane{carry}, Lane{out[i]}).v;
+}
+
+template <typename Op>
+decimal_t combineCarry(decimal_t carry, decimal_t total)
+{
+    return carry != carry ? carry : Op::apply(Lane{carry}, Lane{total}).v;
+}
+
+// Two passes over blocks: each block is scanned on its own, then the carry of
+// the blocks before it is applied. Serially the carry is known when a block
+// is reached and is applied while the block is still in cache; in parallel
+// the block totals are combined in between. Both do the same operations, so
+// the result does not depend on the number of threads.
+template <typename Op>
+ListType scan(const ListType &l, TaskScheduler *scheduler)
+{
+    const size_t n = l.size();
+    ListType ret(n);
+    const decimal_t *x = l.data();
+    decimal_t *out = ret.data();
+    const size_t blocks = (n + REDUCE_BLOCK_SIZE - 1) / REDUCE_BLOCK_SIZE;
+    auto bounds = [n](size_t b)
+    { return std::make_pair(b * REDUCE_BLOCK_SIZE, std::min(n, (b + 1) * REDUCE_BLOCK_SIZE)); };
+
+    if (scheduler == nullptr || n < REDUCE_PARALLEL_THRESHOLD)
+    {
+        decimal_t carry = Op::IDENTITY;
+        for (size_t b = 0; b < blocks; ++b)
+        {
+            auto [st, ed] = bounds(b);
+            decimal_t total = scanBlock<Op>(x, out, st, ed);
+            if (b > 0)
+                applyCarry<Op>(out, st, ed, carry);
+            carry = combineCarry<Op>(carry, total);
+        }
+        return ret;
+    }
+
+    std::vector<decimal_t> carries(blocks);
+    scheduler->parallelFor(blocks, [&](size_t b)
+                           {
+                               auto [st, ed] = bounds(b);
+                               carries[b] = scanBlock<Op>(x, out, st, ed); });
+    decimal_t carry = Op::IDENTITY;
+    for (auto &c : carries)
+    {
+        decimal_t total = c;
+        c = carry;
+        carry = combineCarry<Op>(carry, total);
+    }
+    scheduler->parallelFor(blocks, [&](size_t b)
+                           {
+                               auto [st, ed] = bounds(b);
+                               if (b > 0)
+                                   applyCarry<Op>(out, st, ed, carries[b]); });
+    return ret;
+}
+
+} // namespace
+
+decimal_t listSum(const ListType &l, TaskScheduler *scheduler)
+{
+    const decimal_t *x = l.data();
+    return compensatedSum(l.size(), scheduler, [x](auto v, size_t i)
+                          { return decltype(v)::load(x + i); });
+}
+
+decimal_t listProd(const ListType &l, TaskScheduler *scheduler)
+{
+    const decimal_t *x = l.data();
+    return reduceBlocks<decimal_t>(
+        l.size(), scheduler, [&](size_t st, size_t ed)
+        {
+            Vec p[VECS];
+            std::fill(p, p + VECS, Vec::broadcast(1));
+            size_t i = st;
+            for (; i + REDUCE_LANES <= ed; i += REDUCE_LANES)
+                for (size_t k = 0; k < VECS; ++k)
+                    p[k] = p[k] * Vec::load(x + i + k * Vec::WIDTH);
+            decimal_t lanes[REDUCE_LANES];
+            for (size_t k = 0; k < VECS; ++k)
+                p[k].store(lanes + k * Vec::WIDTH);
+            decimal_t ret = 1;
+            for (size_t k = 0; k < REDUCE_LANES; ++k)
+                ret *= lanes[k];
+            for (; i < ed; ++i)
+                ret *= x[i];
+            return ret; },
+        [](decimal_t a, decimal_t b)
+        { return a * b; });
+}
+
+decimal_t listMin(const ListType &l, TaskScheduler *scheduler)
+{
+    return extremum<false>(l, scheduler);
+}
+
+decimal_t listMax(const ListType &l, TaskScheduler *scheduler)
+{
+    return extremum<true>(l, scheduler);
+}
+
+decimal_t listMean(const ListType &l, TaskScheduler *scheduler)
+{
+    if (l.empty())
+        return NaN;
+    return listSum(l, scheduler) / l.size();
+}
+
+decimal_t listVariance(const ListType &l, TaskScheduler *scheduler)
+{
+    if (l.size() < 2)
+        return NaN;
+    const decimal_t *x = l.data();
+    const decimal_t mean = listMean(l, scheduler);
+    return compensatedSum(l.size(), scheduler, [x, mean](auto v, size_t i)
+                          {
+                              using V = decltype(v);
+                              V d = V::load(x + i) - V::broadcast(mean);
+                              return d * d; }) /
+           (l.size() - 1);
+}
+
+decimal_t listNorm(const ListType &l, TaskScheduler *scheduler)
+{
+    const decimal_t *x = l.data();
+    return std::sqrt(compensatedSum(l.size(), scheduler, [x](auto v, size_t i)
+                                    {
+                                        using V = decltype(v);
+                                        V a = V::load(x + i);
+                                        return a * a; }));
+}
+
+decimal_t listDot(const ListType &a, const ListType &b, TaskScheduler *scheduler)
+{
+    if (a.size() != b.size())
+        throw EvalExcept(EVAL_DIFFERENT_LIST_LENGTHS);
+    const decimal_t *x = a.data(), *y = b.data();
+    return compensatedSum(a.size(), scheduler, [x, y](auto v, size_t i)
+                          {
+                              using V = decltype(v);
+                              return V::load(x + i) * V::load(y + i); });
+}
+
+ListType listCumsum(const ListType &l, TaskScheduler *scheduler)
+{
+    return scan<AddOp>(l, scheduler);
+}
+
+ListType listCumprod(const ListType &l, TaskScheduler *scheduler)
+{
+    return scan<MulOp>(l, scheduler);
+}
+
+ListType listCummax(const ListType &l, TaskScheduler *scheduler)
+{
+    return scan<MaxOp>(l, scheduler);
+}
+
+ListType listCummin(const ListType &l, TaskScheduler *scheduler)
+{
+    return scan<MinOp>(l, scheduler);
+}
+
+ListType listDiff(const ListType &l, TaskScheduler *scheduler)
+{
+    if (l.size() < 2)
+        return ListType();
+    ListType ret(l.size() - 1);
+    const decimal_t *x = l.data();
+    decimal_t *out = ret.data();
+    forBlocks(ret.size(), scheduler, [&](size_t, size_t st, size_t ed)
+              {
+                  for (size_t i = st; i < ed; ++i)
+                      out[i] = x[i + 1] - x[i]; });
+    return ret;
+}
+
+} // namespace eval
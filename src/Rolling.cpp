@@ -0,0 +1,177 @@
+#include <evaluator/Rolling.h>
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace eval
+{
+
+RollingWindow::RollingWindow(RollingOp op, size_t window)
+    : m_op(op), m_window(window), m_ring(window)
+{
+    assert(window > 0);
+}
+
+void RollingWindow::reset()
+{
+    m_count = 0;
+    m_finite = 0;
+    m_nan = m_posInf = m_negInf = 0;
+    m_sum = m_compensation = 0;
+    m_mean = m_m2 = 0;
+    m_extremes.clear();
+}
+
+void RollingWindow::count(decimal_t nonFinite, int delta)
+{
+    if (std::isnan(nonFinite))
+        m_nan += delta;
+    else if (nonFinite > 0)
+        m_posInf += delta;
+    else
+        m_negInf += delta;
+}
+
+void RollingWindow::add(decimal_t x, decimal_t old)
+{
+    const bool full = m_count >= m_window;
+    const bool entering = std::isfinite(x);
+    const bool leaving = full && std::isfinite(old);
+    if (!entering)
+        count(x, 1);
+    if (full && !leaving)
+        count(old, -1);
+    m_finite = m_finite + entering - leaving;
+
+    switch (m_op)
+    {
+    case RollingOp::SUM:
+    case RollingOp::MEAN:
+    {
+        // Neumaier summation, so that adding and removing values over a long
+        // series does not drift
+        for (decimal_t v : {entering ? x : 0, leaving ? -old : 0})
+        {
+            if (v == 0)
+                continue;
+            decimal_t t = m_sum + v;
+            if (std::abs(m_sum) >= std::abs(v))
+                m_compensation += (m_sum - t) + v;
+            else
+                m_compensation += (v - t) + m_sum;
+            m_sum = t;
+        }
+        if (m_finite == 0)
+            m_sum = m_compensation = 0;
+        break;
+    }
+    case RollingOp::VAR:
+    case RollingOp::STD:
+    {
+        const decimal_t n = static_cast<decimal_t>(m_finite);
+        if (entering && leaving)
+        {
+            // replace old by x, keeping n values
+            decimal_t mean = m_mean + (x - old) / n;
+            m_m2 += (x - old) * (x - mean + old - m_mean);
+            m_mean = mean;
+        }
+        else if (entering)
+        {
+            decimal_t d = x - m_mean;
+            m_mean += d / n;
+            m_m2 += d * (x - m_mean);
+        }
+        else if (leaving && m_finite == 0)
+            m_mean = m_m2 = 0;
+        else if (leaving)
+        {
+            decimal_t d = old - m_mean;
+            m_mean -= d / n;
+            m_m2 -= d * (old - m_mean);
+        }
+        if (m_m2 < 0)
+            m_m2 = 0;
+        break;
+    }
+    case RollingOp::MIN:
+    case RollingOp::MAX:
+    {
+        // NaN is not ordered, so it stays out of the deque and is only counted
+        const bool isMin = m_op == RollingOp::MIN;
+        if (!std::isnan(x))
+        {
+            while (!m_extremes.empty() && (isMin ? m_extremes.back().second >= x : m_extremes.back().second <= x))
+                m_extremes.pop_back();
+            m_extremes.emplace_back(m_count, x);
+        }
+        while (!m_extremes.empty() && m_extremes.front().first + m_window <= m_count)
+            m_extremes.pop_front();
+        break;
+    }
+    }
+}
+
+// sum of the window, as adding its values would give
+decimal_t RollingWindow::sum() const
+{
+    if (m_nan != 0 || (m_posInf != 0 && m_negInf != 0))
+        return std::numeric_limits<decimal_t>::quiet_NaN();
+    if (m_posInf != 0)
+        return std::numeric_limits<decimal_t>::infinity();
+    if (m_negInf != 0)
+        return -std::numeric_limits<decimal_t>::infinity();
+    return m_sum + m_compensation;
+}
+
+void RollingWindow::push(const decimal_t *values, size_t n, ListType &out)
+{
+    const uint64_t complete = m_count + n >= m_window ? m_count + n - m_window + 1 : 0;
+    const uint64_t before = m_count >= m_window ? m_count - m_window + 1 : 0;
+    out.reserve(out.size() + (complete - before));
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        decimal_t &slot = m_ring[m_count % m_window];
+        const decimal_t old = m_count >= m_window ? slot : 0;
+        add(values[i], old);
+        slot = values[i];
+        ++m_count;
+        if (m_count < m_window)
+            continue;
+
+        switch (m_op)
+        {
+        case RollingOp::SUM:
+            out.push_back(sum());
+            break;
+        case RollingOp::MEAN:
+            out.push_back(sum() / m_window);
+            break;
+        case RollingOp::VAR:
+            out.push_back(m_finite == m_window ? m_m2 / (m_window - 1) : std::numeric_limits<decimal_t>::quiet_NaN());
+            break;
+        case RollingOp::STD:
+            out.push_back(m_finite == m_window ? std::sqrt(m_m2 / (m_window - 1)) : std::numeric_limits<decimal_t>::quiet_NaN());
+            break;
+        case RollingOp::MIN:
+        case RollingOp::MAX:
+            out.push_back(m_nan == 0 ? m_extremes.front().second : std::numeric_limits<decimal_t>::quiet_NaN());
+            break;
+        }
+    }
+}
+
+void Ewma::push(const decimal_t *values, size_t n, ListType &out)
+{
+    out.reserve(out.size() + n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        m_value = m_started ? m_alpha * values[i] + (1 - m_alpha) * m_value : values[i];
+        m_started = true;
+        out.push_back(m_value);
+    }
+}
+
+} // namespace eval
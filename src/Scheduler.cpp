@@ -0,0 +1,175 @@
+#include <evaluator/Scheduler.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace eval
+{
+
+static thread_local const TaskScheduler *t_scheduler = nullptr;
+static thread_local size_t t_workerIdx = 0;
+
+TaskScheduler::TaskScheduler(size_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    for (size_t i = 0; i <= threadCount; ++i)
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    m_workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+        m_workers.emplace_back(&TaskScheduler::workerLoop, this, i);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_sleepCv.notify_all();
+    m_waitCv.notify_all();
+    for (auto &w : m_workers)
+        w.join();
+    for (auto &q : m_queues)
+        for (auto task : q->tasks)
+            if (task->detached)
+                delete task;
+}
+
+void TaskScheduler::spawn(Task &task)
+{
+    size_t idx = t_scheduler == this ? t_workerIdx : m_workers.size();
+    {
+        std::lock_guard<std::mutex> lock(m_queues[idx]->mutex);
+        m_queues[idx]->tasks.push_back(&task);
+    }
+    ++m_pending;
+    if (!task.detached)
+        ++m_pendingJoinable;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_sleepCv.notify_one();
+    if (!task.detached)
+        m_waitCv.notify_all();
+}
+
+void TaskScheduler::post(std::function<void()> func, std::function<void(std::exception_ptr)> onError)
+{
+    auto task = new Task;
+    task->func = std::move(func);
+    task->onError = std::move(onError);
+    task->detached = true;
+    spawn(*task);
+}
+
+void TaskScheduler::wait(Task &task)
+{
+    size_t self = t_scheduler == this ? t_workerIdx : m_workers.size();
+    while (!task.done.load(std::memory_order_acquire))
+    {
+        if (auto t = findTask(self, true))
+        {
+            run(t);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_waitCv.wait(lock, [&]
+                      { return task.done.load(std::memory_order_acquire) || m_pendingJoinable > 0; });
+    }
+    if (task.error)
+        std::rethrow_exception(task.error);
+}
+
+// the owner takes its newest task, thieves the oldest; waiters skip detached
+// tasks
+TaskScheduler::Task *TaskScheduler::take(WorkerQueue &queue, bool fromBack, bool joinableOnly)
+{
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    auto &tasks = queue.tasks;
+    auto usable = [joinableOnly](Task *t)
+    { return !joinableOnly || !t->detached; };
+    std::deque<Task *>::iterator ite;
+    if (fromBack)
+    {
+        auto r = std::find_if(tasks.rbegin(), tasks.rend(), usable);
+        if (r == tasks.rend())
+            return nullptr;
+        ite = std::next(r).base();
+    }
+    else
+    {
+        ite = std::find_if(tasks.begin(), tasks.end(), usable);
+        if (ite == tasks.end())
+            return nullptr;
+    }
+    auto task = *ite;
+    tasks.erase(ite);
+    --m_pending;
+    if (!task->detached)
+        --m_pendingJoinable;
+    return task;
+}
+
+TaskScheduler::Task *TaskScheduler::findTask(size_t self, bool joinableOnly)
+{
+    if (auto task = take(*m_queues[self], true, joinableOnly))
+        return task;
+    for (size_t i = 1; i < m_queues.size(); ++i)
+        if (auto task = take(*m_queues[(self + i) % m_queues.size()], false, joinableOnly))
+            return task;
+    return nullptr;
+}
+
+void TaskScheduler::run(Task *task)
+{
+    try
+    {
+        task->func();
+    }
+    catch (...)
+    {
+        task->error = std::current_exception();
+    }
+    if (task->detached)
+    {
+        if (task->error && task->onError)
+        {
+            try
+            {
+                task->onError(task->error);
+            }
+            catch (...)
+            {
+            }
+        }
+        delete task;
+        return;
+    }
+    task->done.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_waitCv.notify_all();
+}
+
+void TaskScheduler::workerLoop(size_t idx)
+{
+    t_scheduler = this;
+    t_workerIdx = idx;
+    while (true)
+    {
+        if (auto task = findTask(idx, false))
+        {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCv.wait(lock, [this]
+                       { return m_stop || m_pending > 0; });
+        if (m_stop)
+            return;
+    }
+}
+
+} // namespace eval
@@ -0,0 +1,47 @@
+#include <evaluator/SharedDefinitions.h>
+
+namespace eval
+{
+
+SharedDefinitions::SharedDefinitions()
+{
+    auto definitions = std::make_shared<Definitions>();
+    definitions->parent = Context::builtins();
+    publish(std::move(definitions));
+}
+
+SharedDefinitions::SharedDefinitions(std::shared_ptr<const Definitions> definitions)
+{
+    publish(std::make_shared<Definitions>(*definitions));
+}
+
+void SharedDefinitions::define(const std::string &input)
+{
+    define(std::vector<std::string>{input});
+}
+
+void SharedDefinitions::define(const std::vector<std::string> &inputs)
+{
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+
+    auto current = snapshot();
+    Context context(current);
+    for (auto &input : inputs)
+        context.exec(input);
+
+    auto next = std::make_shared<Definitions>(*current);
+    for (auto &v : context.varMap())
+        if (v.first != "ans")
+            next->varMap[v.first] = v.second;
+    publish(std::move(next));
+}
+
+void SharedDefinitions::publish(std::shared_ptr<Definitions> definitions)
+{
+    uint64_t version = m_version.load(std::memory_order_relaxed) + 1;
+    definitions->version = version;
+    std::atomic_store(&m_current, std::shared_ptr<const Definitions>(std::move(definitions)));
+    m_version.store(version, std::memory_order_release);
+}
+
+} // namespace eval
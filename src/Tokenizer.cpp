@@ -1,5 +1,8 @@
 #include <evaluator/Tokenizer.h>
+#include <evaluator/Trace.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <unordered_map>
 #include <sstream>
 
@@ -13,25 +16,18 @@ static void skipSpace(std::string::const_iterator &ite,
         ++ite;
 }
 
-static decimal_t parseDecimal(const std::string &src,
-                              std::string::const_iterator &ite)
+static EvalResult<decimal_t> parseDecimal(const std::string &src,
+                                         std::string::const_iterator &ite)
 {
-    size_t idx = 0;
-    decimal_t d{0};
-
-    try
-    {
-        d = strToDecimal<decimal_t>(src.substr(ite - src.begin()), &idx);
-    }
-    catch (const std::invalid_argument &)
-    {
-        return d;
-    }
-    catch (const std::out_of_range &)
-    {
-        throw EvalExcept(EVAL_DECIMAL_OUT_OF_RANGE);
-    }
-    ite += idx;
+    const char *beg = src.c_str() + (ite - src.begin());
+    char *end = nullptr;
+    errno = 0;
+    decimal_t d = strToDecimal<decimal_t>(beg, &end);
+    if (end == beg)
+        return decimal_t{0};
+    if (errno == ERANGE)
+        return EvalError{EVAL_DECIMAL_OUT_OF_RANGE, static_cast<size_t>(ite - src.begin())};
+    ite += end - beg;
     return d;
 }
 
@@ -69,8 +65,9 @@ static const std::unordered_map<char, TokenType> tkMap{
     {'=', TokenType::ASSIGN},
 };
 
-TokenList tokenize(const std::string &src)
+EvalResult<TokenList> tryTokenize(const std::string &src)
 {
+    TraceSpan span("tokenize");
     TokenList ret{};
     auto ite = src.begin();
     const auto end = src.end();
@@ -81,33 +78,54 @@ TokenList tokenize(const std::string &src)
         if (ite == end)
             return ret;
 
+        const auto beg = ite;
+        const size_t pos = beg - src.begin();
+
         auto tkIte = tkMap.find(*ite);
         if (tkIte != tkMap.end())
         {
             ++ite;
             ret.push_back(tkIte->second);
+            ret.back().pos = pos;
             continue;
         }
 
-        const auto beg = ite;
+        // string literals have no escapes and end at the next quote
+        if (*ite == '"')
+        {
+            auto close = std::find(ite + 1, end, '"');
+            if (close == end)
+                return EvalError{EVAL_PARSE_FAILED, pos};
+            ret.emplace_back(TokenType::STRING, std::string(ite + 1, close));
+            ret.back().pos = pos;
+            ite = close + 1;
+            continue;
+        }
 
-        decimal_t d = parseDecimal(src, ite);
+        EVAL_TRY(d, parseDecimal(src, ite));
         if (ite != beg)
         {
-            ret.push_back(d);
+            ret.push_back(*d);
+            ret.back().pos = pos;
             continue;
         }
 
         parseSymbol(ite, end);
         if (ite != beg)
         {
-            ret.push_back(src.substr(beg - src.begin(), ite - beg));
+            ret.push_back(src.substr(pos, ite - beg));
+            ret.back().pos = pos;
             continue;
         }
         else
-            throw EvalExcept(EVAL_PARSE_FAILED);
+            return EvalError{EVAL_PARSE_FAILED, pos};
     }
     return ret;
 }
 
+TokenList tokenize(const std::string &src)
+{
+    return tryTokenize(src).valueOrThrow();
+}
+
 } // namespace eval
\ No newline at end of file
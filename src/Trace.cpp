@@ -0,0 +1,252 @@
+#include <evaluator/Trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+
+namespace eval
+{
+
+static thread_local size_t t_depth = 0;
+static thread_local bool t_sampled = false;
+
+TraceState traceState()
+{
+    return {t_depth, t_sampled};
+}
+
+void setTraceState(TraceState state)
+{
+    t_depth = state.depth;
+    t_sampled = state.sampled;
+}
+
+Tracer &Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::start(size_t sampleEvery, size_t bufferEvents)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bufferEvents = std::max<size_t>(1, bufferEvents);
+    }
+    m_sampleEvery.store(std::max<size_t>(1, sampleEvery), std::memory_order_relaxed);
+    m_enabled.store(true, std::memory_order_relaxed);
+}
+
+// Spans check m_enabled after announcing themselves in their buffer, so a
+// span missed here sees tracing stopped and does not record.
+void Tracer::stop()
+{
+    m_enabled.store(false);
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        buffers = m_buffers;
+    }
+    // the spans of the calling thread close after it returns
+    auto own = lease().buffer.get();
+    for (auto &buffer : buffers)
+        if (buffer.get() != own)
+            while (buffer->open.load(std::memory_order_acquire) != 0)
+                std::this_thread::yield();
+}
+
+bool Tracer::sample()
+{
+    return m_sampleCounter.fetch_add(1, std::memory_order_relaxed) %
+               m_sampleEvery.load(std::memory_order_relaxed) ==
+           0;
+}
+
+uint64_t Tracer::now() const
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - epoch)
+                                     .count());
+}
+
+Tracer::BufferLease::~BufferLease()
+{
+    if (buffer == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(Tracer::instance().m_mutex);
+    buffer->inUse = false;
+}
+
+Tracer::BufferLease &Tracer::lease()
+{
+    static thread_local BufferLease lease;
+    return lease;
+}
+
+Tracer::ThreadBuffer &Tracer::threadBuffer()
+{
+    auto &current = lease();
+    if (current.buffer == nullptr)
+        current.buffer = acquireBuffer();
+    return *current.buffer;
+}
+
+// a new thread gets its own tid, even in a reused buffer
+std::shared_ptr<Tracer::ThreadBuffer> Tracer::acquireBuffer()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &buffer : m_buffers)
+        if (!buffer->inUse && buffer->capacity == m_bufferEvents)
+        {
+            buffer->inUse = true;
+            buffer->tid = ++m_nextTid;
+            buffer->head.store(0, std::memory_order_relaxed);
+            return buffer;
+        }
+    auto buffer = std::make_shared<ThreadBuffer>();
+    buffer->tid = ++m_nextTid;
+    buffer->capacity = m_bufferEvents;
+    buffer->slots = std::make_unique<Slot[]>(m_bufferEvents);
+    m_buffers.push_back(buffer);
+    return buffer;
+}
+
+bool Tracer::open()
+{
+    auto &buffer = threadBuffer();
+    buffer.open.fetch_add(1);
+    if (m_enabled.load())
+        return true;
+    buffer.open.fetch_sub(1, std::memory_order_release);
+    return false;
+}
+
+void Tracer::record(const char *name, uint64_t startNs, uint64_t durNs)
+{
+    auto &buffer = threadBuffer();
+    auto head = buffer.head.load(std::memory_order_relaxed);
+    auto &slot = buffer.slots[head % buffer.capacity];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.durNs.store(durNs, std::memory_order_relaxed);
+    slot.seq.store(head + 1, std::memory_order_release);
+    buffer.head.store(head + 1, std::memory_order_release);
+    buffer.open.fetch_sub(1, std::memory_order_release);
+}
+
+const char *Tracer::intern(const std::string &name)
+{
+    static thread_local std::unordered_map<std::string, const char *> cache;
+    static thread_local uint64_t cacheGeneration = 0;
+    auto generation = m_namesGeneration.load(std::memory_order_acquire);
+    if (cacheGeneration != generation)
+    {
+        cache.clear();
+        cacheGeneration = generation;
+    }
+    auto ite = cache.find(name);
+    if (ite != cache.end())
+        return ite->second;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto str = m_names.insert(name).first->c_str();
+    cache.emplace(name, str);
+    return str;
+}
+
+JsonNode Tracer::toJson() const
+{
+    JsonArr_t events;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &buffer : m_buffers)
+    {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t count = std::min<uint64_t>(head, buffer->capacity);
+        for (uint64_t i = head - count; i < head; ++i)
+        {
+            // skip slots the owner started to overwrite since head was read
+            auto &slot = buffer->slots[i % buffer->capacity];
+            if (slot.seq.load(std::memory_order_acquire) != i + 1)
+                continue;
+            TraceEvent e{slot.name.load(std::memory_order_relaxed),
+                         slot.startNs.load(std::memory_order_relaxed),
+                         slot.durNs.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != i + 1)
+                continue;
+            events.push_back(jsptr({{"name", jsptr(e.name)},
+                                    {"ph", jsptr("X")},
+                                    {"ts", jsptr(e.startNs * 1e-3)},
+                                    {"dur", jsptr(e.durNs * 1e-3)},
+                                    {"pid", jsptr(1.0)},
+                                    {"tid", jsptr(static_cast<double>(buffer->tid))}}));
+        }
+    }
+    return {{"traceEvents", jsptr(events)},
+            {"displayTimeUnit", jsptr("ns")}};
+}
+
+void Tracer::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffers.erase(std::remove_if(m_buffers.begin(), m_buffers.end(), [](auto &buffer)
+                                   { return !buffer->inUse; }),
+                    m_buffers.end());
+    for (auto &buffer : m_buffers)
+        buffer->head.store(0, std::memory_order_release);
+    m_names.clear();
+    m_namesGeneration.fetch_add(1, std::memory_order_release);
+}
+
+size_t Tracer::bufferCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_buffers.size();
+}
+
+bool TraceSpan::enter(bool active)
+{
+    auto &tracer = Tracer::instance();
+    if (!active || !tracer.enabled())
+        return false;
+    if (t_depth++ == 0)
+        t_sampled = tracer.sample();
+    m_entered = true;
+    return t_sampled && tracer.open();
+}
+
+TraceSpan::TraceSpan(const char *name, bool active)
+{
+    if (enter(active))
+    {
+        m_name = name;
+        m_start = Tracer::instance().now();
+    }
+}
+
+TraceSpan::TraceSpan(const std::string &name, bool active)
+{
+    if (enter(active))
+    {
+        m_name = Tracer::instance().intern(name);
+        m_start = Tracer::instance().now();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (!m_entered)
+        return;
+    --t_depth;
+    if (m_name != nullptr)
+    {
+        auto &tracer = Tracer::instance();
+        tracer.record(m_name, m_start, tracer.now() - m_start);
+    }
+}
+
+} // namespace eval
@@ -0,0 +1,99 @@
+#include "Test.h"
+
+#include <evaluator/AsyncEval.h>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace eval;
+
+static const char *const DOWN = "down(n) = if_else(gt(n, 0), down(n - 1) + 1, 0)";
+
+TEST(resume_until_done)
+{
+    auto context = evaltest::makeContext({evaltest::FIB, DOWN});
+    AsyncEval async(context, "fib(15)", 100);
+    size_t resumes = 0;
+    while (async.resume() == AsyncState::SUSPENDED)
+        ++resumes;
+    CHECK(resumes > 10);
+    CHECK(async.state() == AsyncState::DONE);
+    CHECK_EQ(evaltest::number(async.result()), 987.0);
+    CHECK_EQ(evaltest::number(context.exec("ans")), 987.0);
+}
+
+TEST(cancel_unwinds)
+{
+    auto context = evaltest::makeContext({evaltest::FIB, DOWN});
+    AsyncEval async(context, "x = fib(20)", 100);
+    CHECK(async.resume() == AsyncState::SUSPENDED);
+    async.cancel();
+    CHECK(async.state() == AsyncState::CANCELLED);
+    CHECK(context.find("x") == nullptr);
+    CHECK_EQ(evaltest::number(context.exec("fib(5)")), 8.0);
+}
+
+TEST(deep_recursion_fails_cleanly)
+{
+    for (size_t stackSize : {size_t(0), size_t(256) << 10, ASYNC_STACK_SIZE})
+    {
+        auto context = evaltest::makeContext({evaltest::FIB, DOWN});
+        AsyncEval async(context, "down(100000000)", 1 << 20, std::nullopt, stackSize);
+        while (async.resume() == AsyncState::SUSPENDED)
+            ;
+        CHECK(async.state() == AsyncState::FAILED);
+        CHECK(async.error().has_value());
+        CHECK_EQ(async.error()->code(), EVAL_RECURSION_LIMIT_EXCEEDED);
+
+        // recursion that fits still works on the same stack size
+        const int depth = stackSize >= ASYNC_STACK_SIZE ? 1000 : 10;
+        AsyncEval shallow(context, "down(" + std::to_string(depth) + ")", 1 << 20, std::nullopt, stackSize);
+        while (shallow.resume() == AsyncState::SUSPENDED)
+            ;
+        CHECK(shallow.state() == AsyncState::DONE);
+        CHECK_EQ(evaltest::number(shallow.result()), depth);
+    }
+}
+
+TEST(stack_left_inside_the_coroutine_only)
+{
+    size_t inside = 0;
+    Coroutine *self = nullptr;
+    Coroutine coroutine([&]
+                        { inside = self->stackLeft(); },
+                        64 << 10);
+    self = &coroutine;
+    CHECK_EQ(coroutine.stackLeft(), SIZE_MAX);
+    coroutine.resume();
+    CHECK(inside > 0 && inside < (64 << 10));
+}
+
+#ifndef _WIN32
+// deep enough to overflow any coroutine stack used here
+static size_t recurse(volatile char *prev, size_t depth)
+{
+    volatile char frame[1024];
+    frame[0] = prev != nullptr ? prev[0] : 0;
+    return depth == 0 ? 0 : recurse(frame, depth - 1) + frame[0];
+}
+
+TEST(stack_overflow_hits_the_guard_page)
+{
+    auto pid = fork();
+    if (pid == 0)
+    {
+        Coroutine coroutine([]
+                            { recurse(nullptr, 1 << 20); },
+                            64 << 10);
+        coroutine.resume();
+        _exit(0);
+    }
+    int status = 0;
+    CHECK_EQ(waitpid(pid, &status, 0), pid);
+    CHECK(WIFSIGNALED(status));
+    CHECK(WTERMSIG(status) == SIGSEGV || WTERMSIG(status) == SIGBUS);
+}
+#endif
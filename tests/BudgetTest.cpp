@@ -0,0 +1,133 @@
+#include "Test.h"
+
+#include <evaluator/AsyncEval.h>
+#include <evaluator/Budget.h>
+#include <evaluator/Scheduler.h>
+
+using namespace eval;
+
+TEST(step_limit)
+{
+    auto context = evaltest::makeContext({evaltest::FIB});
+    EvalBudget budget;
+    budget.maxSteps = 1000;
+    CHECK_THROWS(context.exec("fib(20)", budget), EVAL_STEP_LIMIT_EXCEEDED);
+    // small evaluations stay below the check granularity
+    CHECK_EQ(evaltest::number(context.exec("fib(3)", budget)), 3.0);
+    // the budget only applies to its exec
+    CHECK_EQ(evaltest::number(context.exec("fib(15)")), 987.0);
+}
+
+TEST(memory_limit)
+{
+    auto context = evaltest::makeContext({evaltest::FIB});
+    context.exec("xs = [1, 2, 3, 4, 5, 6, 7, 8]");
+    EvalBudget budget;
+    budget.maxBytes = 1024;
+    CHECK_THROWS(context.exec("xs + xs + xs + xs + xs + xs + xs + xs + xs + xs + xs + xs + xs + xs + xs + xs + xs", budget),
+                 EVAL_MEMORY_LIMIT_EXCEEDED);
+    CHECK_EQ(evaltest::list(context.exec("xs + xs", budget)).size(), size_t(8));
+}
+
+TEST(time_limit)
+{
+    auto context = evaltest::makeContext({evaltest::FIB});
+    EvalBudget budget;
+    budget.timeout = std::chrono::milliseconds(1);
+    CHECK_THROWS(context.exec("fib(30)", budget), EVAL_TIME_LIMIT_EXCEEDED);
+}
+
+TEST(depth_limit)
+{
+    auto context = evaltest::makeContext({evaltest::FIB});
+    context.exec("down(n) = if_else(gt(n, 0), down(n - 1), 0)");
+    EvalBudget budget;
+    budget.maxDepth = 50;
+    CHECK_THROWS(context.exec("down(100)", budget), EVAL_RECURSION_LIMIT_EXCEEDED);
+    CHECK_EQ(evaltest::number(context.exec("down(40)", budget)), 0.0);
+}
+
+TEST(exhausted_budget_leaves_context_usable)
+{
+    auto context = evaltest::makeContext({evaltest::FIB});
+    EvalBudget budget;
+    budget.maxSteps = 500;
+    auto ret = context.tryExec("fib(1)");
+    CHECK(ret);
+    CHECK_THROWS(context.exec("x = fib(25)", budget), EVAL_STEP_LIMIT_EXCEEDED);
+    CHECK(context.find("x") == nullptr);
+    CHECK_EQ(evaltest::number(context.exec("fib(10)")), 89.0);
+}
+
+TEST(pending_counts_belong_to_their_budget)
+{
+    EvalBudget limits;
+    limits.maxSteps = 1000;
+    auto a = std::make_shared<BudgetState>(limits);
+    auto b = std::make_shared<BudgetState>(limits);
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 100; ++i)
+            a->step();
+        for (int i = 0; i < 50; ++i)
+            b->step();
+    }
+    a->flush();
+    b->flush();
+    CHECK_EQ(a->steps(), uint64_t(300));
+    CHECK_EQ(b->steps(), uint64_t(150));
+
+    // a fresh budget starts from zero even if the last one left counts behind
+    b->step();
+    b.reset();
+    auto c = std::make_shared<BudgetState>(limits);
+    c->flush();
+    CHECK_EQ(c->steps(), uint64_t(0));
+}
+
+TEST(interleaved_async_budgets_are_independent)
+{
+    // steps of the small evaluation alone
+    uint64_t steps;
+    {
+        auto context = evaltest::makeContext({evaltest::FIB});
+        AsyncEval probe(context, "fib(12)", 128);
+        while (probe.resume() == AsyncState::SUSPENDED)
+            ;
+        steps = probe.steps();
+    }
+
+    EvalBudget tight;
+    tight.maxSteps = steps + steps / 8;
+    EvalBudget loose;
+    loose.timeout = std::chrono::seconds(600);
+
+    auto contextA = evaltest::makeContext({evaltest::FIB});
+    auto contextB = evaltest::makeContext({evaltest::FIB});
+    // each round runs 64 + 192 = BUDGET_CHECK_INTERVAL steps and a reaches
+    // the flush point, so counts shared per thread would all be charged to a
+    AsyncEval a(contextA, "fib(12)", 192, tight);
+    AsyncEval b(contextB, "fib(16)", 64, loose);
+    while (!a.done())
+    {
+        if (!b.done())
+            b.resume();
+        a.resume();
+    }
+    CHECK(a.state() == AsyncState::DONE);
+    CHECK_EQ(evaltest::number(a.result()), 233.0);
+    while (!b.done())
+        b.resume();
+    CHECK(b.state() == AsyncState::DONE);
+}
+
+TEST(budget_applies_to_parallel_tasks)
+{
+    TaskScheduler scheduler(2);
+    auto context = evaltest::makeContext({evaltest::FIB});
+    context.setParallelEval(&scheduler);
+    EvalBudget budget;
+    budget.maxSteps = 2000;
+    CHECK_THROWS(context.exec("fib(18) + fib(18)", budget), EVAL_STEP_LIMIT_EXCEEDED);
+    CHECK_EQ(evaltest::number(context.exec("fib(10) + fib(10)")), 178.0);
+}
@@ -0,0 +1,96 @@
+#include "Test.h"
+
+using namespace eval;
+
+TEST(compile_scalar_lambda)
+{
+    auto context = evaltest::makeContext();
+    context.exec("f(x, y) = sqrt(x^2 + y^2)");
+    auto f = context.compile<double(double, double)>("f");
+    CHECK(f);
+    CHECK_EQ(f(3, 4), 5.0);
+    CHECK_EQ(f(0, 0), 0.0);
+}
+
+TEST(compile_recursion_and_branches)
+{
+    auto context = evaltest::makeContext();
+    context.exec(evaltest::FIB);
+    auto fib = context.compile<int(int)>("fib");
+    CHECK_EQ(fib(10), 89);
+    context.exec("g(x) = and(gt(x, 0), or(lt(x, 2), eq(x, 5)))");
+    auto g = context.compile<double(double)>("g");
+    CHECK_EQ(g(1), 1.0);
+    CHECK_EQ(g(3), 0.0);
+    CHECK_EQ(g(5), 1.0);
+    CHECK_EQ(g(-1), 0.0);
+}
+
+TEST(compile_binds_globals)
+{
+    auto context = evaltest::makeContext();
+    context.exec("k = 3");
+    context.exec("f(x) = k * x");
+    auto f = context.compile<double(double)>("f");
+    context.exec("k = 10");
+    CHECK_EQ(f(2), 6.0);
+}
+
+TEST(compile_rejects_wrong_arity)
+{
+    auto context = evaltest::makeContext();
+    context.exec("f(x, y) = x + y");
+    CHECK_THROWS(context.compile<double(double)>("f"), EVAL_WRONG_NUMBER_OF_PARAMETERS);
+}
+
+TEST(compile_rejects_undefined_and_lists)
+{
+    auto context = evaltest::makeContext();
+    CHECK_THROWS(context.compile<double(double)>("nothing"), EVAL_IDENTIFIER_UNDEFINED);
+    context.exec("f(x) = x + undefined_name");
+    CHECK_THROWS(context.compile<double(double)>("f"), EVAL_IDENTIFIER_UNDEFINED);
+    context.exec("g(x) = [x, 1]");
+    CHECK_THROWS(context.compile<double(double)>("g"), EVAL_NOT_COMPILABLE);
+    context.exec("v = 1");
+    CHECK_THROWS(context.compile<double(double)>("v"), EVAL_OBJECT_NOT_CALLABLE);
+}
+
+TEST(batch_matches_row_evaluation)
+{
+    auto context = evaltest::makeContext();
+    const size_t n = 1000; // several blocks and a partial one
+    std::vector<double> x(n), y(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        x[i] = static_cast<double>(i) - 500;
+        y[i] = 0.25 * static_cast<double>(i % 17);
+    }
+    const std::string expr = "if_else(gt(x, y), sqrt(x^2 + y^2), and(x, y) - y / (1 + x^2))";
+    auto ret = context.evalBatch(expr, {"x", "y"}, {{x.data(), n}, {y.data(), n}});
+    CHECK_EQ(ret.size(), n);
+    auto program = context.compileExpr(expr, {"x", "y"});
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double args[] = {x[i], y[i]};
+        CHECK(evaltest::same(ret[i], program->run(args)));
+    }
+}
+
+TEST(batch_calls_user_lambdas)
+{
+    auto context = evaltest::makeContext();
+    context.exec("f(t) = if_else(gt(t, 1), f(t - 1) + 1, t)");
+    std::vector<double> x{0, 1, 2.5, 10};
+    auto ret = context.evalBatch("f(x) * 2", {"x"}, {{x.data(), x.size()}});
+    CHECK(evaltest::sameList(ret, {0, 2, 5, 20}));
+}
+
+TEST(batch_edge_cases)
+{
+    auto context = evaltest::makeContext();
+    std::vector<double> x{1, 2, 3}, y{1, 2};
+    CHECK_EQ(context.evalBatch("x + 1", {"x"}, {{x.data(), 0}}).size(), size_t(0));
+    CHECK_THROWS(context.evalBatch("x + y", {"x", "y"}, {{x.data(), 3}, {y.data(), 2}}), EVAL_DIFFERENT_LIST_LENGTHS);
+    CHECK_THROWS(context.evalBatch("x + y", {"x", "y"}, {{x.data(), 3}}), EVAL_WRONG_NUMBER_OF_PARAMETERS);
+    CHECK_THROWS(context.evalBatch("[x]", {"x"}, {{x.data(), 3}}), EVAL_NOT_COMPILABLE);
+}
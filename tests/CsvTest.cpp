@@ -0,0 +1,133 @@
+#include "Test.h"
+
+#include <evaluator/DataIO.h>
+#include <evaluator/Scheduler.h>
+
+#include <cstdio>
+#include <fstream>
+
+using namespace eval;
+
+static void writeFile(const std::string &path, const std::string &data)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << data;
+}
+
+static CsvColumn byName(const std::string &name)
+{
+    CsvColumn column;
+    column.name = name;
+    return column;
+}
+
+static CsvColumn byIndex(size_t index)
+{
+    CsvColumn column;
+    column.index = index;
+    return column;
+}
+
+TEST(columns_by_name_and_index)
+{
+    writeFile("columns.csv", "time, \"price\",qty\r\n1,10.5,3\r\n2,\"11\",-4\r\n\r\n3,,+5\r\n");
+    auto price = loadCsv("columns.csv", byName("price"));
+    CHECK_EQ(price.size(), size_t(3));
+    CHECK_EQ(price[0], decimal_t(10.5));
+    CHECK_EQ(price[1], decimal_t(11));
+    CHECK(std::isnan(price[2]));
+    CHECK(evaltest::sameList(loadCsv("columns.csv", byIndex(2)), {3, -4, 5}));
+
+    // without a header the first line is data
+    writeFile("columns.csv", "1,2\n3,4");
+    CHECK(evaltest::sameList(loadCsv("columns.csv", byIndex(1)), {2, 4}));
+    writeFile("columns.csv", "");
+    CHECK_EQ(loadCsv("columns.csv", byIndex(0)).size(), size_t(0));
+    std::remove("columns.csv");
+}
+
+TEST(malformed_csv_throws)
+{
+    const char *inputs[] = {
+        "a,b\n1,2\n3\n",
+        "a,b\n1,x\n",
+        "a,b\n1,2e\n",
+    };
+    for (auto input : inputs)
+    {
+        writeFile("malformed.csv", input);
+        CHECK_THROWS(loadCsv("malformed.csv", byName("b")), EVAL_FILE_MALFORMED);
+    }
+    writeFile("malformed.csv", "a,b\n1,2\n");
+    CHECK_THROWS(loadCsv("malformed.csv", byName("c")), EVAL_FILE_MALFORMED);
+    CHECK_THROWS(loadCsv("missing.csv", byIndex(0)), EVAL_FILE_NOT_READABLE);
+    std::remove("malformed.csv");
+}
+
+TEST(parallel_parsing_matches_serial)
+{
+    // several chunks of CSV_CHUNK_SIZE
+    std::string data = "id,value\n";
+    const size_t rows = 3 * CSV_CHUNK_SIZE / 12;
+    for (size_t i = 0; i < rows; ++i)
+        data += std::to_string(i) + "," + std::to_string(i * 0.25) + "\n";
+    writeFile("large.csv", data);
+
+    TaskScheduler scheduler(4);
+    auto serial = loadCsv("large.csv", byName("value"));
+    auto parallel = loadCsv("large.csv", byName("value"), &scheduler);
+    CHECK_EQ(serial.size(), rows);
+    CHECK_EQ(parallel.size(), rows);
+    CHECK(std::equal(serial.begin(), serial.end(), parallel.begin()));
+    CHECK_EQ(parallel[rows - 1], decimal_t((rows - 1) * 0.25));
+    std::remove("large.csv");
+}
+
+TEST(fold_streams_blocks_in_order)
+{
+    // more than one CSV_BLOCK_SIZE, so lines are carried between blocks
+    std::string data = "x\n";
+    size_t rows = 0;
+    while (data.size() < CSV_BLOCK_SIZE + CSV_BLOCK_SIZE / 4)
+        data += std::to_string(decimal_t(rows++ % 1000)) + "\n";
+    writeFile("fold.csv", data);
+
+    size_t count = 0, blocks = 0;
+    decimal_t sum = 0, last = -1;
+    bool ordered = true;
+    foldCsv("fold.csv", byIndex(0), [&](const decimal_t *values, size_t n)
+            {
+                ++blocks;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    ordered = ordered && values[i] == decimal_t((count + i) % 1000);
+                    sum += values[i];
+                }
+                count += n;
+                last = values[n - 1];
+                return true; });
+    CHECK_EQ(count, rows);
+    CHECK(blocks >= 2);
+    CHECK(ordered);
+    CHECK_EQ(last, decimal_t((rows - 1) % 1000));
+
+    auto context = evaltest::makeContext();
+    context.setFileAccess(true);
+    CHECK_EQ(evaltest::number(context.exec("fold_csv(\"fold.csv\", \"x\", @(a, x){a + x}, 0)")), sum);
+    CHECK_EQ(evaltest::number(context.exec("len(load_csv(\"fold.csv\", 0))")), decimal_t(rows));
+    std::remove("fold.csv");
+}
+
+TEST(csv_builtin_errors)
+{
+    writeFile("errors.csv", "a\n1\n");
+    auto context = evaltest::makeContext();
+    context.setFileAccess(true);
+    auto ret = context.tryExec("load_csv(\"errors.csv\", -1)");
+    CHECK(!ret && ret.error().code == EVAL_WRONG_PARAMETER_TYPE);
+    ret = context.tryExec("fold_csv(\"errors.csv\", 0, 1, 0)");
+    CHECK(!ret && ret.error().code == EVAL_OBJECT_NOT_CALLABLE);
+    ret = context.tryExec("load_csv(\"errors.csv\", \"b\")");
+    CHECK(!ret && ret.error().code == EVAL_FILE_MALFORMED);
+    std::remove("errors.csv");
+}
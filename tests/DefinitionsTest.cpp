@@ -0,0 +1,112 @@
+#include "Test.h"
+
+#include <evaluator/SharedDefinitions.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace eval;
+using evaltest::number;
+
+TEST(shared_definitions_visible_to_contexts)
+{
+    SharedDefinitions shared;
+    shared.define(evaltest::FIB);
+    Context context(shared);
+    CHECK_EQ(number(context.exec("fib(10)")), 89.0);
+    CHECK_EQ(number(context.exec("sqrt(16)")), 4.0);
+}
+
+TEST(shared_definitions_local_assignments_stay_local)
+{
+    SharedDefinitions shared;
+    shared.define("k = 2");
+    Context a(shared), b(shared);
+    a.exec("k = 5");
+    CHECK_EQ(number(a.exec("k")), 5.0);
+    CHECK_EQ(number(b.exec("k")), 2.0);
+    CHECK_EQ(number(Context(shared).exec("k")), 2.0);
+}
+
+TEST(shared_definitions_new_version_at_next_exec)
+{
+    SharedDefinitions shared;
+    shared.define("k = 1");
+    Context context(shared);
+    CHECK_EQ(number(context.exec("k")), 1.0);
+    const auto version = shared.version();
+    shared.define(std::vector<std::string>{"k = 2", "m = k * 10"});
+    CHECK_EQ(shared.version(), version + 1);
+    CHECK_EQ(number(context.exec("m + k")), 22.0);
+    // ans of the defining inputs is not published
+    CHECK_EQ(number(Context(shared).exec("ans")), 0.0);
+}
+
+TEST(shared_definitions_failed_define_publishes_nothing)
+{
+    SharedDefinitions shared;
+    shared.define("k = 1");
+    const auto version = shared.version();
+    CHECK_THROWS(shared.define(std::vector<std::string>{"k = 2", "k = undefined_name"}), EVAL_IDENTIFIER_UNDEFINED);
+    CHECK_EQ(shared.version(), version);
+    CHECK_EQ(number(Context(shared).exec("k")), 1.0);
+}
+
+TEST(shared_definitions_concurrent_readers)
+{
+    SharedDefinitions shared;
+    shared.define("f(x) = x * 1");
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> bad{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+        readers.emplace_back([&]
+                             {
+                                 Context context(shared);
+                                 while (!stop.load())
+                                 {
+                                     auto v = number(context.exec("f(3)"));
+                                     if (v < 3 || v > 3 * 50)
+                                         ++bad;
+                                 } });
+    for (int i = 2; i <= 50; ++i)
+        shared.define("f(x) = x * " + std::to_string(i));
+    stop = true;
+    for (auto &t : readers)
+        t.join();
+    CHECK_EQ(bad.load(), size_t(0));
+    CHECK_EQ(number(Context(shared).exec("f(3)")), 150.0);
+}
+
+TEST(prototype_contexts_share_frozen_layer)
+{
+    Context library;
+    library.init();
+    library.exec("f(x, y) = sqrt(x^2 + y^2)");
+    library.exec("base = [1, 2, 3]");
+    auto prototype = library.freeze();
+    CHECK(prototype->parent == Context::builtins());
+
+    Context session(prototype);
+    CHECK_EQ(number(session.exec("f(3, 4)")), 5.0);
+    session.exec("base = assign(base, 0, 10)");
+    CHECK(evaltest::sameList(evaltest::list(session.exec("base")), {10, 2, 3}));
+    CHECK(evaltest::sameList(evaltest::list(Context(prototype).exec("base")), {1, 2, 3}));
+    // the session only holds what it assigned
+    CHECK(session.varMap().count("f") == 0);
+
+    // later changes to the library do not leak into the frozen layer
+    library.exec("f(x, y) = 0");
+    CHECK_EQ(number(Context(prototype).exec("f(3, 4)")), 5.0);
+}
+
+TEST(prototype_init_keeps_builtins)
+{
+    Context context;
+    context.init();
+    context.exec("x = 1");
+    context.init();
+    CHECK_THROWS(context.exec("x"), EVAL_IDENTIFIER_UNDEFINED);
+    CHECK_EQ(number(context.exec("len([1, 2])")), 2.0);
+    CHECK(context.find("sin") != nullptr);
+}
@@ -0,0 +1,111 @@
+#include "Test.h"
+
+#include <evaluator/Scheduler.h>
+
+using namespace eval;
+
+// errors thrown by builtins carry no position, so a position shows that the
+// error was returned as a value
+static void checkError(Context &context, const std::string &input, EvalErrCode code, size_t pos)
+{
+    auto ret = context.tryExec(input);
+    if (ret)
+        evaltest::fail(__FILE__, __LINE__, input + " did not fail");
+    if (ret.error().code != code || ret.error().pos != pos)
+        evaltest::fail(__FILE__, __LINE__, input + ": " + ret.error().what() + " at " + evaltest::show(ret.error().pos));
+}
+
+TEST(builtin_argument_errors_keep_their_position)
+{
+    auto context = evaltest::makeContext();
+    checkError(context, "1 + sin(undefined)", EVAL_IDENTIFIER_UNDEFINED, 8);
+    checkError(context, "gt(1, 2 + nothing)", EVAL_IDENTIFIER_UNDEFINED, 10);
+    checkError(context, "if_else(eq(1, 1), missing, 0)", EVAL_IDENTIFIER_UNDEFINED, 18);
+    checkError(context, "len([1, 2][5])", EVAL_INDEX_OUT_OF_RANGE, 10);
+}
+
+TEST(builtin_errors_point_at_the_call)
+{
+    auto context = evaltest::makeContext();
+    checkError(context, "if_else([1], 2, 3)", EVAL_WRONG_PARAMETER_TYPE, 7);
+    checkError(context, "  gt(1)", EVAL_WRONG_NUMBER_OF_PARAMETERS, 4);
+    checkError(context, "sum(3)", EVAL_WRONG_PARAMETER_TYPE, 3);
+    checkError(context, "sqrt(@(x){x})", EVAL_WRONG_PARAMETER_TYPE, 4);
+    checkError(context, "slice([1, 2], 0, 5)", EVAL_INDEX_OUT_OF_RANGE, 5);
+    checkError(context, "assign([1], 3, 0)", EVAL_INDEX_OUT_OF_RANGE, 6);
+    checkError(context, "append([1], @(x){x})", EVAL_WRONG_PARAMETER_TYPE, 6);
+    checkError(context, "rolling_var([1, 2, 3], 1)", EVAL_WRONG_PARAMETER_TYPE, 11);
+    checkError(context, "ewma([1], 2)", EVAL_WRONG_PARAMETER_TYPE, 4);
+    checkError(context, "pmap([1], 2)", EVAL_OBJECT_NOT_CALLABLE, 4);
+}
+
+TEST(errors_inside_lambdas)
+{
+    auto context = evaltest::makeContext();
+    context.exec("f(x) = sqrt(x) + y");
+    auto ret = context.tryExec("f(4)");
+    CHECK(!ret);
+    CHECK_EQ(ret.error().code, EVAL_IDENTIFIER_UNDEFINED);
+    CHECK(ret.error().pos != EVAL_NO_POS);
+    checkError(context, "f(1, 2)", EVAL_WRONG_NUMBER_OF_PARAMETERS, 1);
+    checkError(context, "preduce([1, 2, 3], @(a, b){a + c}, 0)", EVAL_IDENTIFIER_UNDEFINED, 31);
+}
+
+TEST(list_and_parallel_errors)
+{
+    TaskScheduler scheduler(4);
+    auto context = evaltest::makeContext({"f(x) = sqrt(x) + y"});
+    checkError(context, "[1, 2] + [1, 2, 3]", EVAL_DIFFERENT_LIST_LENGTHS, 7);
+    checkError(context, "dot([1, 2], [1])", EVAL_DIFFERENT_LIST_LENGTHS, 3);
+    context.setParallelEval(&scheduler, 1);
+    context.setParallelMapThreshold(2);
+    checkError(context, "pmap([1, 2, 3, 4, 5], @(x){[x]})", EVAL_LIST_MEMBER_NOT_DECIMAL, 4);
+    checkError(context, "pmap([1, 2, 3, 4, 5], f)", EVAL_IDENTIFIER_UNDEFINED, 17);
+    checkError(context, "[f(1), f(2)]", EVAL_IDENTIFIER_UNDEFINED, 17);
+}
+
+TEST(exec_throws_the_same_error)
+{
+    auto context = evaltest::makeContext();
+    CHECK_THROWS(context.exec("cos(nothing)"), EVAL_IDENTIFIER_UNDEFINED);
+    CHECK_THROWS(context.exec("and(1, [2])"), EVAL_WRONG_PARAMETER_TYPE);
+    try
+    {
+        context.exec("1 + cos(nothing)");
+    }
+    catch (const EvalExcept &e)
+    {
+        CHECK_EQ(e.error().pos, size_t(8));
+    }
+}
+
+TEST(failed_calls_do_not_change_ans)
+{
+    auto context = evaltest::makeContext();
+    context.exec("41 + 1");
+    CHECK(!context.tryExec("sin(undefined)"));
+    CHECK(!context.tryExec("if_else([1], 2, 3)"));
+    CHECK_EQ(evaltest::number(context.exec("ans")), 42.0);
+}
+
+TEST(syntax_errors)
+{
+    auto context = evaltest::makeContext();
+    checkError(context, "foo(1", EVAL_PARSE_FAILED, 4);
+}
+
+TEST(nesting_limits)
+{
+    auto context = evaltest::makeContext();
+    auto nested = [](size_t depth)
+    { return std::string(depth, '(') + "1" + std::string(depth, ')'); };
+    CHECK_EQ(evaltest::number(context.exec(nested(PARSE_MAX_DEPTH - 1))), 1.0);
+    checkError(context, nested(PARSE_MAX_DEPTH), EVAL_RECURSION_LIMIT_EXCEEDED, PARSE_MAX_DEPTH);
+    checkError(context, nested(100000), EVAL_RECURSION_LIMIT_EXCEEDED, PARSE_MAX_DEPTH);
+
+    // recursion without a budget stops before the stack runs out
+    context.exec("down(n) = if_else(gt(n, 0), down(n - 1) + 1, 0)");
+    auto ret = context.tryExec("down(1000000)");
+    CHECK(!ret && ret.error().code == EVAL_RECURSION_LIMIT_EXCEEDED);
+    CHECK_EQ(evaltest::number(context.exec("down(100)")), 100.0);
+}
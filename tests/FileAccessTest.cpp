@@ -0,0 +1,99 @@
+#include "Test.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace eval;
+
+static void writeF64(const std::string &path, const std::vector<decimal_t> &values)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(decimal_t));
+}
+
+static bool exists(const std::string &path)
+{
+    return std::ifstream(path).good();
+}
+
+static void checkError(Context &context, const std::string &input, EvalErrCode code)
+{
+    auto ret = context.tryExec(input);
+    if (ret)
+        evaltest::fail(__FILE__, __LINE__, input + " did not fail");
+    if (ret.error().code != code)
+        evaltest::fail(__FILE__, __LINE__, input + ": " + ret.error().what());
+}
+
+TEST(file_builtins_are_disabled_by_default)
+{
+    writeF64("access.f64", {1, 2});
+    auto context = evaltest::makeContext();
+    CHECK(!context.fileAccess());
+    auto ret = context.tryExec("1 + len(load_f64(\"access.f64\"))");
+    CHECK(!ret);
+    CHECK_EQ(ret.error().code, EVAL_FILE_ACCESS_DENIED);
+    CHECK_EQ(ret.error().pos, size_t(16));
+
+    checkError(context, "load_json(\"access.json\")", EVAL_FILE_ACCESS_DENIED);
+    checkError(context, "load_csv(\"access.csv\", 0)", EVAL_FILE_ACCESS_DENIED);
+    checkError(context, "fold_csv(\"access.csv\", 0, @(a, x){a + x}, 0)", EVAL_FILE_ACCESS_DENIED);
+    checkError(context, "save_json(\"access.json\", [1])", EVAL_FILE_ACCESS_DENIED);
+    // through a lambda, and without evaluating the arguments
+    context.exec("dump(x) = save_json(\"access.json\", x)");
+    checkError(context, "dump([1, 2])", EVAL_FILE_ACCESS_DENIED);
+    CHECK(!exists("access.json"));
+    std::remove("access.f64");
+}
+
+TEST(file_access_is_not_inherited_from_definitions)
+{
+    auto context = evaltest::makeContext();
+    context.setFileAccess(true);
+    context.exec("f() = len(load_f64(\"access.f64\"))");
+    Context child(context.freeze());
+    child.init();
+    CHECK(!child.fileAccess());
+    checkError(child, "f()", EVAL_FILE_ACCESS_DENIED);
+}
+
+TEST(binary_arrays_are_lists)
+{
+    writeF64("values.f64", {1.5, -2, 4, 8});
+    auto context = evaltest::makeContext();
+    context.setFileAccess(true);
+    context.exec("x = load_f64(\"values.f64\")");
+    CHECK_EQ(evaltest::number(context.exec("len(x)")), decimal_t(4));
+    CHECK_EQ(evaltest::number(context.exec("x[1]")), decimal_t(-2));
+    auto v = context.exec("slice(x, 1, 3) * 2 + x[0]");
+    CHECK(evaltest::sameList(evaltest::list(v), {-2.5, 9.5}));
+    v = context.exec("x + x");
+    CHECK(evaltest::sameList(evaltest::list(v), {3, -4, 8, 16}));
+
+    // modifying copies the view, the file keeps its contents
+    context.exec("y = assign(x, 0, 100)");
+    v = context.exec("y");
+    CHECK(evaltest::sameList(evaltest::list(v), {100, -2, 4, 8}));
+    v = context.exec("x");
+    CHECK(evaltest::sameList(evaltest::list(v), {1.5, -2, 4, 8}));
+    v = context.exec("load_f64(\"values.f64\")");
+    CHECK(evaltest::sameList(evaltest::list(v), {1.5, -2, 4, 8}));
+    std::remove("values.f64");
+}
+
+TEST(binary_array_errors)
+{
+    auto context = evaltest::makeContext();
+    context.setFileAccess(true);
+    writeF64("empty.f64", {});
+    CHECK_EQ(evaltest::number(context.exec("len(load_f64(\"empty.f64\"))")), decimal_t(0));
+    {
+        std::ofstream out("odd.f64", std::ios::binary);
+        out << "123456789";
+    }
+    checkError(context, "load_f64(\"odd.f64\")", EVAL_FILE_MALFORMED);
+    checkError(context, "load_f64(\"missing.f64\")", EVAL_FILE_NOT_READABLE);
+    checkError(context, "load_f64(1)", EVAL_WRONG_PARAMETER_TYPE);
+    std::remove("empty.f64");
+    std::remove("odd.f64");
+}
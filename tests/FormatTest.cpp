@@ -0,0 +1,120 @@
+#include "Test.h"
+
+#include <evaluator/Format.h>
+#include <JsonParser.hpp>
+
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace eval;
+
+static std::string format(decimal_t d)
+{
+    std::string out;
+    appendDecimal(out, d);
+    return out;
+}
+
+TEST(decimals_use_the_shortest_form)
+{
+    CHECK_EQ(format(0), std::string("0"));
+    CHECK_EQ(format(-0.0), std::string("-0"));
+    CHECK_EQ(format(1), std::string("1"));
+    CHECK_EQ(format(0.1), std::string("0.1"));
+    CHECK_EQ(format(-2.5), std::string("-2.5"));
+    CHECK_EQ(format(1.0 / 3), std::string("0.3333333333333333"));
+    CHECK_EQ(format(1e300), std::string("1e+300"));
+    CHECK_EQ(format(std::numeric_limits<decimal_t>::quiet_NaN()), std::string("nan"));
+    CHECK_EQ(format(-std::numeric_limits<decimal_t>::infinity()), std::string("-inf"));
+}
+
+TEST(decimals_round_trip)
+{
+    const decimal_t extremes[] = {
+        std::numeric_limits<decimal_t>::min(),
+        std::numeric_limits<decimal_t>::max(),
+        std::numeric_limits<decimal_t>::lowest(),
+        std::numeric_limits<decimal_t>::denorm_min(),
+        -2.2250738585072014e-308,
+    };
+    for (auto d : extremes)
+    {
+        auto s = format(d);
+        CHECK(s.size() <= DECIMAL_CHARS_MAX);
+        CHECK_EQ(std::strtod(s.c_str(), nullptr), d);
+    }
+
+    std::mt19937_64 rng(40);
+    for (int i = 0; i < 100000; ++i)
+    {
+        uint64_t bits = rng();
+        decimal_t d;
+        std::memcpy(&d, &bits, sizeof(d));
+        if (std::isnan(d))
+            continue;
+        auto s = format(d);
+        CHECK(s.size() <= DECIMAL_CHARS_MAX);
+        CHECK_EQ(std::strtod(s.c_str(), nullptr), d);
+    }
+}
+
+TEST(lists_and_values)
+{
+    std::string out = "x = ";
+    appendList(out, ListType{});
+    CHECK_EQ(out, std::string("x = []"));
+
+    out.clear();
+    appendList(out, ListType{1, 0.5, -3e-20});
+    CHECK_EQ(out, std::string("[1, 0.5, -3e-20]"));
+
+    // the worst case reservation is trimmed again
+    ListType wide(1000, -2.2250738585072014e-308);
+    out.clear();
+    appendList(out, wide);
+    CHECK_EQ(out.size(), size_t(2 + 1000 * 24 + 999 * 2));
+
+    out.clear();
+    appendValue(out, DataType(VoidType{}));
+    CHECK_EQ(out, std::string(""));
+    appendValue(out, DataType(decimal_t(0.25)));
+    CHECK_EQ(out, std::string("0.25"));
+
+    auto context = evaltest::makeContext();
+    out.clear();
+    appendValue(out, context.exec("@(x, y){x + y}"));
+    CHECK_EQ(out, std::string("@(x, y){...}"));
+
+    out.clear();
+    appendError(out, EvalError{EVAL_INDEX_OUT_OF_RANGE, 4});
+    CHECK(out.size() > 5 && out.compare(out.size() - 5, 5, " at 4") == 0);
+    out.clear();
+    appendError(out, EvalError{EVAL_INDEX_OUT_OF_RANGE, EVAL_NO_POS});
+    CHECK(out.find(" at ") == std::string::npos);
+}
+
+TEST(formatting_ignores_the_locale)
+{
+    // only meaningful where a locale with a decimal comma is installed
+    if (std::setlocale(LC_NUMERIC, "de_DE.UTF-8") == nullptr && std::setlocale(LC_NUMERIC, "fr_FR.UTF-8") == nullptr)
+        return;
+    auto s = format(1.5);
+    auto json = JsonNode(1.5).toString();
+    std::setlocale(LC_NUMERIC, "C");
+    CHECK_EQ(s, std::string("1.5"));
+    CHECK_EQ(json, std::string("1.5"));
+}
+
+TEST(json_numbers_round_trip)
+{
+    JsonNode node({std::make_shared<JsonNode>(0.1), std::make_shared<JsonNode>(1.0 / 3), std::make_shared<JsonNode>(-1e-300)});
+    auto s = node.toString();
+    CHECK_EQ(s, std::string("[0.1, 0.3333333333333333, -1e-300]"));
+    JsonParser parser;
+    auto back = parser.parse(s);
+    CHECK(back[1] == 1.0 / 3);
+    CHECK(back[2] == -1e-300);
+}
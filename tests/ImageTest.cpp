@@ -0,0 +1,217 @@
+#include "Test.h"
+
+#include <evaluator/Image.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace eval;
+
+// record layouts of src/Image.cpp, version 1
+constexpr size_t HEADER_NODES = 56;
+constexpr size_t HEADER_VARS = 104;
+constexpr size_t NODE_SIZE = 32;
+constexpr size_t NODE_CHILD_COUNT = 12;
+constexpr size_t VAR_SIZE = 40;
+constexpr size_t VAR_COUNT = 16;
+constexpr size_t VAR_NODE = 24;
+constexpr uint8_t NODE_OPTR = 0;
+constexpr uint32_t VAR_LIST = 2;
+constexpr uint32_t VAR_LAMBDA = 3;
+
+static std::string imagePath()
+{
+    return "image-test-" + std::to_string(IMAGE_VERSION) + ".img";
+}
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string &path, const std::string &data)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+}
+
+template <typename T>
+static T load(const std::string &data, size_t offset)
+{
+    T v;
+    std::memcpy(&v, data.data() + offset, sizeof(T));
+    return v;
+}
+
+template <typename T>
+static void store(std::string &data, size_t offset, T v)
+{
+    std::memcpy(&data[offset], &v, sizeof(T));
+}
+
+// an image holding one lambda whose body is a single addition
+static std::string addImage()
+{
+    auto context = evaltest::makeContext();
+    context.exec("f(x) = x + 1");
+    context.saveDefinitions(imagePath());
+    return readFile(imagePath());
+}
+
+static void checkInvalid(const std::string &data)
+{
+    writeFile(imagePath(), data);
+    CHECK_THROWS(Context::loadDefinitions(imagePath()), EVAL_IMAGE_INVALID);
+}
+
+TEST(definitions_round_trip)
+{
+    writeFile(imagePath(), addImage());
+    Context context(Context::loadDefinitions(imagePath()));
+    CHECK_EQ(evaltest::number(context.exec("f(41)")), decimal_t(42));
+    std::remove(imagePath().c_str());
+}
+
+TEST(operators_need_their_children)
+{
+    auto data = addImage();
+    const uint64_t nodes = load<uint64_t>(data, HEADER_NODES);
+    const uint64_t count = load<uint64_t>(data, HEADER_NODES + 8);
+    size_t add = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t rec = nodes + i * NODE_SIZE;
+        if (uint8_t(data[rec]) == NODE_OPTR && uint8_t(data[rec + 1]) == static_cast<uint8_t>(OptrType::ADD))
+            add = rec;
+    }
+    CHECK(add != 0);
+
+    for (uint32_t children : {0u, 1u})
+    {
+        auto bad = data;
+        store<uint32_t>(bad, add + NODE_CHILD_COUNT, children);
+        checkInvalid(bad);
+    }
+
+    // a leaf turned into an operator that needs children
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t rec = nodes + i * NODE_SIZE;
+        if (load<uint32_t>(data, rec + NODE_CHILD_COUNT) != 0)
+            continue;
+        for (auto optr : {OptrType::NEG, OptrType::CALL, OptrType::LAMBDA, OptrType::STRING})
+        {
+            auto bad = data;
+            bad[rec] = static_cast<char>(NODE_OPTR);
+            bad[rec + 1] = static_cast<char>(optr);
+            checkInvalid(bad);
+        }
+    }
+    std::remove(imagePath().c_str());
+}
+
+TEST(lambdas_need_a_body)
+{
+    auto data = addImage();
+    const uint64_t vars = load<uint64_t>(data, HEADER_VARS);
+    const uint64_t count = load<uint64_t>(data, HEADER_VARS + 8);
+    size_t lambda = 0;
+    for (size_t i = 0; i < count; ++i)
+        if (load<uint32_t>(data, vars + i * VAR_SIZE + 4) == VAR_LAMBDA)
+            lambda = vars + i * VAR_SIZE;
+    CHECK(lambda != 0);
+
+    auto bad = data;
+    store<uint32_t>(bad, lambda + VAR_NODE, UINT32_MAX);
+    checkInvalid(bad);
+    std::remove(imagePath().c_str());
+}
+
+TEST(corrupted_images_fail_cleanly)
+{
+    auto context = evaltest::makeContext();
+    context.exec("g(x, y) = @(z){[x, -y, z][1] ^ 2}");
+    context.exec("h(n) = g(n, \"s\")(n * 2) / 3");
+    context.saveDefinitions(imagePath());
+    const auto data = readFile(imagePath());
+
+    // every single corrupted byte either loads into something that can be
+    // evaluated or is rejected as invalid
+    for (size_t i = 0; i < data.size(); ++i)
+        for (uint8_t v : {uint8_t(0), uint8_t(1), uint8_t(0xff)})
+        {
+            auto bad = data;
+            bad[i] = static_cast<char>(v);
+            writeFile(imagePath(), bad);
+            try
+            {
+                Context loaded(Context::loadDefinitions(imagePath()));
+                loaded.tryExec("h(2)");
+                loaded.tryExec("g(1, 2)(3)");
+            }
+            catch (const EvalExcept &e)
+            {
+                CHECK_EQ(e.error().code, EVAL_IMAGE_INVALID);
+            }
+        }
+
+    for (size_t size : {size_t(0), size_t(8), data.size() / 2, data.size() - 1})
+        checkInvalid(data.substr(0, size));
+    std::remove(imagePath().c_str());
+}
+
+TEST(snapshots_round_trip_lists)
+{
+    auto context = evaltest::makeContext();
+    context.exec("xs = [1, 2, 3.5]");
+    context.exec("f(x) = sum(xs) * x");
+    context.exec("f(2)");
+    context.saveSnapshot(imagePath());
+
+    Context restored;
+    restored.init();
+    restored.loadSnapshot(imagePath());
+    CHECK_EQ(evaltest::number(restored.exec("ans")), decimal_t(13));
+    auto xs = restored.exec("xs");
+    CHECK(evaltest::sameList(evaltest::list(xs), {1, 2, 3.5}));
+    CHECK_EQ(evaltest::number(restored.exec("f(1)")), decimal_t(6.5));
+    // the mapped block is copied on the first modification
+    restored.exec("xs = assign(xs, 0, 10)");
+    xs = restored.exec("xs");
+    CHECK(evaltest::sameList(evaltest::list(xs), {10, 2, 3.5}));
+    std::remove(imagePath().c_str());
+}
+
+TEST(invalid_snapshots_keep_the_variables)
+{
+    auto context = evaltest::makeContext();
+    context.exec("xs = [1, 2]");
+    context.exec("f(x) = x + 1");
+    context.saveSnapshot(imagePath());
+    auto data = readFile(imagePath());
+
+    const uint64_t vars = load<uint64_t>(data, HEADER_VARS);
+    const uint64_t count = load<uint64_t>(data, HEADER_VARS + 8);
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t rec = vars + i * VAR_SIZE;
+        auto bad = data;
+        if (load<uint32_t>(data, rec + 4) == VAR_LAMBDA)
+            store<uint32_t>(bad, rec + VAR_NODE, UINT32_MAX);
+        else if (load<uint32_t>(data, rec + 4) == VAR_LIST)
+            store<uint64_t>(bad, rec + VAR_COUNT, data.size());
+        else
+            continue;
+        writeFile(imagePath(), bad);
+
+        Context target;
+        target.init();
+        target.exec("y = 5");
+        CHECK_THROWS(target.loadSnapshot(imagePath()), EVAL_IMAGE_INVALID);
+        CHECK_EQ(evaltest::number(target.exec("y")), decimal_t(5));
+    }
+    std::remove(imagePath().c_str());
+}
@@ -0,0 +1,121 @@
+#include "Test.h"
+
+#include <evaluator/DataIO.h>
+#include <JsonParser.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+using namespace eval;
+
+static void writeFile(const std::string &path, const std::string &data)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << data;
+}
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+TEST(number_arrays_parse_without_nodes)
+{
+    std::vector<decimal_t> out;
+    JsonParser().parseNumberArray(" [1, -2.5e3,\n0.1 ,null,\t-0] ", out);
+    CHECK_EQ(out.size(), size_t(5));
+    CHECK_EQ(out[0], decimal_t(1));
+    CHECK_EQ(out[1], decimal_t(-2500));
+    CHECK_EQ(out[2], decimal_t(0.1));
+    CHECK(std::isnan(out[3]));
+    CHECK(std::signbit(out[4]));
+
+    out.clear();
+    JsonParser().parseNumberArray("[]", out);
+    CHECK(out.empty());
+}
+
+TEST(malformed_number_arrays_throw)
+{
+    const char *inputs[] = {
+        "",
+        "   ",
+        "{}",
+        "[1, 2",
+        "[1, 2,]",
+        "[1 2]",
+        "[1, [2]]",
+        "[\"1\"]",
+        "[nul]",
+        "[01]",
+        "[1.]",
+        "[+1]",
+        "[1e400]",
+        "[1] [2]",
+    };
+    for (auto input : inputs)
+    {
+        std::vector<decimal_t> out;
+        bool thrown = false;
+        try
+        {
+            JsonParser().parseNumberArray(input, out);
+        }
+        catch (const JsonParseExcept &)
+        {
+            thrown = true;
+        }
+        if (!thrown)
+            evaltest::fail(__FILE__, __LINE__, std::string(input) + " was accepted");
+    }
+}
+
+TEST(json_files_round_trip)
+{
+    const auto nan = std::numeric_limits<decimal_t>::quiet_NaN();
+    const auto inf = std::numeric_limits<decimal_t>::infinity();
+    saveJson("round.json", ListType{0.1, -1e-300, 1.0 / 3, nan, inf});
+    CHECK_EQ(readFile("round.json"), std::string("[0.1, -1e-300, 0.3333333333333333, null, null]\n"));
+
+    auto back = loadJson("round.json");
+    CHECK_EQ(back.size(), size_t(5));
+    CHECK_EQ(back[1], decimal_t(-1e-300));
+    CHECK_EQ(back[2], decimal_t(1.0 / 3));
+    CHECK(std::isnan(back[3]) && std::isnan(back[4]));
+
+    // larger than the write buffer
+    ListType big(100000);
+    for (size_t i = 0; i < big.size(); ++i)
+        big[i] = static_cast<decimal_t>(i) / 7;
+    saveJson("round.json", big);
+    back = loadJson("round.json");
+    CHECK_EQ(back.size(), big.size());
+    CHECK(std::equal(back.begin(), back.end(), big.begin()));
+
+    saveJson("round.json", ListType{});
+    CHECK_EQ(loadJson("round.json").size(), size_t(0));
+    std::remove("round.json");
+}
+
+TEST(json_builtins)
+{
+    auto context = evaltest::makeContext();
+    context.setFileAccess(true);
+    CHECK_EQ(evaltest::number(context.exec("save_json(\"builtin.json\", [1, 2, 3] * 2)")), decimal_t(3));
+    auto v = context.exec("load_json(\"builtin.json\") + 1");
+    CHECK(evaltest::sameList(evaltest::list(v), {3, 5, 7}));
+
+    writeFile("builtin.json", "[1, 2,");
+    auto ret = context.tryExec("load_json(\"builtin.json\")");
+    CHECK(!ret && ret.error().code == EVAL_FILE_MALFORMED);
+    ret = context.tryExec("load_json(\"missing.json\")");
+    CHECK(!ret && ret.error().code == EVAL_FILE_NOT_READABLE);
+    ret = context.tryExec("save_json(\"/nonexistent-eval-dir/out.json\", [1])");
+    CHECK(!ret && ret.error().code == EVAL_FILE_NOT_WRITABLE);
+    ret = context.tryExec("save_json(\"builtin.json\", 1)");
+    CHECK(!ret && ret.error().code == EVAL_WRONG_PARAMETER_TYPE);
+    std::remove("builtin.json");
+}
@@ -0,0 +1,94 @@
+#include "Test.h"
+
+#include <evaluator/AST.h>
+#include <evaluator/Memory.h>
+
+using namespace eval;
+
+TEST(lists_count_their_capacity)
+{
+    auto context = evaltest::makeContext();
+    const auto before = context.memoryStats().live;
+    context.exec("xs = [1, 2, 3, 4]");
+    auto live = context.memoryStats().live;
+    CHECK_EQ(live.lists - before.lists, size_t(1));
+    CHECK(live.listBytes - before.listBytes >= 4 * sizeof(decimal_t));
+    context.exec("xs = 0");
+    CHECK_EQ(context.memoryStats().live.listBytes, before.listBytes);
+}
+
+TEST(ast_nodes_include_allocation_overhead)
+{
+    auto context = evaltest::makeContext();
+    context.exec("f(x) = x + 1");
+    auto live = context.memoryStats().live;
+    CHECK_EQ(live.astNodes, size_t(3));
+    // node, control block with vtable pointer and counts, and child arrays
+    CHECK(live.astBytes >= 3 * (sizeof(ASTNode) + sizeof(void *) + 2 * sizeof(int)) +
+                               2 * sizeof(std::shared_ptr<ASTNode>));
+}
+
+TEST(shared_ast_is_counted_once)
+{
+    auto context = evaltest::makeContext();
+    context.exec("f(x) = x * x + 2 * x + 1");
+    const auto one = context.memoryStats().live;
+    context.exec("g = f");
+    context.exec("h = f");
+    auto three = context.memoryStats().live;
+    CHECK_EQ(three.astNodes, one.astNodes);
+    CHECK_EQ(three.astBytes, one.astBytes);
+    CHECK_EQ(three.lambdas, one.lambdas + 2);
+
+    // the body stays counted until its last owner is gone
+    context.exec("f = 0");
+    context.exec("g = 0");
+    CHECK_EQ(context.memoryStats().live.astBytes, one.astBytes);
+    context.exec("h = 0");
+    auto none = context.memoryStats().live;
+    CHECK_EQ(none.astNodes, size_t(0));
+    CHECK_EQ(none.astBytes, size_t(0));
+}
+
+TEST(reassigning_the_same_lambda_is_stable)
+{
+    auto context = evaltest::makeContext();
+    context.exec("f(x) = x + 1");
+    const auto before = context.memoryStats().live;
+    context.exec("f = f");
+    auto after = context.memoryStats().live;
+    CHECK_EQ(after.astNodes, before.astNodes);
+    CHECK_EQ(after.totalBytes(), before.totalBytes());
+}
+
+TEST(shared_subtrees_within_one_value)
+{
+    auto leaf = std::make_shared<ASTNode>(decimal_t(1));
+    ASTNode root(OptrType::ADD);
+    root.children = {leaf, leaf};
+
+    MemoryUsage usage;
+    ASTRefs refs;
+    usage.addAST(root, refs);
+    CHECK_EQ(usage.astNodes, size_t(2));
+
+    MemoryUsage freed;
+    freed.releaseAST(root, refs);
+    CHECK_EQ(freed.astNodes, size_t(2));
+    CHECK_EQ(freed.astBytes, usage.astBytes);
+    CHECK(refs.empty());
+}
+
+TEST(peak_and_largest_variables)
+{
+    auto context = evaltest::makeContext();
+    context.exec("big = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16]");
+    context.exec("small = [1]");
+    const auto peak = context.memoryStats().peakBytes;
+    context.exec("big = 0");
+    auto stats = context.memoryStats(1);
+    CHECK_EQ(stats.peakBytes, peak);
+    CHECK(stats.live.totalBytes() < peak);
+    CHECK_EQ(stats.largestVars.size(), size_t(1));
+    CHECK_EQ(stats.largestVars[0].first, std::string("small"));
+}
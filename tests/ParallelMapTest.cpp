@@ -0,0 +1,119 @@
+#include "Test.h"
+
+#include <evaluator/Scheduler.h>
+
+using namespace eval;
+
+static std::string listLiteral(size_t n)
+{
+    std::string s = "[";
+    for (size_t i = 0; i < n; ++i)
+        s += (i ? ", " : "") + std::to_string(i % 97) + "." + std::to_string(i % 10);
+    return s + "]";
+}
+
+static bool identical(const ListType &a, const ListType &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (!evaltest::same(a[i], b[i]))
+            return false;
+    return true;
+}
+
+TEST(pmap_matches_serial_order)
+{
+    const char *fs[] = {"@(x){x * x - 3}", "@(x){sqrt(x) / (x + 1)}", "g"};
+    for (size_t n : {0, 1, 15, 16, 17, 1000})
+        for (auto f : fs)
+        {
+            auto serial = evaltest::makeContext();
+            serial.exec("g(x) = if_else(gt(x, 50), x - k, k)");
+            serial.exec("k = 7");
+            serial.exec("xs = " + listLiteral(n));
+            const auto expected = evaltest::list(serial.exec(std::string("pmap(xs, ") + f + ")"));
+            CHECK_EQ(expected.size(), n);
+
+            for (size_t threads : {1, 3})
+            {
+                TaskScheduler scheduler(threads);
+                auto context = evaltest::makeContext();
+                context.setParallelEval(&scheduler);
+                context.setParallelMapThreshold(16);
+                context.exec("g(x) = if_else(gt(x, 50), x - k, k)");
+                context.exec("k = 7");
+                context.exec("xs = " + listLiteral(n));
+                auto got = context.exec(std::string("pmap(xs, ") + f + ")");
+                CHECK(identical(evaltest::list(got), expected));
+            }
+        }
+}
+
+TEST(preduce_combines_chunks_in_order)
+{
+    for (size_t n : {0, 1, 2, 16, 33, 1000})
+    {
+        auto serial = evaltest::makeContext();
+        serial.exec("xs = " + listLiteral(n));
+        const auto expected = evaltest::number(serial.exec("preduce(xs, @(a, b){a + b}, 0)"));
+
+        TaskScheduler scheduler(3);
+        auto context = evaltest::makeContext();
+        context.setParallelEval(&scheduler);
+        context.setParallelMapThreshold(16);
+        context.exec("xs = " + listLiteral(n));
+        const auto first = evaltest::number(context.exec("preduce(xs, @(a, b){a + b}, 0, @(a, b){a + b})"));
+        CHECK(evaltest::near(first, expected));
+        // chunking only depends on the length, the rounding is repeatable
+        for (int rep = 0; rep < 5; ++rep)
+            CHECK_EQ(evaltest::number(context.exec("preduce(xs, @(a, b){a + b}, 0, @(a, b){a + b})")), first);
+    }
+    auto context = evaltest::makeContext();
+    CHECK_EQ(evaltest::number(context.exec("preduce([], @(a, b){a + b}, 5)")), 5.0);
+    CHECK_EQ(evaltest::number(context.exec("preduce([2, 3, 4], @(a, b){a * b}, 1)")), 24.0);
+}
+
+TEST(preduce_matches_the_serial_fold)
+{
+    const char *folds[] = {
+        "preduce(xs, @(s, x){s + x * 2}, 0)",
+        "preduce(xs, @(s, x){s + x * 2}, 0, @(a, b){a + b})",
+        "preduce(xs, @(s, x){s + 1}, 3)",
+    };
+    const decimal_t expected[] = {10000, 10000, 5003};
+
+    std::string ones = "xs = [1";
+    for (int i = 1; i < 5000; ++i)
+        ones += ", 1";
+    ones += "]";
+
+    auto serial = evaltest::makeContext({ones.c_str()});
+    TaskScheduler scheduler(3);
+    auto parallel = evaltest::makeContext({ones.c_str()});
+    parallel.setParallelEval(&scheduler);
+    parallel.setParallelMapThreshold(16);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        CHECK_EQ(evaltest::number(serial.exec(folds[i])), expected[i]);
+        CHECK_EQ(evaltest::number(parallel.exec(folds[i])), expected[i]);
+    }
+}
+
+TEST(pmap_errors)
+{
+    TaskScheduler scheduler(2);
+    auto context = evaltest::makeContext();
+    context.setParallelEval(&scheduler);
+    context.setParallelMapThreshold(4);
+    context.exec("xs = " + listLiteral(100));
+    CHECK_THROWS(context.exec("pmap(xs, @(x){[x]})"), EVAL_LIST_MEMBER_NOT_DECIMAL);
+    CHECK_THROWS(context.exec("pmap(3, @(x){x})"), EVAL_WRONG_PARAMETER_TYPE);
+    CHECK_THROWS(context.exec("pmap(xs, 3)"), EVAL_OBJECT_NOT_CALLABLE);
+    CHECK_THROWS(context.exec("pmap(xs)"), EVAL_WRONG_NUMBER_OF_PARAMETERS);
+    CHECK_THROWS(context.exec("preduce(xs, @(a, b){a + b})"), EVAL_WRONG_NUMBER_OF_PARAMETERS);
+    CHECK_THROWS(context.exec("preduce(xs, @(a, b){a + b}, 0, 1)"), EVAL_OBJECT_NOT_CALLABLE);
+    // the context stays usable after a failed parallel run
+    auto after = context.exec("pmap([1, 2], @(x){x + 1})");
+    CHECK(evaltest::sameList(evaltest::list(after), {2, 3}));
+}
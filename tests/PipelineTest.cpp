@@ -0,0 +1,119 @@
+#include "Test.h"
+
+#include "Pipeline.h"
+
+#include <evaluator/Format.h>
+
+#ifndef _WIN32
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <unistd.h>
+
+using namespace eval;
+
+struct Output
+{
+    int ret;
+    std::string out;
+    std::string err;
+};
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// runs the pipeline with stdout and stderr redirected to files
+static Output run(const std::string &input, const std::string &expr, const std::vector<std::string> &vars,
+                  size_t workers, std::shared_ptr<const Definitions> definitions = nullptr)
+{
+    const std::string outPath = "pipeline-out.txt", errPath = "pipeline-err.txt";
+    std::fflush(stdout);
+    std::fflush(stderr);
+    int savedOut = dup(1), savedErr = dup(2);
+    int outFd = open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int errFd = open(errPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(outFd, 1);
+    dup2(errFd, 2);
+
+    std::istringstream in(input);
+    Output ret{pipeline(in, expr, vars, workers, std::move(definitions)), "", ""};
+
+    std::fflush(stdout);
+    std::fflush(stderr);
+    dup2(savedOut, 1);
+    dup2(savedErr, 2);
+    for (int fd : {savedOut, savedErr, outFd, errFd})
+        close(fd);
+    ret.out = readFile(outPath);
+    ret.err = readFile(errPath);
+    std::remove(outPath.c_str());
+    std::remove(errPath.c_str());
+    return ret;
+}
+
+TEST(compiled_records_keep_their_order)
+{
+    // several batches per worker
+    const size_t n = 10 * PIPELINE_BATCH_ROWS + 7;
+    std::string input, expected;
+    for (size_t i = 0; i < n; ++i)
+    {
+        input += std::to_string(i) + ", " + std::to_string(i % 13) + "\n";
+        appendDecimal(expected, decimal_t(i) * 2 - decimal_t(i % 13));
+        expected += '\n';
+    }
+    for (size_t workers : {1, 4})
+    {
+        auto ret = run(input, "x * 2 - y", {"x", "y"}, workers);
+        CHECK_EQ(ret.ret, 0);
+        CHECK(ret.out == expected);
+        CHECK_EQ(ret.err, std::string(""));
+    }
+}
+
+TEST(interpreted_expressions_and_definitions)
+{
+    auto context = evaltest::makeContext();
+    context.exec("scale(v) = [v, v * 10]");
+    auto ret = run("1\n\n2.5\n", "scale(x)", {"x"}, 2, context.freeze());
+    CHECK_EQ(ret.ret, 0);
+    CHECK_EQ(ret.out, std::string("[1, 10]\n[2.5, 25]\n"));
+}
+
+TEST(bad_records_are_reported_in_place)
+{
+    auto ret = run("1 2\n3\n4 x\n5 6 7\n8,9\n", "x + y", {"x", "y"}, 2);
+    CHECK_EQ(ret.ret, 1);
+    CHECK_EQ(ret.out, std::string("3\n\n\n\n17\n"));
+    CHECK(ret.err.find("line 2: ") != std::string::npos);
+    CHECK(ret.err.find("line 3: ") != std::string::npos);
+    CHECK(ret.err.find("line 4: ") != std::string::npos);
+    CHECK(ret.err.find("line 1: ") == std::string::npos);
+
+    // runtime errors of interpreted expressions
+    ret = run("0\n1\n", "[1, 2][x * 5]", {"x"}, 1);
+    CHECK_EQ(ret.ret, 1);
+    CHECK_EQ(ret.out, std::string("1\n\n"));
+    CHECK(ret.err.find("line 2: runtime error: index out of range") != std::string::npos);
+}
+
+TEST(expressions_cannot_touch_files)
+{
+    auto ret = run("1\n", "x + len(load_f64(\"/etc/passwd\"))", {"x"}, 1);
+    CHECK_EQ(ret.ret, 1);
+    CHECK(ret.err.find("file access disabled") != std::string::npos);
+}
+
+TEST(invalid_expressions_fail_before_reading)
+{
+    auto ret = run("1\n", "x +", {"x"}, 1);
+    CHECK_EQ(ret.ret, 2);
+    CHECK_EQ(ret.out, std::string(""));
+    CHECK(ret.err.rfind("pipeline: ", 0) == 0);
+}
+#endif
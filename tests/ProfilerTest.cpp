@@ -0,0 +1,86 @@
+#include "Test.h"
+
+#include <evaluator/Profiler.h>
+
+using namespace eval;
+
+static const JsonNode &entry(const JsonNode &profile, const char *section, const char *name)
+{
+    return profile[section][name];
+}
+
+static bool has(const JsonNode &profile, const char *section, const char *name)
+{
+    auto obj = profile[section].getObj();
+    return obj.find(name) != obj.end();
+}
+
+TEST(profiling_is_off_by_default)
+{
+    auto context = evaltest::makeContext();
+    CHECK(context.profiler() == nullptr);
+    context.exec("1 + 2");
+    context.setProfiling(true);
+    CHECK(context.profiler() != nullptr);
+    context.setProfiling(false);
+    CHECK(context.profiler() == nullptr);
+}
+
+TEST(profile_counts_lambdas_and_builtins)
+{
+    auto context = evaltest::makeContext();
+    context.exec(evaltest::FIB);
+    context.setProfiling(true);
+    CHECK_EQ(evaltest::number(context.exec("fib(10)")), 89.0);
+    auto profile = context.profiler()->toJson();
+
+    // fib(n) makes 2 * fib(n) - 1 calls
+    CHECK_EQ(entry(profile, "lambdas", "fib")["calls"].getNum(), 177.0);
+    CHECK_EQ(entry(profile, "builtins", "if_else")["calls"].getNum(), 177.0);
+    CHECK_EQ(entry(profile, "builtins", "gt")["calls"].getNum(), 177.0);
+    CHECK(entry(profile, "optrs", "CALL")["calls"].getNum() >= 177.0 * 3);
+    CHECK(has(profile, "optrs", "ADD"));
+    CHECK(!has(profile, "builtins", "sin"));
+
+    auto &fib = entry(profile, "lambdas", "fib");
+    CHECK(fib["self_ns"].getNum() <= fib["total_ns"].getNum());
+    CHECK(fib["total_ns"].getNum() > 0);
+}
+
+TEST(profile_counts_list_bytes)
+{
+    auto context = evaltest::makeContext();
+    context.setProfiling(true);
+    context.exec("reverse([1, 2, 3, 4, 5, 6, 7, 8])");
+    auto profile = context.profiler()->toJson();
+    CHECK(entry(profile, "builtins", "reverse")["list_bytes"].getNum() >= 8.0 * sizeof(decimal_t));
+    CHECK(entry(profile, "optrs", "LIST")["list_bytes"].getNum() >= 8.0 * sizeof(decimal_t));
+}
+
+TEST(profile_clear_and_report)
+{
+    auto context = evaltest::makeContext();
+    context.setProfiling(true);
+    context.exec("sin(1) + @(x){x * 2}(3)");
+    auto profile = context.profiler()->toJson();
+    CHECK_EQ(entry(profile, "builtins", "sin")["calls"].getNum(), 1.0);
+    CHECK_EQ(entry(profile, "lambdas", "<lambda>")["calls"].getNum(), 1.0);
+    auto report = context.profiler()->report();
+    CHECK(report.find("builtins") != std::string::npos);
+    CHECK(report.find("sin") != std::string::npos);
+
+    context.profiler()->clear();
+    profile = context.profiler()->toJson();
+    CHECK(profile["optrs"].getObj().empty());
+    CHECK(profile["builtins"].getObj().empty());
+    CHECK(profile["lambdas"].getObj().empty());
+}
+
+TEST(failed_evaluations_are_profiled)
+{
+    auto context = evaltest::makeContext();
+    context.setProfiling(true);
+    CHECK(!context.tryExec("1 + undefined_name"));
+    auto profile = context.profiler()->toJson();
+    CHECK_EQ(entry(profile, "optrs", "ADD")["calls"].getNum(), 1.0);
+}
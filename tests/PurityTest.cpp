@@ -0,0 +1,70 @@
+#include "Test.h"
+
+#include <evaluator/SharedDefinitions.h>
+
+using namespace eval;
+
+static bool pure(const Context &context, const std::string &input)
+{
+    auto tokens = tryTokenize(input);
+    if (!tokens)
+        evaltest::fail(__FILE__, __LINE__, input + ": " + tokens.error().what());
+    Parser parser;
+    auto ast = parser.tryParse(*tokens);
+    if (!ast)
+        evaltest::fail(__FILE__, __LINE__, input + ": " + ast.error().what());
+    return context.isPure(**ast);
+}
+
+TEST(assignments_are_impure)
+{
+    auto context = evaltest::makeContext();
+    CHECK(pure(context, "1 + 2"));
+    CHECK(!pure(context, "x = 1"));
+    CHECK(!pure(context, "f(x) = x"));
+}
+
+TEST(side_effecting_builtins_are_impure)
+{
+    auto context = evaltest::makeContext();
+    CHECK(pure(context, "sum([1, 2]) + sin(1)"));
+    CHECK(!pure(context, "save_json(\"out.json\", [1])"));
+    CHECK(!pure(context, "len(load_csv(\"in.csv\", \"a\"))"));
+    CHECK(!pure(context, "pmap([1], @(x){save_json(\"out.json\", [x])})"));
+    // naming the builtin in a string does not call it
+    CHECK(pure(context, "len(\"save_json\")"));
+}
+
+TEST(impure_lambdas_taint_their_callers)
+{
+    auto context = evaltest::makeContext();
+    context.exec("f(x) = save_json(\"out.json\", [x])");
+    context.exec("g(x) = f(x) + 1");
+    context.exec("h(x) = x * 2");
+    context.exec("r(x) = if_else(gt(x, 0), r(x - 1), 0)");
+    CHECK(!pure(context, "f(1)"));
+    CHECK(!pure(context, "g(1)"));
+    CHECK(!pure(context, "pmap([1, 2], g)"));
+    CHECK(pure(context, "h(1) + pmap([1, 2], h)[0]"));
+    // recursion terminates
+    CHECK(pure(context, "r(3)"));
+}
+
+TEST(redefinitions_update_purity)
+{
+    auto context = evaltest::makeContext({"h(x) = x * 2"});
+    CHECK(pure(context, "h(1)"));
+    context.exec("h(x) = save_json(\"out.json\", [x])");
+    CHECK(!pure(context, "h(1)"));
+    context.exec("h = 3");
+    CHECK(pure(context, "h(1)"));
+
+    SharedDefinitions shared;
+    shared.define("k(x) = x + 1");
+    Context reader(shared);
+    reader.init();
+    CHECK(pure(reader, "k(1)"));
+    shared.define("k(x) = save_json(\"out.json\", [x])");
+    reader.exec("0");
+    CHECK(!pure(reader, "k(1)"));
+}
@@ -0,0 +1,131 @@
+#include "Test.h"
+
+#include <evaluator/Reduce.h>
+#include <evaluator/Scheduler.h>
+
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace eval;
+
+static const decimal_t NaN = std::numeric_limits<decimal_t>::quiet_NaN();
+
+static bool identical(decimal_t a, decimal_t b)
+{
+    return std::memcmp(&a, &b, sizeof(a)) == 0 || (std::isnan(a) && std::isnan(b));
+}
+
+static ListType randomList(size_t n, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<decimal_t> value(-1, 1);
+    ListType l(n);
+    for (size_t i = 0; i < n; ++i)
+        l[i] = value(rng) * std::pow(10.0, static_cast<int>(rng() % 9) - 4);
+    return l;
+}
+
+TEST(empty_lists)
+{
+    ListType empty;
+    CHECK_EQ(listSum(empty), decimal_t(0));
+    CHECK_EQ(listProd(empty), decimal_t(1));
+    CHECK(std::isnan(listMin(empty)));
+    CHECK(std::isnan(listMax(empty)));
+    CHECK(std::isnan(listMean(empty)));
+    CHECK(std::isnan(listVariance(empty)));
+    CHECK_EQ(listNorm(empty), decimal_t(0));
+    CHECK_EQ(listDot(empty, empty), decimal_t(0));
+    CHECK(std::isnan(listVariance(ListType{3})));
+}
+
+TEST(short_lists_match_a_plain_loop)
+{
+    // shorter than, equal to and just past one group of lanes
+    for (size_t n = 1; n <= 2 * REDUCE_LANES + 1; ++n)
+    {
+        ListType l(n);
+        decimal_t sum = 0, prod = 1, mn = 1e300, mx = -1e300, sq = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            l[i] = static_cast<decimal_t>((i * 7) % 5) - 1.5;
+            sum += l[i];
+            prod *= l[i];
+            mn = std::min(mn, l[i]);
+            mx = std::max(mx, l[i]);
+            sq += l[i] * l[i];
+        }
+        CHECK_EQ(listSum(l), sum);
+        CHECK(evaltest::near(listProd(l), prod));
+        CHECK_EQ(listMin(l), mn);
+        CHECK_EQ(listMax(l), mx);
+        CHECK(evaltest::near(listMean(l), sum / n));
+        CHECK(evaltest::near(listNorm(l), std::sqrt(sq)));
+        CHECK(evaltest::near(listDot(l, l), sq));
+        if (n > 1)
+            CHECK(evaltest::near(listVariance(l), (sq - sum * sum / n) / (n - 1)));
+    }
+}
+
+TEST(nan_propagates)
+{
+    for (size_t n : {size_t(3), REDUCE_LANES + 3, 3 * REDUCE_BLOCK_SIZE})
+        for (size_t at : {size_t(0), n / 2, n - 1})
+        {
+            ListType l(n, 1);
+            l[at] = NaN;
+            CHECK(std::isnan(listSum(l)));
+            CHECK(std::isnan(listProd(l)));
+            CHECK(std::isnan(listMin(l)));
+            CHECK(std::isnan(listMax(l)));
+            CHECK(std::isnan(listVariance(l)));
+            CHECK(std::isnan(listNorm(l)));
+        }
+}
+
+TEST(sums_are_compensated)
+{
+    // 1e16 + 1 + ... + 1 - 1e16 loses every 1 without compensation
+    ListType l(1001, 1);
+    l[0] = 1e16;
+    l.push_back(-1e16);
+    CHECK_EQ(listSum(l), decimal_t(1000));
+
+    auto r = randomList(300000, 3);
+    long double exact = 0;
+    for (auto v : r)
+        exact += v;
+    CHECK(evaltest::near(listSum(r), static_cast<decimal_t>(exact), 1e-14));
+}
+
+TEST(results_do_not_depend_on_threads)
+{
+    auto a = randomList(5 * REDUCE_PARALLEL_THRESHOLD + 123, 49);
+    auto b = randomList(a.size(), 50);
+    const decimal_t serial[] = {listSum(a), listProd(a), listMin(a), listMax(a), listMean(a),
+                                listVariance(a), listNorm(a), listDot(a, b)};
+    for (size_t threads : {1, 2, 3, 8})
+    {
+        TaskScheduler scheduler(threads);
+        const decimal_t parallel[] = {listSum(a, &scheduler), listProd(a, &scheduler), listMin(a, &scheduler),
+                                      listMax(a, &scheduler), listMean(a, &scheduler), listVariance(a, &scheduler),
+                                      listNorm(a, &scheduler), listDot(a, b, &scheduler)};
+        for (size_t i = 0; i < sizeof(serial) / sizeof(serial[0]); ++i)
+            CHECK(identical(serial[i], parallel[i]));
+    }
+}
+
+TEST(reduction_builtins)
+{
+    auto context = evaltest::makeContext();
+    CHECK_EQ(evaltest::number(context.exec("sum([1, 2, 3]) + prod([2, 5])")), decimal_t(16));
+    CHECK_EQ(evaltest::number(context.exec("dot([1, 2], [3, 4]) - norm([3, 4])")), decimal_t(6));
+    CHECK_EQ(evaltest::number(context.exec("variance([1, 2, 3, 4]) * 3")), decimal_t(5));
+    auto ret = context.tryExec("dot([1, 2], [3])");
+    CHECK(!ret && ret.error().code == EVAL_DIFFERENT_LIST_LENGTHS);
+    ret = context.tryExec("sum(1)");
+    CHECK(!ret && ret.error().code == EVAL_WRONG_PARAMETER_TYPE);
+    ret = context.tryExec("min()");
+    CHECK(!ret && ret.error().code == EVAL_WRONG_NUMBER_OF_PARAMETERS);
+}
@@ -0,0 +1,144 @@
+#include "Test.h"
+
+#include <evaluator/Rolling.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+using namespace eval;
+
+static const decimal_t NaN = std::numeric_limits<decimal_t>::quiet_NaN();
+static const decimal_t Inf = std::numeric_limits<decimal_t>::infinity();
+
+// what each window gives when aggregated from scratch
+static decimal_t direct(RollingOp op, const decimal_t *w, size_t n)
+{
+    decimal_t sum = 0;
+    for (size_t i = 0; i < n; ++i)
+        sum += w[i];
+    decimal_t mean = sum / n, m2 = 0;
+    for (size_t i = 0; i < n; ++i)
+        m2 += (w[i] - mean) * (w[i] - mean);
+    bool hasNan = std::any_of(w, w + n, [](decimal_t v)
+                              { return std::isnan(v); });
+    switch (op)
+    {
+    case RollingOp::SUM:
+        return sum;
+    case RollingOp::MEAN:
+        return mean;
+    case RollingOp::VAR:
+        return m2 / (n - 1);
+    case RollingOp::STD:
+        return std::sqrt(m2 / (n - 1));
+    case RollingOp::MIN:
+        return hasNan ? NaN : *std::min_element(w, w + n);
+    case RollingOp::MAX:
+        return hasNan ? NaN : *std::max_element(w, w + n);
+    }
+    return NaN;
+}
+
+static ListType roll(RollingOp op, size_t window, const std::vector<decimal_t> &xs, size_t chunk)
+{
+    RollingWindow rolling(op, window);
+    ListType out;
+    for (size_t i = 0; i < xs.size(); i += chunk)
+        rolling.push(xs.data() + i, std::min(chunk, xs.size() - i), out);
+    return out;
+}
+
+// running variances lose digits when the mean is large next to the spread
+static bool close(RollingOp op, decimal_t a, decimal_t b)
+{
+    if (std::isnan(a) || std::isnan(b) || std::isinf(a) || std::isinf(b))
+        return evaltest::same(a, b);
+    return evaltest::near(a, b, op == RollingOp::VAR || op == RollingOp::STD ? 1e-6 : 1e-9);
+}
+
+TEST(non_finite_values_leave_the_window)
+{
+    auto context = evaltest::makeContext();
+    auto v = context.exec("rolling_sum([1, 0/0, 5, 6, 7], 2)");
+    CHECK(evaltest::sameList(evaltest::list(v), {NaN, NaN, 11, 13}));
+    v = context.exec("rolling_mean([1, 1/0, 5, -1/0, 7, 1], 2)");
+    CHECK(evaltest::sameList(evaltest::list(v), {Inf, Inf, -Inf, -Inf, 4}));
+    v = context.exec("rolling_sum([1/0, -1/0, 2, 3], 2)");
+    CHECK(evaltest::sameList(evaltest::list(v), {NaN, -Inf, 5}));
+    v = context.exec("rolling_var([1, 0/0, 1/0, 5, 7, 9], 2)");
+    CHECK(evaltest::sameList(evaltest::list(v), {NaN, NaN, NaN, 2, 2}));
+    v = context.exec("rolling_min([3, 0/0, 5, 4, -1/0, 6], 2)");
+    CHECK(evaltest::sameList(evaltest::list(v), {NaN, NaN, 4, -Inf, -Inf}));
+    v = context.exec("rolling_max([0/0, 0/0, 2, 1], 2)");
+    CHECK(evaltest::sameList(evaltest::list(v), {NaN, NaN, 2}));
+}
+
+TEST(matches_direct_computation)
+{
+    std::mt19937_64 rng(48);
+    std::uniform_real_distribution<decimal_t> value(-1e3, 1e3);
+    std::vector<decimal_t> xs(2000);
+    for (size_t i = 0; i < xs.size(); ++i)
+    {
+        auto r = rng() % 100;
+        xs[i] = r == 0 ? NaN : r == 1 ? Inf : r == 2 ? -Inf : value(rng);
+    }
+    // a long finite stretch after the non-finite values
+    for (size_t i = 1000; i < xs.size(); ++i)
+        if (!std::isfinite(xs[i]))
+            xs[i] = value(rng);
+
+    for (auto op : {RollingOp::SUM, RollingOp::MEAN, RollingOp::MIN, RollingOp::MAX, RollingOp::VAR, RollingOp::STD})
+        for (size_t window : {2, 3, 17, 256})
+        {
+            auto out = roll(op, window, xs, xs.size());
+            CHECK_EQ(out.size(), xs.size() - window + 1);
+            for (size_t i = 0; i < out.size(); ++i)
+                if (!close(op, out[i], direct(op, xs.data() + i, window)))
+                {
+                    evaltest::fail(__FILE__, __LINE__, "op " + evaltest::show(static_cast<int>(op)) + " window " + evaltest::show(window) + " at " + evaltest::show(i) +
+                                                           ": " + evaltest::show(out[i]) + " vs " +
+                                                           evaltest::show(direct(op, xs.data() + i, window)));
+                    break;
+                }
+        }
+}
+
+TEST(results_do_not_depend_on_chunking)
+{
+    std::vector<decimal_t> xs;
+    for (int i = 0; i < 500; ++i)
+        xs.push_back(i % 37 == 0 ? NaN : std::sin(i) * 1e6 + i);
+    for (auto op : {RollingOp::SUM, RollingOp::MEAN, RollingOp::MIN, RollingOp::VAR})
+    {
+        auto whole = roll(op, 10, xs, xs.size());
+        for (size_t chunk : {1, 3, 9, 10, 64})
+        {
+            auto split = roll(op, 10, xs, chunk);
+            CHECK_EQ(split.size(), whole.size());
+            CHECK(std::equal(split.begin(), split.end(), whole.begin(), evaltest::same));
+        }
+    }
+}
+
+TEST(short_and_empty_series)
+{
+    auto context = evaltest::makeContext();
+    auto v = context.exec("rolling_sum([1, 2], 3)");
+    CHECK_EQ(evaltest::list(v).size(), size_t(0));
+    v = context.exec("rolling_max([4, 2], 2)");
+    CHECK(evaltest::sameList(evaltest::list(v), {4}));
+    v = context.exec("rolling_mean([5], 1)");
+    CHECK(evaltest::sameList(evaltest::list(v), {5}));
+    v = context.exec("ewma([], 0.5)");
+    CHECK_EQ(evaltest::list(v).size(), size_t(0));
+    v = context.exec("ewma([2, 4, 0/0], 0.5)");
+    CHECK(evaltest::sameList(evaltest::list(v), {2, 3, NaN}));
+
+    for (auto input : {"rolling_sum([1], 0)", "rolling_var([1, 2], 1)", "rolling_min(1, 2)", "ewma([1], [1])"})
+    {
+        auto ret = context.tryExec(input);
+        CHECK(!ret && ret.error().code == EVAL_WRONG_PARAMETER_TYPE);
+    }
+}
@@ -0,0 +1,122 @@
+#include "Test.h"
+
+#include <evaluator/Reduce.h>
+#include <evaluator/Scheduler.h>
+
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace eval;
+
+static const decimal_t NaN = std::numeric_limits<decimal_t>::quiet_NaN();
+
+static bool identical(const ListType &a, const ListType &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (std::memcmp(&a[i], &b[i], sizeof(decimal_t)) != 0 && !(std::isnan(a[i]) && std::isnan(b[i])))
+            return false;
+    return true;
+}
+
+static ListType randomList(size_t n, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<decimal_t> value(0.5, 1.5);
+    ListType l(n);
+    for (size_t i = 0; i < n; ++i)
+        l[i] = rng() % 2 ? value(rng) : -value(rng);
+    return l;
+}
+
+TEST(empty_and_single_element_lists)
+{
+    ListType empty;
+    CHECK(listCumsum(empty).empty());
+    CHECK(listCumprod(empty).empty());
+    CHECK(listCummax(empty).empty());
+    CHECK(listCummin(empty).empty());
+    CHECK(listDiff(empty).empty());
+
+    ListType one{4};
+    CHECK(evaltest::sameList(listCumsum(one), {4}));
+    CHECK(evaltest::sameList(listCummax(one), {4}));
+    CHECK(listDiff(one).empty());
+}
+
+TEST(short_lists_match_a_plain_loop)
+{
+    for (size_t n = 2; n <= 3 * REDUCE_LANES + 1; ++n)
+    {
+        ListType l(n);
+        for (size_t i = 0; i < n; ++i)
+            l[i] = static_cast<decimal_t>((i * 5) % 7) - 3;
+        auto sum = listCumsum(l), prod = listCumprod(l), mx = listCummax(l), mn = listCummin(l), diff = listDiff(l);
+        CHECK_EQ(diff.size(), n - 1);
+        decimal_t s = 0, p = 1, hi = l[0], lo = l[0];
+        for (size_t i = 0; i < n; ++i)
+        {
+            s += l[i];
+            p *= l[i];
+            hi = std::max(hi, l[i]);
+            lo = std::min(lo, l[i]);
+            CHECK_EQ(sum[i], s);
+            CHECK_EQ(prod[i], p);
+            CHECK_EQ(mx[i], hi);
+            CHECK_EQ(mn[i], lo);
+            if (i + 1 < n)
+                CHECK_EQ(diff[i], l[i + 1] - l[i]);
+        }
+    }
+}
+
+TEST(nan_sticks_to_extremes)
+{
+    for (size_t n : {size_t(5), 2 * REDUCE_LANES + 5, 2 * REDUCE_BLOCK_SIZE + 5})
+    {
+        ListType l(n);
+        for (size_t i = 0; i < n; ++i)
+            l[i] = static_cast<decimal_t>(i % 11);
+        const size_t at = n / 2;
+        l[at] = NaN;
+        auto mx = listCummax(l), mn = listCummin(l), sum = listCumsum(l), diff = listDiff(l);
+        CHECK(!std::isnan(mx[at - 1]) && !std::isnan(mn[at - 1]) && !std::isnan(sum[at - 1]));
+        CHECK(std::isnan(mx[n - 1]) && std::isnan(mn[n - 1]) && std::isnan(sum[n - 1]));
+        CHECK(std::isnan(diff[at - 1]) && std::isnan(diff[at]));
+        if (at + 2 < n)
+            CHECK(!std::isnan(diff[at + 1]));
+    }
+}
+
+TEST(results_do_not_depend_on_threads)
+{
+    auto l = randomList(4 * REDUCE_PARALLEL_THRESHOLD + 77, 50);
+    const ListType serial[] = {listCumsum(l), listCumprod(l), listCummax(l), listCummin(l), listDiff(l)};
+    for (size_t threads : {1, 2, 5})
+    {
+        TaskScheduler scheduler(threads);
+        const ListType parallel[] = {listCumsum(l, &scheduler), listCumprod(l, &scheduler), listCummax(l, &scheduler),
+                                     listCummin(l, &scheduler), listDiff(l, &scheduler)};
+        for (size_t i = 0; i < 5; ++i)
+            CHECK(identical(serial[i], parallel[i]));
+    }
+    // the last prefix sum agrees with the compensated reduction
+    CHECK(evaltest::near(serial[0][l.size() - 1], listSum(l), 1e-9));
+}
+
+TEST(scan_builtins)
+{
+    auto context = evaltest::makeContext();
+    auto v = context.exec("cumsum([1, 2, 3]) + cumprod([1, 2, 3])");
+    CHECK(evaltest::sameList(evaltest::list(v), {2, 5, 12}));
+    v = context.exec("diff(cummax([3, 1, 4, 1, 5]))");
+    CHECK(evaltest::sameList(evaltest::list(v), {0, 1, 0, 1}));
+    v = context.exec("cummin([])");
+    CHECK(evaltest::list(v).empty());
+    auto ret = context.tryExec("cumsum(1)");
+    CHECK(!ret && ret.error().code == EVAL_WRONG_PARAMETER_TYPE);
+    ret = context.tryExec("diff([1], [2])");
+    CHECK(!ret && ret.error().code == EVAL_WRONG_NUMBER_OF_PARAMETERS);
+}
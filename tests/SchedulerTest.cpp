@@ -0,0 +1,170 @@
+#include "Test.h"
+
+#include <evaluator/Scheduler.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+using namespace eval;
+
+TEST(parallel_for_runs_every_index)
+{
+    TaskScheduler scheduler(3);
+    std::vector<std::atomic<int>> hits(1000);
+    scheduler.parallelFor(hits.size(), [&](size_t i)
+                          { ++hits[i]; });
+    for (auto &h : hits)
+        CHECK_EQ(h.load(), 1);
+    scheduler.parallelFor(0, [](size_t)
+                          { throw std::logic_error("never called"); });
+}
+
+TEST(parallel_for_nested)
+{
+    TaskScheduler scheduler(2);
+    std::atomic<size_t> sum{0};
+    scheduler.parallelFor(16, [&](size_t i)
+                          { scheduler.parallelFor(16, [&](size_t j)
+                                                  { sum += i * 16 + j; }); });
+    CHECK_EQ(sum.load(), size_t(255 * 256 / 2));
+}
+
+TEST(parallel_for_rethrows_lowest_index)
+{
+    TaskScheduler scheduler(2);
+    CHECK_THROWS(scheduler.parallelFor(64, [](size_t i)
+                                       {
+                                           if (i == 40)
+                                               throw std::runtime_error("late");
+                                           if (i == 7)
+                                               throw EvalExcept(EVAL_INDEX_OUT_OF_RANGE); }),
+                 EVAL_INDEX_OUT_OF_RANGE);
+}
+
+TEST(wait_rethrows_task_exception)
+{
+    TaskScheduler scheduler(1);
+    TaskScheduler::Task task;
+    task.func = []
+    { throw std::bad_alloc(); };
+    scheduler.spawn(task);
+    bool caught = false;
+    try
+    {
+        scheduler.wait(task);
+    }
+    catch (const std::bad_alloc &)
+    {
+        caught = true;
+    }
+    CHECK(caught);
+}
+
+TEST(posted_exceptions_do_not_terminate)
+{
+    TaskScheduler scheduler(2);
+    std::mutex mutex;
+    std::condition_variable cv;
+    int handled = 0;
+    for (int i = 0; i < 4; ++i)
+        scheduler.post([]
+                       { throw std::bad_alloc(); },
+                       [&](std::exception_ptr e)
+                       {
+                           bool badAlloc = false;
+                           try
+                           {
+                               std::rethrow_exception(e);
+                           }
+                           catch (const std::bad_alloc &)
+                           {
+                               badAlloc = true;
+                           }
+                           std::lock_guard<std::mutex> lock(mutex);
+                           handled += badAlloc;
+                           cv.notify_all();
+                       });
+    // without a handler the exception is dropped
+    scheduler.post([]
+                   { throw std::runtime_error("dropped"); });
+    std::unique_lock<std::mutex> lock(mutex);
+    CHECK(cv.wait_for(lock, std::chrono::seconds(10), [&]
+                      { return handled == 4; }));
+
+    std::atomic<bool> ran{false};
+    scheduler.post([&]
+                   { ran = true; });
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!ran && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(ran.load());
+}
+
+TEST(wait_does_not_run_detached_tasks)
+{
+    TaskScheduler scheduler(1);
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false, blocking = false;
+    // keeps the only worker busy
+    scheduler.post([&]
+                   {
+                       std::unique_lock<std::mutex> lock(mutex);
+                       blocking = true;
+                       cv.notify_all();
+                       cv.wait(lock, [&]
+                               { return release; }); });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]
+                { return blocking; });
+    }
+
+    const auto self = std::this_thread::get_id();
+    std::atomic<bool> detachedOnWaiter{false}, detachedRan{false};
+    scheduler.post([&]
+                   {
+                       detachedOnWaiter = std::this_thread::get_id() == self;
+                       detachedRan = true; });
+    // the waiter has to run this one itself, and must leave the detached one
+    std::atomic<bool> joinableRan{false};
+    TaskScheduler::Task task;
+    task.func = [&]
+    { joinableRan = true; };
+    scheduler.spawn(task);
+    scheduler.wait(task);
+    CHECK(joinableRan.load());
+    CHECK(!detachedRan.load());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!detachedRan && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(detachedRan.load());
+    CHECK(!detachedOnWaiter.load());
+}
+
+TEST(wait_sleeps_while_task_runs_elsewhere)
+{
+    TaskScheduler scheduler(1);
+    TaskScheduler::Task task;
+    task.func = []
+    { std::this_thread::sleep_for(std::chrono::milliseconds(200)); };
+    // give the worker a chance to take it before the caller waits
+    scheduler.spawn(task);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto cpuStart = std::clock();
+    scheduler.wait(task);
+    const double cpuMs = 1000.0 * static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    // std::clock is process time, the worker only sleeps; spinning would burn ~180ms
+    CHECK(cpuMs < 100);
+}
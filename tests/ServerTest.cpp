@@ -0,0 +1,188 @@
+#include "Test.h"
+
+#include "Server.h"
+
+#ifdef __linux__
+#include <csignal>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace eval;
+
+static size_t openFds()
+{
+    size_t n = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    while (readdir(dir) != nullptr)
+        ++n;
+    closedir(dir);
+    return n;
+}
+
+TEST(invalid_addresses_are_rejected_without_leaking)
+{
+    const char *addresses[] = {
+        "tcp:0",
+        "tcp:65536",
+        "tcp:4294967297",
+        "tcp:-1",
+        "tcp:",
+        "tcp:80x",
+        "unix:",
+        "unix:/nonexistent-eval-dir/eval.sock",
+        "http:8080",
+    };
+    const size_t fds = openFds();
+    for (auto address : addresses)
+    {
+        if (serve(address, 1) != 2)
+            evaltest::fail(__FILE__, __LINE__, std::string(address) + " was accepted");
+        CHECK_EQ(openFds(), fds);
+    }
+}
+
+// serves on a unix socket in a child process for the lifetime of the test
+class ServerProcess
+{
+public:
+    explicit ServerProcess(const EvalBudget &budget)
+        : m_path("/tmp/eval-server-test-" + std::to_string(getpid()) + ".sock")
+    {
+        unlink(m_path.c_str());
+        m_pid = fork();
+        if (m_pid == 0)
+            _exit(serve("unix:" + m_path, 2, nullptr, budget));
+    }
+    ~ServerProcess()
+    {
+        kill(m_pid, SIGKILL);
+        waitpid(m_pid, nullptr, 0);
+        unlink(m_path.c_str());
+    }
+
+    int connect() const
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, m_path.c_str(), m_path.size() + 1);
+        for (int i = 0; i < 500; ++i)
+        {
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0)
+                return fd;
+            ::close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        evaltest::fail(__FILE__, __LINE__, "cannot connect to " + m_path);
+        return -1;
+    }
+
+private:
+    std::string m_path;
+    pid_t m_pid;
+};
+
+static std::vector<std::string> request(int fd, const std::string &input, size_t lines)
+{
+    CHECK_EQ(static_cast<size_t>(::write(fd, input.data(), input.size())), input.size());
+    std::string buf;
+    char chunk[4096];
+    while (static_cast<size_t>(std::count(buf.begin(), buf.end(), '\n')) < lines)
+    {
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n <= 0)
+            break;
+        buf.append(chunk, n);
+    }
+    std::vector<std::string> ret;
+    size_t begin = 0, end;
+    while ((end = buf.find('\n', begin)) != std::string::npos)
+    {
+        ret.push_back(buf.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return ret;
+}
+
+TEST(requests_are_answered_in_order)
+{
+    ServerProcess server(SERVER_DEFAULT_BUDGET);
+    int fd = server.connect();
+    auto lines = request(fd, "x = 2\nx + 1\nf(n) = [n, n]\nf(x)\n1 +\n", 5);
+    CHECK_EQ(lines.size(), size_t(5));
+    CHECK_EQ(lines[0], std::string("ok"));
+    CHECK_EQ(lines[1], std::string("ok 3"));
+    CHECK_EQ(lines[2], std::string("ok"));
+    CHECK_EQ(lines[3], std::string("ok [2, 2]"));
+    CHECK_EQ(lines[4].substr(0, 4), std::string("err "));
+    ::close(fd);
+}
+
+TEST(requests_cannot_touch_files)
+{
+    ServerProcess server(SERVER_DEFAULT_BUDGET);
+    int fd = server.connect();
+    auto lines = request(fd, "save_json(\"/tmp/eval-server-test.json\", [1])\nlen(load_f64(\"/etc/passwd\"))\n", 2);
+    CHECK_EQ(lines.size(), size_t(2));
+    for (auto &l : lines)
+        CHECK(l.rfind("err io error: file access disabled", 0) == 0);
+    ::close(fd);
+}
+
+TEST(the_default_budget_stops_runaway_requests)
+{
+    ServerProcess server(SERVER_DEFAULT_BUDGET);
+    int fd = server.connect();
+    auto lines = request(fd, "f(n) = f(n + 1) + 1\nf(0)\n40 + 2\n", 3);
+    CHECK_EQ(lines.size(), size_t(3));
+    CHECK_EQ(lines[1].substr(0, 4), std::string("err "));
+    // the session keeps working after the failed request
+    CHECK_EQ(lines[2], std::string("ok 42"));
+    ::close(fd);
+}
+
+TEST(deeply_nested_requests_fail_cleanly)
+{
+    ServerProcess server(SERVER_DEFAULT_BUDGET);
+    int fd = server.connect();
+    const size_t depth = 200000;
+    std::string input = "x = 40\n" + std::string(depth, '(') + "1" + std::string(depth, ')') + "\n1";
+    for (size_t i = 0; i < depth; ++i)
+        input += " + 1";
+    input += "\nx + 2\n";
+    auto lines = request(fd, input, 4);
+    CHECK_EQ(lines.size(), size_t(4));
+    CHECK(lines[1].rfind("err budget error: recursion limit exceeded", 0) == 0);
+    CHECK(lines[2].rfind("err budget error: recursion limit exceeded", 0) == 0);
+    // the same session still answers
+    CHECK_EQ(lines[3], std::string("ok 42"));
+    ::close(fd);
+}
+
+TEST(budgets_apply_to_each_request)
+{
+    EvalBudget budget;
+    budget.maxSteps = 1000;
+    ServerProcess server(budget);
+    int fd = server.connect();
+    // each request stays under the limit, together they would not
+    std::string input;
+    for (int i = 0; i < 20; ++i)
+        input += "sum(pmap([1, 2, 3, 4, 5, 6, 7, 8], @(x){x * 2}))\n";
+    input += "g(n) = if_else(gt(n, 0), g(n - 1) + 1, 0)\ng(900)\n";
+    auto lines = request(fd, input, 22);
+    CHECK_EQ(lines.size(), size_t(22));
+    for (int i = 0; i < 20; ++i)
+        CHECK_EQ(lines[i], std::string("ok 72"));
+    CHECK_EQ(lines[21].substr(0, 4), std::string("err "));
+    ::close(fd);
+}
+#endif
@@ -0,0 +1,137 @@
+#ifndef EVAL_TEST_H_
+#define EVAL_TEST_H_
+
+#include <evaluator/Context.h>
+
+#include <cmath>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Minimal test harness: TEST bodies register themselves and are run by
+// TestMain.cpp, a failed check aborts the current test only.
+namespace evaltest
+{
+
+struct TestCase
+{
+    const char *name;
+    void (*func)();
+};
+
+std::vector<TestCase> &registry();
+
+struct Registrar
+{
+    Registrar(const char *name, void (*func)()) { registry().push_back({name, func}); }
+};
+
+struct Failure
+{
+    std::string message;
+};
+
+[[noreturn]] void fail(const char *file, int line, const std::string &message);
+
+template <typename T>
+std::string show(const T &v)
+{
+    std::ostringstream ss;
+    ss.precision(17);
+    ss << v;
+    return ss.str();
+}
+
+inline eval::decimal_t number(const eval::DataType &v)
+{
+    if (v.index() != 1)
+        throw Failure{"value is not a decimal"};
+    return std::get<1>(v);
+}
+
+inline const eval::ListType &list(const eval::DataType &v)
+{
+    if (v.index() != 2)
+        throw Failure{"value is not a list"};
+    return std::get<2>(v);
+}
+
+// NaN equals NaN
+inline bool same(eval::decimal_t a, eval::decimal_t b)
+{
+    return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+inline bool sameList(const eval::ListType &l, std::initializer_list<eval::decimal_t> expected)
+{
+    if (l.size() != expected.size())
+        return false;
+    size_t i = 0;
+    for (auto v : expected)
+        if (!same(l[i++], v))
+            return false;
+    return true;
+}
+
+// recursive fibonacci used by tests that need a lot of cheap calls
+inline constexpr const char *FIB = "fib(n) = if_else(gt(n, 1), fib(n - 1) + fib(n - 2), 1)";
+
+// initialized Context with the given definitions executed in order
+inline eval::Context makeContext(std::initializer_list<const char *> definitions = {})
+{
+    eval::Context context;
+    context.init();
+    for (auto definition : definitions)
+        context.exec(definition);
+    return context;
+}
+
+inline bool near(eval::decimal_t a, eval::decimal_t b, eval::decimal_t relTol = 1e-12)
+{
+    return std::abs(a - b) <= relTol * std::max<eval::decimal_t>(1, std::max(std::abs(a), std::abs(b)));
+}
+
+} // namespace evaltest
+
+#define TEST(name)                                                          \
+    static void test_##name();                                              \
+    static evaltest::Registrar registrar_##name(#name, &test_##name); \
+    static void test_##name()
+
+#define CHECK(cond)                                   \
+    do                                                \
+    {                                                 \
+        if (!(cond))                                  \
+            evaltest::fail(__FILE__, __LINE__, #cond); \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                  \
+    do                                                                                  \
+    {                                                                                   \
+        auto &&va_ = (a);                                                               \
+        auto &&vb_ = (b);                                                               \
+        if (!(va_ == vb_))                                                              \
+            evaltest::fail(__FILE__, __LINE__,                                          \
+                           #a " == " #b " (" + evaltest::show(va_) + " vs " + evaltest::show(vb_) + ")"); \
+    } while (0)
+
+#define CHECK_THROWS(expr, errCode)                                                         \
+    do                                                                                      \
+    {                                                                                       \
+        bool thrown_ = false;                                                               \
+        try                                                                                 \
+        {                                                                                   \
+            expr;                                                                           \
+        }                                                                                   \
+        catch (const eval::EvalExcept &e)                                                   \
+        {                                                                                   \
+            thrown_ = true;                                                                 \
+            if (e.code() != (errCode))                                                      \
+                evaltest::fail(__FILE__, __LINE__, std::string(#expr " threw ") + e.what()); \
+        }                                                                                   \
+        if (!thrown_)                                                                       \
+            evaltest::fail(__FILE__, __LINE__, #expr " did not throw");                    \
+    } while (0)
+
+#endif
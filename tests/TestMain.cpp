@@ -0,0 +1,60 @@
+#include "Test.h"
+
+#include <cstdio>
+
+namespace evaltest
+{
+
+std::vector<TestCase> &registry()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+void fail(const char *file, int line, const std::string &message)
+{
+    throw Failure{std::string(file) + ":" + std::to_string(line) + ": " + message};
+}
+
+} // namespace evaltest
+
+// runs every registered test, or those named on the command line
+int main(int argc, char **argv)
+{
+    size_t failed = 0, run = 0;
+    for (auto &t : evaltest::registry())
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+            selected = selected || std::string(argv[i]) == t.name;
+        if (!selected)
+            continue;
+        ++run;
+        std::string error;
+        try
+        {
+            t.func();
+        }
+        catch (const evaltest::Failure &f)
+        {
+            error = f.message;
+        }
+        catch (const eval::EvalExcept &e)
+        {
+            error = std::string("unexpected EvalExcept: ") + e.what();
+        }
+        catch (const std::exception &e)
+        {
+            error = std::string("unexpected exception: ") + e.what();
+        }
+        if (error.empty())
+            std::printf("[ OK ] %s\n", t.name);
+        else
+        {
+            ++failed;
+            std::printf("[FAIL] %s\n  %s\n", t.name, error.c_str());
+        }
+    }
+    std::printf("%zu of %zu tests passed\n", run - failed, run);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
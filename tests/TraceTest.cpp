@@ -0,0 +1,169 @@
+#include "Test.h"
+
+#include <evaluator/Scheduler.h>
+#include <evaluator/Trace.h>
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+
+using namespace eval;
+
+static size_t eventCount(const JsonNode &trace)
+{
+    return trace["traceEvents"].getArr().size();
+}
+
+static size_t eventCount(const JsonNode &trace, const std::string &name)
+{
+    size_t count = 0;
+    for (auto &e : trace["traceEvents"].getArr())
+        count += (*e)["name"].getStr() == name;
+    return count;
+}
+
+TEST(spans_are_recorded_when_enabled)
+{
+    auto &tracer = Tracer::instance();
+    tracer.clear();
+    {
+        TraceSpan span("off");
+    }
+    CHECK_EQ(eventCount(tracer.toJson()), size_t(0));
+
+    tracer.start();
+    {
+        TraceSpan outer("outer");
+        TraceSpan inner(std::string("inner"));
+        TraceSpan inactive("inactive", false);
+    }
+    tracer.stop();
+    auto trace = tracer.toJson();
+    CHECK_EQ(eventCount(trace), size_t(2));
+    std::set<std::string> names;
+    for (auto &e : trace["traceEvents"].getArr())
+        names.insert((*e)["name"].getStr());
+    CHECK(names.count("outer") && names.count("inner"));
+}
+
+TEST(sampling_applies_to_nested_spans)
+{
+    auto &tracer = Tracer::instance();
+    tracer.clear();
+    tracer.start(4);
+    for (int i = 0; i < 16; ++i)
+    {
+        TraceSpan outer("outer");
+        TraceSpan inner("inner");
+    }
+    tracer.stop();
+    CHECK_EQ(eventCount(tracer.toJson()), size_t(8));
+}
+
+TEST(ring_buffer_keeps_newest_events)
+{
+    auto &tracer = Tracer::instance();
+    tracer.clear();
+    // a new thread picks up the new buffer size
+    std::thread([&]
+                {
+                    tracer.start(1, 8);
+                    for (int i = 0; i < 20; ++i)
+                        TraceSpan span("span");
+                    tracer.stop(); })
+        .join();
+    CHECK_EQ(eventCount(tracer.toJson()), size_t(8));
+    tracer.start();
+    tracer.stop();
+}
+
+TEST(exited_threads_return_their_buffers)
+{
+    auto &tracer = Tracer::instance();
+    tracer.start();
+    { TraceSpan span("main"); }
+    tracer.clear();
+    const size_t base = tracer.bufferCount();
+    for (int i = 0; i < 32; ++i)
+        std::thread([]
+                    { TraceSpan span(std::string("worker")); })
+            .join();
+    // one buffer shared by the sequential threads
+    CHECK_EQ(tracer.bufferCount(), base + 1);
+    auto trace = tracer.toJson();
+    // the last thread's events are still readable after it exited
+    size_t workers = 0;
+    for (auto &e : trace["traceEvents"].getArr())
+        workers += (*e)["name"].getStr() == "worker";
+    CHECK_EQ(workers, size_t(1));
+
+    tracer.clear();
+    CHECK_EQ(tracer.bufferCount(), base);
+    tracer.stop();
+}
+
+TEST(interned_names_survive_clear)
+{
+    auto &tracer = Tracer::instance();
+    tracer.start();
+    { TraceSpan span(std::string("lambda_a")); }
+    tracer.clear();
+    { TraceSpan span(std::string("lambda_a")); }
+    tracer.stop();
+    auto trace = tracer.toJson();
+    CHECK_EQ(eventCount(trace), size_t(1));
+    CHECK_EQ(trace["traceEvents"][0]["name"].getStr(), std::string("lambda_a"));
+    tracer.clear();
+}
+
+TEST(forked_tasks_follow_the_sampling_decision)
+{
+    auto &tracer = Tracer::instance();
+    TaskScheduler scheduler(4);
+    auto context = evaltest::makeContext({evaltest::FIB});
+    context.setParallelEval(&scheduler, 1);
+    tracer.clear();
+    tracer.start(2);
+    for (int i = 0; i < 8; ++i)
+        context.exec("fib(10)");
+    tracer.stop();
+    auto trace = tracer.toJson();
+    CHECK_EQ(eventCount(trace, "exec"), size_t(4));
+    // every call of the sampled execs, 177 each, wherever it ran
+    CHECK_EQ(eventCount(trace, "fib"), size_t(4 * 177));
+    tracer.clear();
+}
+
+TEST(dumps_and_stop_while_spans_are_open)
+{
+    auto &tracer = Tracer::instance();
+    tracer.clear();
+    tracer.start(1, 64);
+    std::atomic<bool> done{false};
+    std::thread writer([&]
+                       {
+                           while (!done)
+                               TraceSpan span("busy"); });
+    for (int i = 0; i < 200; ++i)
+        for (auto &e : tracer.toJson()["traceEvents"].getArr())
+            CHECK_EQ((*e)["name"].getStr(), std::string("busy"));
+    done = true;
+    writer.join();
+
+    std::atomic<bool> opened{false};
+    std::thread slow([&]
+                     {
+                         TraceSpan span("slow");
+                         opened = true;
+                         std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    while (!opened)
+        std::this_thread::yield();
+    tracer.stop();
+    // stop returned once the open span was recorded
+    CHECK_EQ(eventCount(tracer.toJson(), "slow"), size_t(1));
+    slow.join();
+    tracer.clear();
+    tracer.start();
+    tracer.stop();
+}